@@ -38,27 +38,44 @@ Adafruit_MCP23X17 mcpDO_1;  // 0x27 - DRV0-DRV15 (outputs 0-15)
 // 2. Swap RX/TX if wired incorrectly
 // 3. Check if PWRKEY needs to be connected/toggled
 // 4. Verify power supply (SIM7600 needs stable 3.4-4.2V, recommend 3.8V)
+
+// Bridge - bytes are copied in chunks, never through String / readString()
+#define BRIDGE_UART_BUFFER   8192   // UART driver RX/TX buffers (file / firmware transfers)
+#define BRIDGE_CHUNK         512    // Bytes moved per read
+#define BRIDGE_LINE_MAX      512    // Longest line typed in line mode
+#define BRIDGE_ESCAPE        1      // "+++" with a guard time ends passthrough (0 = reset only)
+#define BRIDGE_ESCAPE_GUARD_MS 1000 // Silence before and after "+++"
+
+// Scripted AT sequences ("~run AT|AT+CSQ|AT+CREG?")
+#define SCRIPT_MAX_STEPS     16
+#define SCRIPT_STEP_TIMEOUT_MS 10000
+
+#define SMS_RESULT_TIMEOUT_MS 60000  // +CMGS after Ctrl+Z - the network can be slow
 // ===== END CONFIGURATION =====
 
 HardwareSerial SIM7600(1); // Use Serial1
 
-bool smsSent = false;
-String response = "";
+bool bridgeActive = false;
+String response = "";  // Last sendATCommand() answer (setup only)
 
 // Forward declarations
 void powerOnModule();
 void sendATCommand(String command, int timeout);
-String waitForResponse(int timeout);
-void sendSMS(String number, String message);
+bool smsStart(const char* number, const char* message);
+bool modemBusy();
 
 void setup() {
-  // Initialize Serial for debugging
+  // Initialize Serial for debugging (large RX buffer - the bridge forwards bursts)
+  Serial.setRxBufferSize(BRIDGE_UART_BUFFER);
   Serial.begin(115200);
   initDOModules();
   Serial.println("\n\n=== SIM7600 SMS & AT Command Bridge ===");
   
   // Initialize SIM7600 communication with HardwareSerial
   // Serial1.begin(baud, protocol, RX pin, TX pin)
+  // Buffer sizes must be set before begin() and are kept across the baud scan
+  SIM7600.setRxBufferSize(BRIDGE_UART_BUFFER);
+  SIM7600.setTxBufferSize(BRIDGE_UART_BUFFER);
   SIM7600.begin(SIM7600_BAUD, SERIAL_8N1, SIM7600_RX, SIM7600_TX);
   Serial.printf("Initialized SIM7600 UART on RX:%d, TX:%d at %d baud\n", 
                 SIM7600_RX, SIM7600_TX, SIM7600_BAUD);
@@ -111,7 +128,7 @@ void setup() {
     Serial.println("5. Verify SIM card is inserted properly");
     Serial.println("\nEntering bridge mode anyway for manual testing...");
     Serial.println("Try sending: AT (to test), AT+IPR=115200 (to set baud)");
-    smsSent = true;
+    bridgeActive = true;
     return; // Skip SMS sending, go straight to bridge mode
   }
   
@@ -127,36 +144,473 @@ void setup() {
   Serial.println("Checking signal quality...");
   sendATCommand("AT+CSQ", 1000);
   
-  // Send SMS
+  // Send SMS - runs from loop(), the bridge is usable meanwhile
   Serial.println("\n=== Sending SMS ===");
-  sendSMS("+254729399246", "Hello from ESP32-S3 and SIM7600!");
+  smsStart("+254729399246", "Hello from ESP32-S3 and SIM7600!");
   
-  smsSent = true;
+  bridgeActive = true;
   
-  Serial.println("\n\n=== SMS Sent! ===");
-  Serial.println("=== Now entering AT Command Bridge Mode ===");
+  Serial.println("\n=== Now entering AT Command Bridge Mode ===");
   Serial.println("You can now type AT commands in the Serial Monitor");
-  Serial.println("Commands will be forwarded to SIM7600 and responses printed\n");
+  Serial.println("Commands will be forwarded to SIM7600 and responses printed");
+  Serial.println("Local commands:");
+  Serial.println("  ~pass                  transparent passthrough (binary safe), +++ to leave");
+  Serial.println("  ~run AT|AT+CSQ|...     run AT commands one after another");
+  Serial.println("  ~sms <number> <text>   send an SMS without blocking the bridge\n");
 }
 
-void loop() {
-  // Bridge mode: Forward commands from Serial to SIM7600
-  if (smsSent) {
-    // Check if data available from Serial Monitor
-    if (Serial.available()) {
-      String command = Serial.readStringUntil('\n');
-      command.trim();
-      if (command.length() > 0) {
-        Serial.print(">> Sending: ");
-        Serial.println(command);
-        SIM7600.println(command);
+// ===== Modem Results (line mode) =====
+// SMS and script steps wait for these while loop() keeps the bridge running
+
+enum ModemResult {
+  RESULT_NONE,
+  RESULT_OK,
+  RESULT_ERROR,
+  RESULT_PROMPT,   // '>' - SMS text expected
+  RESULT_TIMEOUT,
+};
+
+char modemLine[128];
+size_t modemLineLen = 0;
+bool resultPending = false;
+ModemResult lastResult = RESULT_NONE;
+unsigned long resultDeadline = 0;
+
+void expectResult(unsigned long timeout) {
+  lastResult = RESULT_NONE;
+  resultPending = true;
+  resultDeadline = millis() + timeout;
+}
+
+void sendCommand(const char* command, unsigned long timeout) {
+  Serial.print(">> Sending: ");
+  Serial.println(command);
+  SIM7600.print(command);
+  SIM7600.print("\r\n");
+  expectResult(timeout);
+}
+
+// RESULT_NONE while still waiting (or nothing was sent)
+ModemResult pollResult() {
+  if (!resultPending) {
+    return RESULT_NONE;
+  }
+  if (lastResult == RESULT_NONE && (long)(millis() - resultDeadline) < 0) {
+    return RESULT_NONE;
+  }
+  resultPending = false;
+  return lastResult != RESULT_NONE ? lastResult : RESULT_TIMEOUT;
+}
+
+// Watches the modem's output for final results - it is printed unchanged
+void trackModemByte(char c) {
+  if (c == '\n' || c == '\r') {
+    modemLine[modemLineLen] = '\0';
+    if (strcmp(modemLine, "OK") == 0) {
+      lastResult = RESULT_OK;
+    } else if (strcmp(modemLine, "ERROR") == 0 || strncmp(modemLine, "+CME ERROR", 10) == 0 ||
+               strncmp(modemLine, "+CMS ERROR", 10) == 0) {
+      lastResult = RESULT_ERROR;
+    }
+    modemLineLen = 0;
+    return;
+  }
+  if (c == '>' && modemLineLen == 0) {
+    lastResult = RESULT_PROMPT;  // "> " has no line end after it
+  }
+  if (modemLineLen < sizeof(modemLine) - 1) {
+    modemLine[modemLineLen++] = c;
+  }
+}
+
+// ===== Non-blocking SMS =====
+
+enum SmsState {
+  SMS_IDLE,
+  SMS_TEXT_MODE,   // AT+CMGF=1
+  SMS_CHARSET,     // AT+CSCS="GSM"
+  SMS_RECIPIENT,   // AT+CMGS="<number>", waiting for '>'
+  SMS_BODY,        // Text + Ctrl+Z, waiting for +CMGS / OK
+};
+
+SmsState smsState = SMS_IDLE;
+char smsNumber[24];
+char smsText[161];
+
+bool smsStart(const char* number, const char* message) {
+  if (modemBusy()) {
+    Serial.println("ERROR: Modem busy - SMS not sent");
+    return false;
+  }
+  strncpy(smsNumber, number, sizeof(smsNumber) - 1);
+  smsNumber[sizeof(smsNumber) - 1] = '\0';
+  strncpy(smsText, message, sizeof(smsText) - 1);
+  smsText[sizeof(smsText) - 1] = '\0';
+  if (strlen(message) >= sizeof(smsText)) {
+    Serial.println("WARNING: Message cut to 160 characters");
+  }
+
+  Serial.println("Setting SMS text mode...");
+  sendCommand("AT+CMGF=1", 2000);
+  smsState = SMS_TEXT_MODE;
+  return true;
+}
+
+void smsFail(const char* reason) {
+  Serial.print("ERROR: ");
+  Serial.println(reason);
+  smsState = SMS_IDLE;
+}
+
+void smsPoll() {
+  if (smsState == SMS_IDLE) {
+    return;
+  }
+  ModemResult r = pollResult();
+  if (r == RESULT_NONE) {
+    return;
+  }
+
+  char cmd[48];
+  switch (smsState) {
+    case SMS_TEXT_MODE:
+      if (r != RESULT_OK) {
+        smsFail("Failed to set text mode");
+        return;
+      }
+      Serial.println("Setting character set...");
+      sendCommand("AT+CSCS=\"GSM\"", 2000);
+      smsState = SMS_CHARSET;
+      break;
+
+    case SMS_CHARSET:
+      if (r != RESULT_OK) {
+        smsFail("Failed to set character set");
+        return;
       }
+      Serial.print("Setting recipient: ");
+      Serial.println(smsNumber);
+      snprintf(cmd, sizeof(cmd), "AT+CMGS=\"%s\"", smsNumber);
+      sendCommand(cmd, 5000);
+      smsState = SMS_RECIPIENT;
+      break;
+
+    case SMS_RECIPIENT:
+      if (r != RESULT_PROMPT) {
+        smsFail("Did not receive '>' prompt");
+        return;
+      }
+      Serial.println("Got '>' prompt, sending message...");
+      SIM7600.print(smsText);
+      SIM7600.write(26);  // Ctrl+Z ends the message
+      Serial.println("Sent Ctrl+Z, waiting for confirmation...");
+      expectResult(SMS_RESULT_TIMEOUT_MS);
+      smsState = SMS_BODY;
+      break;
+
+    case SMS_BODY:
+      if (r == RESULT_OK) {
+        Serial.println("\nSUCCESS: SMS sent successfully!");
+      } else if (r == RESULT_ERROR) {
+        Serial.println("\nERROR: Failed to send SMS");
+      } else {
+        Serial.println("\nWARNING: Unclear response - SMS may or may not have been sent");
+      }
+      smsState = SMS_IDLE;
+      break;
+
+    default:
+      smsState = SMS_IDLE;
+      break;
+  }
+}
+
+// ===== AT Scripts =====
+// "~run AT|ATI|AT+CSQ" - each command is sent once the previous one answered
+
+char scriptBuf[BRIDGE_LINE_MAX];
+char* scriptSteps[SCRIPT_MAX_STEPS];
+int scriptCount = 0;
+int scriptNext = 0;        // Next step to send
+int scriptOk = 0;
+unsigned long scriptStartedAt = 0;
+
+// An SMS or script owns the result tracking - one of them at a time
+bool modemBusy() {
+  return smsState != SMS_IDLE || scriptCount > 0 || resultPending;
+}
+
+void scriptStart(const char* text) {
+  if (modemBusy()) {
+    Serial.println("ERROR: Modem busy - script not started");
+    return;
+  }
+  strncpy(scriptBuf, text, sizeof(scriptBuf) - 1);
+  scriptBuf[sizeof(scriptBuf) - 1] = '\0';
+
+  scriptCount = 0;
+  for (char* step = strtok(scriptBuf, "|"); step != NULL; step = strtok(NULL, "|")) {
+    while (*step == ' ') {
+      step++;
     }
-    
-    // Check if data available from SIM7600
-    if (SIM7600.available()) {
-      String response = SIM7600.readString();
-      Serial.print(response);
+    if (*step == '\0') {
+      continue;
+    }
+    if (scriptCount == SCRIPT_MAX_STEPS) {
+      Serial.printf("WARNING: Only the first %d commands are run\n", SCRIPT_MAX_STEPS);
+      break;
+    }
+    scriptSteps[scriptCount++] = step;
+  }
+  scriptNext = 0;
+  scriptOk = 0;
+  scriptStartedAt = millis();
+  Serial.printf("=== Script: %d command(s) ===\n", scriptCount);
+}
+
+void scriptPoll() {
+  if (scriptCount == 0) {
+    return;
+  }
+  if (scriptNext > 0) {
+    ModemResult r = pollResult();
+    if (r == RESULT_NONE && resultPending) {
+      return;  // Still waiting for the current step
+    }
+    if (r == RESULT_OK) {
+      scriptOk++;
+    } else if (r == RESULT_TIMEOUT) {
+      Serial.printf("WARNING: No answer to %s\n", scriptSteps[scriptNext - 1]);
+    }
+  }
+  if (scriptNext < scriptCount) {
+    sendCommand(scriptSteps[scriptNext++], SCRIPT_STEP_TIMEOUT_MS);
+    return;
+  }
+  Serial.printf("=== Script done: %d/%d OK in %lu ms ===\n", scriptOk, scriptCount,
+                millis() - scriptStartedAt);
+  scriptCount = 0;
+  scriptNext = 0;
+}
+
+// ===== Bridge =====
+
+enum BridgeMode {
+  BRIDGE_LINE,         // Lines from the monitor, local ~commands, results tracked
+  BRIDGE_PASSTHROUGH,  // Every byte both ways, nothing interpreted
+};
+
+BridgeMode bridgeMode = BRIDGE_LINE;
+char hostLine[BRIDGE_LINE_MAX];
+size_t hostLineLen = 0;
+
+// Passthrough escape: '+' bytes are held back until they turn out not to be "+++"
+uint8_t escapeHeld = 0;
+unsigned long lastHostByteAt = 0;
+unsigned long passBytesIn = 0;   // Monitor → modem
+unsigned long passBytesOut = 0;  // Modem → monitor
+bool swallowLf = false;          // "~pass\r" ended the last chunk - drop the '\n' of its CRLF
+
+// Modem → monitor, in chunks; results are tracked in line mode only
+void pumpModem() {
+  uint8_t buf[BRIDGE_CHUNK];
+  int avail = SIM7600.available();
+  while (avail > 0) {
+    size_t n = SIM7600.read(buf, avail < BRIDGE_CHUNK ? avail : BRIDGE_CHUNK);
+    if (n == 0) {
+      break;
+    }
+    Serial.write(buf, n);
+    if (bridgeMode == BRIDGE_LINE) {
+      for (size_t i = 0; i < n; i++) {
+        trackModemByte((char)buf[i]);
+      }
+    } else {
+      passBytesOut += n;
+    }
+    avail = SIM7600.available();
+  }
+}
+
+void enterPassthrough() {
+  if (modemBusy()) {
+    Serial.println("ERROR: SMS / script running - wait for it to finish");
+    return;
+  }
+  Serial.println("=== Passthrough: bytes are forwarded unchanged ===");
+#if BRIDGE_ESCAPE
+  Serial.printf("=== Pause %d ms, type +++, pause again to leave ===\n", BRIDGE_ESCAPE_GUARD_MS);
+#else
+  Serial.println("=== Reset the board to leave ===");
+#endif
+  Serial.flush();
+  bridgeMode = BRIDGE_PASSTHROUGH;
+  escapeHeld = 0;
+  lastHostByteAt = millis();
+  passBytesIn = 0;
+  passBytesOut = 0;
+}
+
+void leavePassthrough() {
+  bridgeMode = BRIDGE_LINE;
+  hostLineLen = 0;
+  modemLineLen = 0;
+  Serial.printf("\r\n=== Line mode (%lu bytes to modem, %lu from modem) ===\n",
+                passBytesIn, passBytesOut);
+}
+
+void flushEscape() {
+  static const uint8_t plus[3] = { '+', '+', '+' };
+  if (escapeHeld > 0) {
+    SIM7600.write(plus, escapeHeld);
+    passBytesIn += escapeHeld;
+    escapeHeld = 0;
+  }
+}
+
+// Monitor → modem, unchanged apart from a "+++" surrounded by silence
+void pumpPassthrough() {
+  uint8_t buf[BRIDGE_CHUNK];
+  uint8_t out[BRIDGE_CHUNK];
+  int avail = Serial.available();
+  while (avail > 0) {
+    size_t n = Serial.read(buf, avail < BRIDGE_CHUNK ? avail : BRIDGE_CHUNK);
+    if (n == 0) {
+      break;
+    }
+    unsigned long now = millis();
+    size_t o = 0;
+    size_t first = 0;
+    if (swallowLf) {
+      swallowLf = false;
+      if (buf[0] == '\n') {
+        first = 1;
+      }
+    }
+    for (size_t i = first; i < n; i++) {
+#if BRIDGE_ESCAPE
+      if (buf[i] == '+' && escapeHeld < 3 &&
+          (escapeHeld > 0 || now - lastHostByteAt >= BRIDGE_ESCAPE_GUARD_MS)) {
+        escapeHeld++;
+        lastHostByteAt = now;
+        continue;
+      }
+      if (escapeHeld > 0) {
+        SIM7600.write(out, o);  // Keep the byte order
+        passBytesIn += o;
+        o = 0;
+        flushEscape();
+      }
+#endif
+      out[o++] = buf[i];
+      lastHostByteAt = now;
+    }
+    SIM7600.write(out, o);
+    passBytesIn += o;
+    avail = Serial.available();
+  }
+
+#if BRIDGE_ESCAPE
+  if (escapeHeld > 0 && millis() - lastHostByteAt >= BRIDGE_ESCAPE_GUARD_MS) {
+    if (escapeHeld == 3) {
+      escapeHeld = 0;
+      leavePassthrough();
+    } else {
+      flushEscape();  // A lone '+' or "++"
+    }
+  }
+#endif
+}
+
+void handleHostLine(char* line) {
+  if (strcmp(line, "~pass") == 0) {
+    enterPassthrough();
+    return;
+  }
+  if (strncmp(line, "~run ", 5) == 0) {
+    scriptStart(line + 5);
+    return;
+  }
+  if (strncmp(line, "~sms ", 5) == 0) {
+    char* number = line + 5;
+    char* text = strchr(number, ' ');
+    if (text == NULL) {
+      Serial.println("Usage: ~sms <number> <text>");
+      return;
+    }
+    *text++ = '\0';
+    Serial.println("\n=== Sending SMS ===");
+    smsStart(number, text);
+    return;
+  }
+
+  if (modemBusy()) {
+    Serial.println("ERROR: SMS / script running - command not sent");
+    return;
+  }
+  Serial.print(">> Sending: ");
+  Serial.println(line);
+  SIM7600.print(line);
+  SIM7600.print("\r\n");
+}
+
+// Monitor input in line mode - never waits for a line to complete
+void pumpHostLines() {
+  uint8_t buf[BRIDGE_CHUNK];
+  int avail = Serial.available();
+  while (avail > 0 && bridgeMode == BRIDGE_LINE) {
+    size_t n = Serial.read(buf, avail < BRIDGE_CHUNK ? avail : BRIDGE_CHUNK);
+    if (n == 0) {
+      break;
+    }
+    for (size_t i = 0; i < n; i++) {
+      char c = (char)buf[i];
+      if (c == '\r' || c == '\n') {
+        // Trim trailing spaces like String::trim() did
+        while (hostLineLen > 0 && hostLine[hostLineLen - 1] == ' ') {
+          hostLineLen--;
+        }
+        hostLine[hostLineLen] = '\0';
+        char* line = hostLine;
+        while (*line == ' ') {
+          line++;
+        }
+        if (*line != '\0') {
+          handleHostLine(line);
+        }
+        hostLineLen = 0;
+        if (bridgeMode == BRIDGE_PASSTHROUGH) {
+          // Rest of the chunk is raw data - minus the '\n' of a CRLF line end
+          size_t rest = i + 1;
+          if (c == '\r') {
+            if (rest < n && buf[rest] == '\n') {
+              rest++;
+            } else if (rest == n) {
+              swallowLf = true;
+            }
+          }
+          SIM7600.write(buf + rest, n - rest);
+          passBytesIn += n - rest;
+          return;
+        }
+      } else if (hostLineLen < sizeof(hostLine) - 1) {
+        hostLine[hostLineLen++] = c;
+      }
+    }
+    avail = Serial.available();
+  }
+}
+
+void loop() {
+  // Bridge mode: Forward commands from Serial to SIM7600
+  if (bridgeActive) {
+    pumpModem();
+    if (bridgeMode == BRIDGE_PASSTHROUGH) {
+      pumpPassthrough();
+    } else {
+      pumpHostLines();
+      smsPoll();
+      scriptPoll();
     }
   }
 }
@@ -207,91 +661,6 @@ void sendATCommand(String command, int timeout) {
   Serial.println(response);
 }
 
-String waitForResponse(int timeout) {
-  long startTime = millis();
-  String response = "";
-  
-  while (millis() - startTime < timeout) {
-    while (SIM7600.available()) {
-      char c = SIM7600.read();
-      response += c;
-      Serial.print(c); // Echo to serial for debugging
-    }
-    
-    // Check if we got the expected prompts
-    if (response.indexOf("OK") != -1 || 
-        response.indexOf("ERROR") != -1 || 
-        response.indexOf(">") != -1) {
-      break;
-    }
-  }
-  
-  return response;
-}
-
-void sendSMS(String number, String message) {
-  // Set SMS to text mode
-  Serial.println("Setting SMS text mode...");
-  SIM7600.println("AT+CMGF=1");
-  String resp1 = waitForResponse(2000);
-  
-  if (resp1.indexOf("OK") == -1) {
-    Serial.println("ERROR: Failed to set text mode");
-    return;
-  }
-  
-  delay(500);
-  
-  // Set character set to GSM
-  Serial.println("Setting character set...");
-  SIM7600.println("AT+CSCS=\"GSM\"");
-  String resp2 = waitForResponse(2000);
-  
-  if (resp2.indexOf("OK") == -1) {
-    Serial.println("ERROR: Failed to set character set");
-    return;
-  }
-  
-  delay(500);
-  
-  // Send SMS command with recipient number
-  Serial.print("Setting recipient: ");
-  Serial.println(number);
-  SIM7600.print("AT+CMGS=\"");
-  SIM7600.print(number);
-  SIM7600.println("\"");
-  
-  // Wait for ">" prompt
-  String resp3 = waitForResponse(5000);
-  
-  if (resp3.indexOf(">") == -1) {
-    Serial.println("ERROR: Did not receive '>' prompt");
-    return;
-  }
-  
-  Serial.println("Got '>' prompt, sending message...");
-  delay(500);
-  
-  // Send the message
-  SIM7600.print(message);
-  delay(100);
-  
-  // Send Ctrl+Z to indicate end of message
-  SIM7600.write(26);
-  Serial.println("Sent Ctrl+Z, waiting for confirmation...");
-  
-  // Wait for confirmation (this may take a while)
-  String resp4 = waitForResponse(10000);
-  
-  if (resp4.indexOf("OK") != -1 || resp4.indexOf("+CMGS") != -1) {
-    Serial.println("\nSUCCESS: SMS sent successfully!");
-  } else if (resp4.indexOf("ERROR") != -1) {
-    Serial.println("\nERROR: Failed to send SMS");
-  } else {
-    Serial.println("\nWARNING: Unclear response - SMS may or may not have been sent");
-  }
-}
-
 bool initDOModules() {
     Serial.println("Initializing MCP23017 modules...");
     
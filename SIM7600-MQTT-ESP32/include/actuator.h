@@ -0,0 +1,73 @@
+#ifndef ACTUATOR_H
+#define ACTUATOR_H
+
+#include <Arduino.h>
+#include "mcp_port.h"
+#include "mqtt_inbox.h"
+#include "task_cores.h"
+
+/* ===============================================================================
+ * ACTUATOR - Low-latency command -> MCP23017 output path
+ * ===============================================================================
+ *
+ * Relay commands take their own short path to the outputs:
+ *
+ *   UartReaderTask  +CMQTTRXSTART -> inbox (timestamped)
+ *   ReceiveTask     +CMQTTRXEND -> router -> actuatorOnMessage() -> queue
+ *   ActuatorTask    one OLATA+OLATB write for the whole port (mcp_port.h)
+ *
+ * Nothing on this path waits for ModemTask, so a publish on the modem
+ * never delays a relay. ActuatorTask runs above every MQTT task and is the
+ * only runtime writer of the MCP23017 - the port value lives in the
+ * McpPort shadow and goes out as one 16-bit transfer, no read-modify-write
+ * per pin.
+ * Commands that queue up while a write is in progress are merged into the
+ * next write.
+ *
+ * Payload: comma-separated "<pin>=<0|1>" or "all=<0|1>", e.g. "3=1,5=0".
+ * Pins outside the allowed mask (PWRKEY) are rejected.
+ *
+ * Firmware-owned outputs on the same port (PWRKEY, driven by modem_power)
+ * go through actuatorDrive(): same queue and write, no mask, no ack and
+ * no latency sample.
+ *
+ * Latency is measured from +CMQTTRXSTART on the UART to the end of the
+ * I2C write and reported in the ack message: "port=0x0028 us=1840".
+ * =============================================================================== */
+
+// ===== Actuator Configuration =====
+#define ACTUATOR_QUEUE_LEN     8
+#define ACTUATOR_MAX_PAYLOAD   64     // Longer command payloads are rejected
+#define ACTUATOR_ACK_QOS       0      // Acks go out on MQTT_CLIENT_CONTROL, skipped while it is down
+
+#define PRIORITY_ACTUATOR      4      // Above the MQTT tasks, below UartReaderTask
+#define STACK_SIZE_ACTUATOR    3072
+#define CORE_ACTUATOR          CORE_APP
+
+/**
+ * @brief Actuator counters (snapshot)
+ */
+struct ActuatorStats {
+  uint16_t port;              // Output state last written
+  uint32_t commands;          // Accepted commands
+  uint32_t writes;            // Port writes (commands can share one)
+  uint32_t rejected;          // Unparsable payloads / reserved pins
+  uint32_t dropped;           // Command queue full
+  uint32_t writeErrors;       // I2C NACKs (retried with the next command)
+  uint32_t lastLatencyUs;     // +CMQTTRXSTART -> output written
+  uint32_t minLatencyUs;
+  uint32_t maxLatencyUs;
+  uint32_t avgLatencyUs;      // Per write
+  uint32_t lastWriteUs;       // I2C transfer alone
+};
+
+// ===== API =====
+bool actuatorInit(McpPort* mcp, uint16_t allowedPins, const char* ackTopic = NULL);
+void actuatorOnMessage(const InboundMsg& msg, void* ctx);  // MqttMessageHandler for the command topic
+bool actuatorSubmit(uint16_t mask, uint16_t value, uint32_t receivedAt);
+bool actuatorDrive(uint16_t mask, uint16_t value);  // Reserved pins (firmware use only)
+void actuatorGetStats(ActuatorStats* stats);
+
+void vActuatorTask(void *pvParameters);
+
+#endif // ACTUATOR_H
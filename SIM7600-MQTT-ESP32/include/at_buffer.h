@@ -0,0 +1,68 @@
+#ifndef AT_BUFFER_H
+#define AT_BUFFER_H
+
+#include <stddef.h>
+#include <string.h>
+
+/* ===============================================================================
+ * AT BUFFER - Fixed-capacity text buffer for the AT layer
+ * ===============================================================================
+ *
+ * Replaces Arduino String concatenation (response += c) in the AT path.
+ * Storage is a plain char array sized at compile time, so a buffer declared
+ * static or global never touches the heap and appending can't fragment it.
+ *
+ * Appends that don't fit are truncated (the text stays NUL-terminated) and
+ * the buffer remembers it overflowed, so callers can tell a partial answer
+ * from a complete one.
+ * =============================================================================== */
+
+template <size_t N>
+class AtBuffer {
+public:
+  AtBuffer() { clear(); }
+
+  void clear() {
+    len_ = 0;
+    overflowed_ = false;
+    data_[0] = '\0';
+  }
+
+  bool append(const char* text, size_t count) {
+    size_t room = N - 1 - len_;
+    bool fits = count <= room;
+    if (!fits) {
+      count = room;
+      overflowed_ = true;
+    }
+    memcpy(data_ + len_, text, count);
+    len_ += count;
+    data_[len_] = '\0';
+    return fits;
+  }
+
+  bool append(const char* text) { return append(text, strlen(text)); }
+  bool append(char c) { return append(&c, 1); }
+
+  // Appends text followed by CRLF, preserving the modem's line structure
+  bool appendLine(const char* text) { return append(text) && append("\r\n", 2); }
+
+  bool contains(const char* needle) const { return strstr(data_, needle) != NULL; }
+  bool startsWith(const char* prefix) const { return strncmp(data_, prefix, strlen(prefix)) == 0; }
+
+  // Pointer to the first occurrence of needle, or NULL (for parsing values)
+  const char* find(const char* needle) const { return strstr(data_, needle); }
+
+  const char* c_str() const { return data_; }
+  size_t length() const { return len_; }
+  size_t capacity() const { return N - 1; }
+  bool empty() const { return len_ == 0; }
+  bool overflowed() const { return overflowed_; }
+
+private:
+  char data_[N];
+  size_t len_;
+  bool overflowed_;
+};
+
+#endif // AT_BUFFER_H
@@ -0,0 +1,114 @@
+#ifndef AT_COMMANDS_H
+#define AT_COMMANDS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "at_buffer.h"
+
+/* ===============================================================================
+ * AT COMMANDS - Compile-time descriptor table for the MQTT command set
+ * ===============================================================================
+ *
+ * One entry per command the MQTT path sends (including the TLS setup in
+ * mqtt_tls.h), fixed at compile time:
+ *
+ *   name      "CMQTTPUB"        metrics key
+ *   prefix    "AT+CMQTTPUB="    static part of the command, length via sizeof
+ *   expect    what answers it - OK, '>' prompt, or OK plus a result line
+ *   result    "+CMQTTPUB: "     prefix of the "<client>,<err>" result line
+ *   timeouts  for the first answer and for the result line
+ *
+ * Commands are built with atCmdStart() / atCmdArg(): the prefix is copied
+ * and numbers are converted by hand, so the publish path never calls
+ * snprintf (newlib's vfprintf alone needs over a kilobyte of stack).
+ * Answers are matched against the descriptor - the result prefix is
+ * compared at the start of the line with its known length, and the error
+ * code is read straight after it (atParseResult) - instead of scanning
+ * every line for a substring.
+ *
+ * The waits that use the table live in the AT engine (atWaitPrompt,
+ * atWaitOk, atWaitResult in at_engine.h).
+ * =============================================================================== */
+
+enum AtCmdId : uint8_t {
+  AT_CMD_CMQTTACCQ,
+  AT_CMD_CMQTTCFG,
+  AT_CMD_CMQTTREL,
+  AT_CMD_CMQTTCONNECT,
+  AT_CMD_CMQTTDISC,
+  AT_CMD_CMQTTSUBTOPIC,
+  AT_CMD_CMQTTSUB,
+  AT_CMD_CMQTTTOPIC,
+  AT_CMD_CMQTTPAYLOAD,
+  AT_CMD_CMQTTPUB,
+  AT_CMD_CMQTTSSLCFG,
+  AT_CMD_CSSLCFG,
+  AT_CMD_CCERTDOWN,
+  AT_CMD_COUNT,
+};
+
+enum AtExpect : uint8_t {
+  AT_EXPECT_OK,       // Final OK
+  AT_EXPECT_PROMPT,   // '>', then exactly the announced bytes, then OK
+  AT_EXPECT_RESULT,   // OK, later "+NAME: <client>,<err>"
+};
+
+struct AtCommand {
+  AtCmdId id;
+  const char* name;
+  const char* prefix;
+  uint8_t prefixLen;
+  AtExpect expect;
+  const char* result;       // "" when the command has no result line
+  uint8_t resultLen;
+  uint32_t timeoutMs;       // First answer: OK, or the '>' prompt
+  uint32_t resultMs;        // OK after the prompted bytes, or the result line
+};
+
+// Defined in at_commands.cpp, indexed by AtCmdId
+extern const AtCommand AT_COMMANDS[AT_CMD_COUNT];
+
+inline const AtCommand& atCommand(AtCmdId id) { return AT_COMMANDS[id]; }
+
+// "+NAME: <client>,<err>" for this command? Fills client / err when it is
+bool atParseResult(AtCmdId id, const char* line, int* client, int* err);
+
+// ===== Building =====
+#define AT_CMD_MAX       64   // Numeric-only commands (publish / subscribe path)
+#define AT_CMD_TEXT_MAX  300  // Commands carrying strings (client ID, broker URL, credentials)
+
+// Start a command: copies the static prefix ("AT+CMQTTPUB=")
+template <size_t N>
+void atCmdStart(AtBuffer<N>& out, AtCmdId id) {
+  out.clear();
+  out.append(AT_COMMANDS[id].prefix, AT_COMMANDS[id].prefixLen);
+}
+
+// Next argument - a comma first unless it is the first one
+template <size_t N>
+void atCmdArg(AtBuffer<N>& out, uint32_t value) {
+  char digits[10];
+  uint8_t n = 0;
+  do {
+    digits[n++] = (char)('0' + value % 10);
+    value /= 10;
+  } while (value > 0);
+  if (out.c_str()[out.length() - 1] != '=') {
+    out.append(',');
+  }
+  while (n > 0) {
+    out.append(digits[--n]);
+  }
+}
+
+template <size_t N>
+void atCmdArgQuoted(AtBuffer<N>& out, const char* text) {
+  if (out.c_str()[out.length() - 1] != '=') {
+    out.append(',');
+  }
+  out.append('"');
+  out.append(text);
+  out.append('"');
+}
+
+#endif // AT_COMMANDS_H
@@ -0,0 +1,103 @@
+#ifndef AT_ENGINE_H
+#define AT_ENGINE_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include "at_buffer.h"
+#include "at_commands.h"
+#include "at_parser.h"
+#include "at_uart.h"
+#include "task_cores.h"
+
+/* ===============================================================================
+ * AT ENGINE - UART reader task + line dispatcher
+ * ===============================================================================
+ *
+ * The UartReaderTask is the ONLY code that reads the SIM7600 UART. It runs on
+ * the ESP-IDF UART driver event queue: the driver's pattern detector raises an
+ * event on every '\n', and the RX idle timeout raises one for the '>' prompt
+ * (which has no newline). Between events the task is blocked and costs no CPU.
+ * The byte stream is split into lines by the parser (at_parser.h, no
+ * Arduino code - also built natively for tests), straight into a fixed ring of
+ * line slots, and a reference to each line is routed into one of the queues:
+ *
+ * - Response queue: solicited results (OK, ERROR, +CMQTTCONNECT: 0,0, '>' ...)
+ *   consumed by whichever task is currently running an AT command
+ * - URC queue: +CMQTTRX* header lines, +CMQTTCONNLOST, +CMQTTNONET
+ *   consumed by ReceiveTask. The topic / payload bytes of a received message
+ *   are not lines: the reader counts them off by the lengths in
+ *   +CMQTTRXTOPIC / +CMQTTRXPAYLOAD and moves them from the driver straight
+ *   into the inbox (mqtt_inbox.h)
+ * - Publish ack queues (one per MQTT client): +CMQTTPUB: <client>,<err>
+ *   results, which arrive long after the command's OK, consumed by that
+ *   client's PublishTask
+ *
+ * URCs that arrive in the middle of a publish are therefore never mixed into
+ * the command's response. Waiting callers block on a queue - nothing polls.
+ * Only ModemTask (modem.h) writes to the UART; reading lines never needs it.
+ * The driver itself sits behind at_uart.h, so the native tests run this
+ * file unchanged against the SIM7600 simulator.
+ *
+ * Every line taken from a queue MUST be handed back with atReleaseLine().
+ *
+ * Nothing here allocates: lines live in the static ring and the text of the
+ * current command's answer is collected in one static AtResponse buffer.
+ * =============================================================================== */
+
+// ===== AT Engine Configuration =====
+#define AT_LINE_SLOTS          48    // Line ring size (> all queue depths combined)
+#define AT_RESPONSE_QUEUE_LEN  12    // Solicited lines waiting for the command caller
+#define AT_URC_QUEUE_LEN       16    // URC lines waiting for ReceiveTask
+#define AT_PUBACK_QUEUE_LEN    8     // +CMQTTPUB results waiting per client
+#define AT_RX_CHUNK            128   // Bytes moved from driver to parser per read
+#define AT_RESPONSE_MAX        1024  // Text kept for one command's answer
+
+/**
+ * @brief A received line, living in the line ring until released
+ */
+struct AtLine {
+  const char* text;  // NUL-terminated, without CR/LF
+  uint16_t len;      // strlen(text)
+  uint8_t slot;      // Ring slot index (for atReleaseLine)
+};
+
+typedef AtBuffer<AT_RESPONSE_MAX> AtResponse;
+
+// ===== Lifecycle =====
+bool atEngineInit();     // Create queues - call from setup() before creating tasks
+void atEngineDrain();    // Feed every buffered UART byte to the parser (reader only)
+void atEngineRxLost();   // Received bytes were lost - drop the partial line / message
+
+// ===== Line Access =====
+bool atNextResponseLine(AtLine* line, TickType_t wait);
+bool atNextUrcLine(AtLine* line, TickType_t wait);
+bool atNextPubAck(uint8_t client, AtLine* line, TickType_t wait);
+void atReleaseLine(const AtLine& line);
+void atFlushResponses();   // Drop stale solicited lines before a new command
+uint32_t atDroppedLines(); // Lines lost because a queue or the ring was full
+uint32_t atRxOverflows();  // UART FIFO / driver buffer overflows
+uint32_t atTxBytes();      // Bytes written to the modem since boot
+uint32_t atRxBytes();      // Bytes read from the modem since boot
+
+// ===== UART Writes (ModemTask only) =====
+void atWrite(const char* data, size_t len);
+void atWrite(const char* text);          // Raw text, e.g. topic after '>'
+void atWriteLine(const char* text);      // Text + CRLF, e.g. an AT command
+
+// ===== AT Commands (ModemTask only) =====
+const AtResponse& sendATCommand(const char* command, unsigned long timeout = 2000);
+bool waitForResponse(const char* expected, unsigned long timeout);
+const AtResponse& atResponse();  // Lines collected by the last call above
+
+// ===== Table-Driven Commands (ModemTask only) =====
+// Timeouts come from the command's AT_COMMANDS entry; the lines seen are
+// left in atResponse() like waitForResponse() does. All waits see whole
+// lines only, so a result is never judged before its CRLF ("+CMQTTPUB: 0,"
+// with the error code still on the wire).
+bool atWaitPrompt(AtCmdId id);                 // '>' within timeoutMs
+bool atWaitOk(AtCmdId id, bool afterData);     // OK within timeoutMs, or resultMs after prompted bytes
+int atWaitResult(AtCmdId id, uint8_t client);  // <err> of "+NAME: <client>,<err>", -1 if none
+
+#endif // AT_ENGINE_H
@@ -0,0 +1,90 @@
+#ifndef AT_PARSER_H
+#define AT_PARSER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* ===============================================================================
+ * AT PARSER - Modem byte stream -> classified lines
+ * ===============================================================================
+ *
+ * The protocol half of the AT engine, with no Arduino, FreeRTOS or UART
+ * code in it, so the same parser runs in UartReaderTask and in the native
+ * test build (pio test -e native) against the SIM7600 simulator.
+ *
+ * Bytes go in with atParserFeed() in chunks of any size. Every complete line
+ * is handed to the sink, tagged:
+ *
+ * - AT_LINE_RESPONSE: solicited results (OK, ERROR, +CSQ: ..., '>' prompt)
+ * - AT_LINE_URC:      +CMQTTRX* headers, +CMQTTCONNLOST, +CMQTTNONET
+ * - AT_LINE_PUBACK:   +CMQTTPUB: <client>,<err> with a valid client index
+ *
+ * The topic / payload bytes of a received message are not lines: after
+ * +CMQTTRXTOPIC / +CMQTTRXPAYLOAD they are counted off by the announced
+ * length and written through the sink's rx callbacks, so binary payloads
+ * with CR/LF inside arrive intact.
+ *
+ * Lines are assembled directly in buffers the sink provides (acquire), so
+ * the engine's line ring is filled without a copy. A line that gets no
+ * buffer is dropped up to its '\n' and counted.
+ *
+ * One parser instance per byte stream; not thread-safe.
+ * =============================================================================== */
+
+// ===== Parser Configuration =====
+#define AT_LINE_MAX      256   // Longest line kept (longer lines are split)
+#define AT_MQTT_CLIENTS  2     // MQTT client slots in the SIM7600
+
+enum AtLineKind : uint8_t {
+  AT_LINE_RESPONSE,
+  AT_LINE_URC,
+  AT_LINE_PUBACK,
+};
+
+enum AtRawPart : uint8_t {
+  AT_RAW_TOPIC,
+  AT_RAW_PAYLOAD,
+};
+
+/**
+ * @brief Where parsed output goes - rx callbacks may be NULL
+ */
+struct AtParserSink {
+  void* ctx;
+  char* (*acquire)(void* ctx);  // AT_LINE_MAX + 1 bytes for the next line, NULL = drop it
+  void (*line)(void* ctx, char* text, uint16_t len, AtLineKind kind, uint8_t client);
+
+  // Body of a +CMQTTRXSTART ... +CMQTTRXEND block
+  void (*rxBegin)(void* ctx, uint8_t client, uint16_t topicLen, uint32_t payloadLen);
+  uint8_t* (*rxWritePtr)(void* ctx, AtRawPart part, size_t* room);
+  void (*rxAdvance)(void* ctx, AtRawPart part, size_t n);
+  void (*rxEnd)(void* ctx);     // Before the +CMQTTRXEND line itself is delivered
+  void (*rxAbort)(void* ctx);   // atParserReset() in the middle of a message
+};
+
+struct AtParser {
+  AtParserSink sink;
+  char* buf;                // Line being assembled, NULL until its first byte
+  uint16_t len;
+  bool skipping;            // No buffer for this line - drop it up to '\n'
+  bool inRxMessage;         // Between +CMQTTRXSTART and +CMQTTRXEND
+  uint32_t rawRemaining;    // Topic / payload bytes still expected
+  AtRawPart rawPart;
+  uint32_t lines;           // Lines delivered
+  uint32_t dropped;         // Lines that got no buffer
+};
+
+// ===== API =====
+void atParserInit(AtParser* parser, const AtParserSink* sink);
+void atParserFeed(AtParser* parser, const uint8_t* data, size_t len);
+void atParserReset(AtParser* parser);  // Bytes were lost: drop the partial line and message
+
+// Raw topic / payload bytes can also be read straight into the sink's buffer
+uint8_t* atParserRawWritePtr(AtParser* parser, size_t* room);  // NULL when none are expected
+void atParserRawAdvance(AtParser* parser, size_t n);           // n bytes written there
+
+// ===== Line Helpers =====
+bool atIsFinalResult(const char* text);  // OK / ERROR / +CME ERROR / +CMS ERROR
+bool atIsUrc(const char* text);
+
+#endif // AT_PARSER_H
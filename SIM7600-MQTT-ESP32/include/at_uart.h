@@ -0,0 +1,56 @@
+#ifndef AT_UART_H
+#define AT_UART_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+/* ===============================================================================
+ * AT UART - Byte transport under the AT engine
+ * ===============================================================================
+ *
+ * The AT engine (at_engine.h) never calls the UART driver itself. It moves
+ * bytes through the three atPort*() functions below and is fed by
+ * atEngineDrain() whenever bytes have arrived:
+ *
+ *   src/at_uart.cpp       ESP-IDF UART driver, pin / baud / RTS-CTS setup
+ *                         and the UartReaderTask that calls atEngineDrain()
+ *   test/host/sim_port.h  The SIM7600 simulator (test/sim) for the native
+ *                         tests, which drain on their virtual clock
+ *
+ * atPortRead() and atPortBuffered() are called from the drain only
+ * (UartReaderTask); atPortWrite() and the setup functions from ModemTask
+ * only.
+ * =============================================================================== */
+
+// ===== UART Configuration =====
+#define AT_UART_NUM            UART_NUM_1
+#define AT_UART_RX_BUFFER      4096  // IDF driver ring buffer (bytes) - ~40 ms at 921600
+#define AT_UART_RTS_THRESH     100   // FIFO bytes before RTS is deasserted (FIFO is 128)
+#define AT_UART_TX_BUFFER      1024  // 0 would make writes block until sent
+#define AT_UART_EVENT_QUEUE_LEN 20
+#define AT_UART_PATTERN_QUEUE_LEN 32 // Max '\n' positions the driver remembers
+#define AT_UART_PIN_KEEP       -1    // UART_PIN_NO_CHANGE
+
+#define PRIORITY_UART_READER   5     // Above everything - never let the UART overflow
+#define STACK_SIZE_UART_READER 3072
+#define CORE_UART_READER       CORE_MODEM_IO
+
+extern TaskHandle_t xUartReaderTaskHandle;
+
+// ===== Lifecycle (src/at_uart.cpp) =====
+bool atUartBegin(uint32_t baud, int rxPin, int txPin);  // Install driver, start reader (retry-safe)
+bool atUartSetBaud(uint32_t baud);       // Change rate, drop bytes received at the old one
+bool atUartSetFlowControl(bool enable, int rtsPin = AT_UART_PIN_KEEP,
+                          int ctsPin = AT_UART_PIN_KEEP);  // RTS/CTS on our side
+uint32_t atUartBaud();
+bool atUartFlowControl();
+void vUartReaderTask(void *pvParameters);
+
+// ===== Port =====
+size_t atPortBuffered();                          // Bytes received and not read yet
+size_t atPortRead(uint8_t* dst, size_t len);      // Up to len of them, never blocks
+void atPortWrite(const uint8_t* data, size_t len);
+
+#endif // AT_UART_H
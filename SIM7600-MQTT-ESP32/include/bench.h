@@ -0,0 +1,91 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <Arduino.h>
+#include "mqtt_inbox.h"
+#include "msg_pool.h"
+#include "task_cores.h"
+
+/* ===============================================================================
+ * BENCH - On-device publish throughput benchmark
+ * ===============================================================================
+ *
+ * Replaces eyeballing Msg#N in the serial monitor with repeatable numbers.
+ * A run sweeps the cases in BENCH_CASES - publish rate, sample size, QoS
+ * and samples per publish (batching factor) - on the telemetry client. Each
+ * case generates samples for BENCH_STEP_MS, then waits up to BENCH_DRAIN_MS
+ * for the last results. Per case it records:
+ *
+ *   - offered and achieved samples/s and publishes/s
+ *   - p50 / p99 / max latency, mqttPublishAsync() -> +CMQTTPUB: <c>,0
+ *   - loss: samples generated but not confirmed (rejected, failed, or still
+ *     outstanding after the drain)
+ *
+ * Results are matched through the publish result hook (mqtt_publish.h);
+ * every sample carries its case number, so results from an earlier case -
+ * or replayed from the offline store - are never counted twice.
+ *
+ * Start a run:
+ *   - Send "start" to the bench command topic ("stop" aborts), or
+ *   - Build with -DBENCH_AUTOSTART=1 to run once after the first connect
+ *
+ * TelemetryTask pauses while a run is active. The summary is printed as a
+ * table and published as one JSON document to the result topic on the
+ * control client.
+ * =============================================================================== */
+
+// ===== Bench Configuration =====
+#ifndef BENCH_AUTOSTART
+#define BENCH_AUTOSTART    0
+#endif
+#define BENCH_STEP_MS      30000   // Load phase per case
+#define BENCH_DRAIN_MS     15000   // Wait for outstanding results
+#define BENCH_MAX_SAMPLES  1024    // Latencies kept per case (later ones are only counted)
+
+// { rate Hz, sample bytes, QoS, samples per publish }
+#ifndef BENCH_CASES
+#define BENCH_CASES { \
+  { 1, 32, 1, 1 },    { 2, 32, 1, 1 },    { 5, 32, 1, 1 },    { 5, 32, 0, 1 }, \
+  { 10, 32, 1, 10 },  { 20, 32, 1, 10 },  { 20, 32, 1, 20 },  { 5, 256, 1, 1 }, \
+  { 10, 256, 1, 3 },  { 2, 1000, 1, 1 }, \
+}
+#endif
+
+#define PRIORITY_BENCH     1
+#define STACK_SIZE_BENCH   4096
+#define CORE_BENCH         CORE_APP
+
+struct BenchCase {
+  uint16_t rateHz;
+  uint16_t sampleBytes;
+  uint8_t qos;
+  uint8_t batch;
+};
+
+/**
+ * @brief Outcome of one case
+ */
+struct BenchResult {
+  BenchCase config;
+  uint32_t generated;       // Samples produced
+  uint32_t delivered;       // Samples confirmed by +CMQTTPUB: <c>,0
+  uint32_t publishes;       // Confirmed publishes
+  uint32_t failed;          // Samples in publishes given up on
+  uint32_t elapsedMs;       // First sample -> last result
+  uint32_t msgsPerSecX10;   // Confirmed samples per second, x10
+  uint32_t p50Ms;
+  uint32_t p99Ms;
+  uint32_t maxMs;
+  bool skipped;             // batch x sampleBytes exceeds MSG_PAYLOAD_MAX
+};
+
+// ===== API =====
+void benchInit(const char* topic, const char* resultTopic);  // Call from setup()
+bool benchStart();     // false if a run is already active
+void benchStop();
+bool benchRunning();
+void benchOnMessage(const InboundMsg& msg, void* ctx);  // MqttMessageHandler: "start" / "stop"
+
+void vBenchTask(void *pvParameters);
+
+#endif // BENCH_H
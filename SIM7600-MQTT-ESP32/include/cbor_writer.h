@@ -0,0 +1,38 @@
+#ifndef CBOR_WRITER_H
+#define CBOR_WRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* ===============================================================================
+ * CBOR WRITER - Minimal RFC 8949 encoder into a caller-owned buffer
+ * ===============================================================================
+ *
+ * Only what telemetry needs: unsigned/negative integers, byte and text
+ * strings, arrays and maps of known length, booleans and null. Every value
+ * uses the shortest head encoding, so small numbers cost a single byte.
+ *
+ * Writes past the end of the buffer are dropped and set 'overflow'; check it
+ * (or the return value of cborOk()) once after encoding a whole record.
+ * =============================================================================== */
+
+struct CborWriter {
+  uint8_t* buf;
+  size_t cap;
+  size_t len;
+  bool overflow;
+};
+
+void cborInit(CborWriter* w, uint8_t* buf, size_t cap);
+void cborWriteUint(CborWriter* w, uint64_t value);
+void cborWriteInt(CborWriter* w, int64_t value);
+void cborWriteBytes(CborWriter* w, const uint8_t* data, size_t len);
+void cborWriteText(CborWriter* w, const char* text);
+void cborWriteArray(CborWriter* w, size_t count);  // Followed by 'count' items
+void cborWriteMap(CborWriter* w, size_t pairs);    // Followed by 2*'pairs' items
+void cborWriteBool(CborWriter* w, bool value);
+void cborWriteNull(CborWriter* w);
+
+inline bool cborOk(const CborWriter* w) { return !w->overflow; }
+
+#endif // CBOR_WRITER_H
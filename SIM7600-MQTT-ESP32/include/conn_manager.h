@@ -0,0 +1,153 @@
+#ifndef CONN_MANAGER_H
+#define CONN_MANAGER_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "task_cores.h"
+
+/* ===============================================================================
+ * CONNECTION MANAGER - Modem / network / MQTT bring-up state machine
+ * ===============================================================================
+ *
+ * ConnectionTask owns the path from a silent modem to a subscribed MQTT
+ * session. It never exits. Each state sends its command(s) and advances as
+ * soon as the modem gives the expected answer - there are no fixed sleeps:
+ *
+ *   UART → MODEM → SIM → REG → PDP → MQTT_START → ACCQ → CONNECT → SUBSCRIBE → READY
+ *
+ * - MODEM:      AT answers OK (echo off, module info), then RTS/CTS and the
+ *               baud upshift are negotiated (see UART RATE below)
+ * - SIM:        AT+CPIN? reports READY
+ * - REG:        AT+CREG? reports home (,1) or roaming (,5)
+ * - PDP:        APN configured, AT+CGATT? reports 1 (packet domain attached)
+ * - MQTT_START: stale service stopped / clients released, CA certificate and
+ *               SSL context for TLS clients (mqtt_tls.h), AT+CMQTTSTART
+ * - ACCQ:       every configured client acquired (mqtt_client.h)
+ * - CONNECT:    +CMQTTCONNECT: <client>,0 for the telemetry client
+ * - SUBSCRIBE:  every mqttSubscribe() filter (mqtt_router.h), batched per
+ *               connected client; a batch without its '>' / OK / result
+ *               is retried like any failed state
+ *
+ * States that wait for the network (REG, PDP) re-poll on a short interval
+ * until their deadline. A state that fails is retried after a jittered
+ * exponential backoff; after CONN_STATE_RETRIES failures the machine falls
+ * back one tier (MQTT states → MQTT_START, network states → MODEM).
+ * Each state step is one request to ModemTask (modem.h), so other tasks'
+ * commands interleave with the bring-up.
+ *
+ * In READY the task sets mqttConnected, calls the onReady hook and sleeps.
+ *
+ * RECONNECT: ReceiveTask reports +CMQTTCONNLOST / +CMQTTNONET through
+ * connNotifyLinkLost(), which clears the connection flags at once and wakes
+ * the task:
+ *
+ * - +CMQTTCONNLOST: <client>,<cause> → resume at MQTT_START
+ * - +CMQTTNONET                       → resume at REG
+ *
+ * POWER: modem_power.h parks the machine with connSuspend() before the
+ * modem goes to PSM or is switched off - every client is marked down at
+ * once and the task waits in OFF. connResume() starts again at MODEM.
+ *
+ * On the way back MQTT_START asks AT+CMQTTACCQ? first. If the service is
+ * still running and every client is still acquired, STOP / REL / START /
+ * ACCQ are skipped and the machine goes straight to CONNECT. The first
+ * reconnect attempt is immediate; backoff only applies to failures.
+ *
+ * WARM START: an ESP32 reset often leaves the modem up. The first time
+ * MODEM gets an answer after boot, the record from the last READY
+ * (warm_start.h) is checked against the modem:
+ *
+ * - APN unchanged and AT+CGATT? reports 1        → skip SIM / REG / PDP
+ * - broker settings unchanged, and every client
+ *   still in AT+CMQTTCONNECT? on its broker      → resume at SUBSCRIBE
+ * - clients still acquired (AT+CMQTTACCQ?)       → resume at CONNECT
+ * - otherwise                                    → resume at MQTT_START
+ *
+ * ATI is skipped on a warm resume; echo, RTS/CTS, the upshift check and
+ * onModemUp always run. Anything that doesn't match runs the full path.
+ *
+ * UART RATE: the modem is probed at the current rate (the last known one
+ * after a reset), then at the configured rate and upshiftBaud (where an
+ * earlier boot left it). If none answers, the
+ * rates of the AT-BASICS sketch's scan are tried in turn. Once the modem
+ * answers:
+ *
+ * 1. RTS/CTS (rtsPin/ctsPin >= 0): AT+IFC=2,2, then our side follows
+ * 2. AT+IPR=<upshiftBaud> switches for this session only, our side follows
+ *    and the link is verified with AT probes
+ * 3. Verified: AT+IPREX=<upshiftBaud> makes it permanent
+ *    Not verified: back to the old rate, no further upshift until reboot
+ * =============================================================================== */
+
+// ===== Connection Configuration =====
+#define CONN_BACKOFF_BASE_MS    2000   // First retry delay after a failure
+#define CONN_BACKOFF_MAX_MS     120000 // Backoff ceiling
+#define CONN_STATE_RETRIES      3      // Failures before falling back one tier
+#define CONN_MODEM_PROBES       20     // "AT" attempts while the module boots
+#define CONN_REG_TIMEOUT_MS     60000  // Network registration deadline
+#define CONN_ATTACH_TIMEOUT_MS  30000  // Packet domain attach deadline
+#define CONN_POLL_MS            1000   // Re-poll interval for REG / PDP
+#define CONN_START_TIMEOUT_MS   5000   // +CMQTTSTART: <err>
+#define CONN_BAUD_VERIFY_PROBES 5      // "AT" attempts at a new rate before giving up on it
+
+#define PRIORITY_CONNECTION     4      // Above publish/receive - bring-up runs first
+#define STACK_SIZE_CONNECTION   3072   // Steps run on ModemTask's stack
+#define CORE_CONNECTION         CORE_MODEM_IO
+
+enum ConnState : uint8_t {
+  CONN_UART,
+  CONN_MODEM,
+  CONN_SIM,
+  CONN_REG,
+  CONN_PDP,
+  CONN_MQTT_START,
+  CONN_ACCQ,
+  CONN_CONNECT,
+  CONN_SUBSCRIBE,
+  CONN_READY,
+  CONN_OFF,         // Suspended by connSuspend() - modem asleep or powered off
+};
+
+/**
+ * @brief Everything the state machine needs from the application
+ */
+struct ConnConfig {
+  // Modem UART
+  uint32_t baud;            // Rate the modem is expected at after power-up
+  int rxPin;
+  int txPin;
+  uint32_t upshiftBaud;     // Negotiated after MODEM answers (0 = stay at baud)
+  int rtsPin;               // RTS/CTS flow control, -1 = not wired
+  int ctsPin;
+
+  // Packet data
+  const char* apn;
+  const char* apnUser;      // NULL or "" for no authentication
+  const char* apnPassword;
+
+  void (*onModemUp)();      // Run on ModemTask once MODEM answers, on every boot (may be NULL)
+  void (*onReady)();        // Called from ConnectionTask on every READY (may be NULL)
+};
+
+// Defined in main.cpp
+extern bool mqttConnected;
+
+extern TaskHandle_t xConnectionTaskHandle;
+
+// ===== API =====
+void connInit(const ConnConfig* config);  // Call from setup() before creating the task
+ConnState connGetState();
+const char* connStateName(ConnState state);
+uint32_t connReconnectCount();  // Recoveries started since boot
+
+// Report a lost link (from URCs): client index for +CMQTTCONNLOST, -1 for +CMQTTNONET
+void connNotifyLinkLost(int client);
+
+// Power management (modem_power.h)
+void connSuspend();  // Mark every client down, park in OFF after the current step
+void connResume();   // Leave OFF - bring-up starts again at MODEM
+
+void vConnectionTask(void *pvParameters);
+
+#endif // CONN_MANAGER_H
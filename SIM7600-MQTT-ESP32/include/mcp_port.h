@@ -0,0 +1,58 @@
+#ifndef MCP_PORT_H
+#define MCP_PORT_H
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <Adafruit_MCP23X17.h>
+
+/* ===============================================================================
+ * MCP PORT - Shadow-register access to an MCP23017
+ * ===============================================================================
+ *
+ * Adafruit_MCP23X17::pinMode() / digitalWrite() read-modify-write one
+ * register per call - two I2C transactions per pin. Here IODIR and OLAT
+ * are cached in RAM: pin and mask updates only change the shadow, and
+ * mcpPortFlush() writes both ports in one transaction, only when something
+ * changed.
+ *
+ *   mcpPortBegin(&port, 0x27);
+ *   mcpPortSetDirection(&port, 0xFFFF, 0x0000);  // All outputs, all LOW - 2 transactions
+ *   mcpPortSet(&port, 0x0028, 0x0008);           // Shadow only
+ *   mcpPortFlush(&port);                         // One OLATA+OLATB write
+ *
+ * begin_I2C() from the Adafruit driver probes and sets up the device; the
+ * register writes go out on the bus directly, since the driver has no
+ * multi-register write. The shadow is the source of truth - the device is
+ * never read back, so nothing else may write its OLAT/GPIO registers.
+ *
+ * I2C CLOCK: mcpPortBegin() sets the bus to MCP_I2C_CLOCK_HZ (the MCP23017
+ * is rated for 1.7 MHz). 1 MHz needs short wires and strong pull-ups
+ * (~2.2 kOhm); stay at 400 kHz if other devices on the bus are slower.
+ *
+ * No lock: one task owns a port at runtime (ActuatorTask for mcpDO_1).
+ * =============================================================================== */
+
+// ===== I2C Configuration =====
+#ifndef MCP_I2C_CLOCK_HZ
+#define MCP_I2C_CLOCK_HZ 400000  // 100000 / 400000 / 1000000
+#endif
+
+struct McpPort {
+  Adafruit_MCP23X17 dev;
+  TwoWire* wire;
+  uint8_t addr;
+  uint16_t outputs;     // Shadow of IODIR, inverted: 1 = output
+  uint16_t latch;       // Shadow of OLAT (GPIOB << 8 | GPIOA)
+  uint16_t written;     // Last latch value on the device
+  uint32_t writes;      // Port transactions since boot
+};
+
+// ===== API =====
+bool mcpPortBegin(McpPort* port, uint8_t addr, TwoWire* wire = &Wire);
+bool mcpPortSetDirection(McpPort* port, uint16_t outputs, uint16_t initial);  // Latch first, then IODIR
+void mcpPortSet(McpPort* port, uint16_t mask, uint16_t value);  // Shadow only
+void mcpPortWritePin(McpPort* port, uint8_t pin, bool high);   // Shadow only
+bool mcpPortFlush(McpPort* port);                              // One transaction if the latch changed, false on NACK
+uint16_t mcpPortLatch(const McpPort* port);
+
+#endif // MCP_PORT_H
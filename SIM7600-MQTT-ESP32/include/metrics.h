@@ -0,0 +1,87 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include "mqtt_client.h"
+#include "task_cores.h"
+
+/* ===============================================================================
+ * METRICS - Latency histograms and link counters, published over MQTT
+ * ===============================================================================
+ *
+ * Recorded where the time is spent:
+ *   - AT round trip per command name (sendATCommand, publish steps)
+ *   - Publish latency per client: mqttPublishAsync() -> +CMQTTPUB: <c>,0
+ *   - Wait in the modem request queue (modem.h) and how often it was full
+ *   - Deepest publish queue per client
+ *   - UART bytes each way, reconnects, pool and inbox pressure
+ *   - Load per CPU core: an idle hook (metricsInit) times every WFI sleep
+ *
+ * MetricsTask publishes one compact JSON document to the metrics topic
+ * every METRICS_INTERVAL_MS on the telemetry client (QoS 0):
+ *
+ *   {"up":3600,"s":60,"rc":1,"tx":18234,"rx":40211,
+ *    "at":{"CSQ":[1,42,50,42],"CMQTTPUB":[58,31,50,74]},
+ *    "pub":[[58,210,200,500,730,[0,0,0,3,49,6,0,0,0,0]],[0,0,0,0,0,[...]]],
+ *    "mtx":[61,4,10,80,0,[...]],"q":[3,0],"pool":[2,7],"in":[0,0],"cpu":[9,31]}
+ *
+ *   at:   name: [count, avg ms, p99 ms, max ms]
+ *   pub:  per client [count, avg, p50, p99, max, buckets]
+ *   mtx:  modem queue wait [count, avg, p99, max, rejected, buckets]
+ *   q:    deepest publish queue per client, pool: [in use, high water],
+ *   in:   inbox [dropped, unhandled], cpu: busy % per core (-1 = unknown)
+ *
+ * Bucket upper bounds (ms): METRICS_BUCKET_BOUNDS, last bucket open-ended.
+ * Percentiles are the upper bound of the bucket they fall in.
+ *
+ * Histograms and queue depths cover one interval ("s" seconds) and restart
+ * after each publish; byte and reconnect counters run since boot. While the
+ * telemetry client is down nothing is published and the interval grows.
+ * =============================================================================== */
+
+// ===== Metrics Configuration =====
+#ifndef METRICS_INTERVAL_MS
+#define METRICS_INTERVAL_MS   60000
+#endif
+#define METRICS_AT_COMMANDS   16     // Distinct command names per interval
+#define METRICS_AT_NAME_MAX   15     // "CMQTTCONNECT" etc., "AT+" stripped
+#define METRICS_BUCKETS       10
+#define METRICS_BUCKET_BOUNDS { 10, 20, 50, 100, 200, 500, 1000, 2000, 5000 }
+#define METRICS_LOAD_UNKNOWN  255
+
+#define PRIORITY_METRICS      1
+#define STACK_SIZE_METRICS    4096
+#define CORE_METRICS          CORE_APP
+
+/**
+ * @brief Latency histogram in milliseconds
+ */
+struct MetricsHist {
+  uint32_t count;
+  uint32_t sumMs;
+  uint32_t maxMs;
+  uint32_t bucket[METRICS_BUCKETS];
+};
+
+// ===== Lifecycle =====
+bool metricsInit();   // Install the per-core idle hooks - call from setup()
+
+// ===== Histograms =====
+void metricsHistAdd(MetricsHist* hist, uint32_t ms);
+uint32_t metricsHistPercentile(const MetricsHist* hist, uint8_t pct);  // Bucket upper bound
+
+// ===== Recording (any task) =====
+void metricsRecordAt(const char* command, uint32_t ms);  // Full command text or name
+void metricsRecordPublish(uint8_t client, uint32_t ms);
+void metricsRecordQueueDepth(uint8_t client, uint32_t depth);
+void metricsRecordModemWait(uint32_t ms, bool served);  // served = false: queue stayed full
+
+// ===== Reporting =====
+uint8_t metricsCoreLoad(uint8_t core);  // Busy % this interval so far, METRICS_LOAD_UNKNOWN if not measured
+size_t metricsFormat(char* buf, size_t cap);  // JSON for the interval so far, then restart it
+bool metricsPublish(const char* topic);
+
+void vMetricsTask(void *pvParameters);  // pvParameters = metrics topic (const char*)
+
+#endif // METRICS_H
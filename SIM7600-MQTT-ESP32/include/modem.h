@@ -0,0 +1,117 @@
+#ifndef MODEM_H
+#define MODEM_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+#include "at_engine.h"
+#include "task_cores.h"
+
+/* ===============================================================================
+ * MODEM - Single owner of the SIM7600 command channel
+ * ===============================================================================
+ *
+ * ModemTask is the only task that writes to the modem. Every other task
+ * hands it a typed request through one command queue and sleeps on a
+ * direct-to-task notification until the answer is ready:
+ *
+ * - MODEM_REQ_AT:   one AT command; OK / ERROR and the first information
+ *                   line are copied back to the caller
+ * - MODEM_REQ_CALL: a job (function + argument) that runs a whole sequence
+ *                   on ModemTask - one connection state step, or the
+ *                   TOPIC / PAYLOAD / PUB staging of one publish - so
+ *                   nothing else interleaves with it
+ *
+ * Requests are served in order, one at a time. Urgent requests (control
+ * client publishes) go to the front of the queue. Because callers never
+ * hold a lock, a low-priority task in the middle of a publish can't block a
+ * higher-priority one: ModemTask runs at a fixed priority and every caller
+ * only waits for its own turn.
+ *
+ * The caller's wait only times out while the request is still queued.
+ * Once ModemTask has taken it, the caller waits for the reply - every job
+ * is bounded by its own AT timeouts - so a late reply can never reach a
+ * caller that has given up.
+ *
+ * The reply is bit MODEM_NOTIFY_DONE of the caller's notification value.
+ * Tasks that also count notifications (xTaskNotifyGive / ulTaskNotifyTake)
+ * keep working; the bit is cleared when the reply is consumed.
+ *
+ * Code already running on ModemTask (inside a job) calls the AT engine
+ * directly; modemCall() / modemAt() from there run inline.
+ *
+ * With DTR sleep enabled (modem_power.h) ModemTask raises DTR once the
+ * queue has been idle for a while and wakes the modem before the next
+ * request, so no caller has to know whether it was asleep.
+ * =============================================================================== */
+
+// ===== Modem Configuration =====
+#define MODEM_QUEUE_LEN        8
+#define MODEM_REPLY_MAX        96           // First information line kept by modemAt()
+#define MODEM_NOTIFY_DONE      (1UL << 31)  // Reply bit in the caller's notification value
+
+#define PRIORITY_MODEM         4            // Same as ConnectionTask, below UartReaderTask
+#define STACK_SIZE_MODEM       8192         // Jobs run here (connection steps, publishes)
+#define CORE_MODEM             CORE_MODEM_IO
+
+enum ModemRequestType : uint8_t {
+  MODEM_REQ_AT,
+  MODEM_REQ_CALL,
+};
+
+typedef int (*ModemJob)(void* arg);
+
+/**
+ * @brief One request, owned by the waiting caller (lives on its stack)
+ */
+struct ModemRequest {
+  ModemRequestType type;
+  TaskHandle_t caller;
+  uint32_t queuedAt;          // millis() when submitted
+
+  // MODEM_REQ_AT
+  const char* command;
+  unsigned long timeout;
+  char reply[MODEM_REPLY_MAX];
+
+  // MODEM_REQ_CALL
+  ModemJob job;
+  void* arg;
+
+  int result;
+};
+
+/**
+ * @brief Counters since boot
+ */
+struct ModemStats {
+  uint32_t served;            // Requests run on ModemTask
+  uint32_t rejected;          // Queue still full after the caller's wait
+  uint32_t queued;            // Waiting right now
+  uint32_t queueHighWater;
+  uint32_t lastWaitMs;        // Submit -> start, last request
+  uint32_t maxWaitMs;
+  uint32_t lastRunMs;         // Start -> reply, last request
+  uint32_t maxRunMs;
+};
+
+extern TaskHandle_t xModemTaskHandle;
+
+// ===== Lifecycle =====
+bool modemInit();    // Create the queue - call from setup() before creating tasks
+void vModemTask(void *pvParameters);
+
+// ===== Requests (any task) =====
+// Run job(arg) on ModemTask; failResult if the queue stayed full for wait
+int modemCall(ModemJob job, void* arg, TickType_t wait, bool urgent = false, int failResult = -1);
+
+// One AT command; true on OK. reply gets the first line that is not the
+// echo or the final result (e.g. "+CSQ: 20,99"), empty if none.
+bool modemAt(const char* command, unsigned long timeout, TickType_t wait,
+             char* reply = NULL, size_t replyCap = 0);
+
+bool modemIsOwner();  // Running on ModemTask
+void modemGetStats(ModemStats* stats);
+
+#endif // MODEM_H
@@ -0,0 +1,121 @@
+#ifndef MODEM_POWER_H
+#define MODEM_POWER_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "task_cores.h"
+
+/* ===============================================================================
+ * MODEM POWER - Sleep, PSM or power-off between publish bursts
+ * ===============================================================================
+ *
+ * The modem is the largest consumer on the board. How much of the time it
+ * is awake is a per-site trade between latency and energy:
+ *
+ *   Mode             Between bursts                Wake-to-publish     Commands in
+ *   POWER_ALWAYS_ON  awake                         -                   any time
+ *   POWER_DTR_SLEEP  sleep (AT+CSCLK=1, DTR high), POWER_DTR_WAKE_MS   any time
+ *                    optional eDRX paging          + one publish
+ *   POWER_PSM        PSM, MQTT disconnected        MQTT bring-up (s)   awake window
+ *   POWER_OFF        switched off (AT+CPOF)        boot + bring-up     awake window
+ *
+ * DTR SLEEP (every mode but POWER_ALWAYS_ON, when DTR is wired): ModemTask
+ * raises DTR once its queue has been empty for idleMs, and pulls it low -
+ * then waits POWER_DTR_WAKE_MS - before serving the next request.
+ * Nothing else changes: the MQTT session, keepalive and subscriptions stay
+ * with the modem, which wakes up by itself for network data and URCs.
+ *
+ * BURSTS (POWER_PSM, POWER_OFF): PowerTask runs the cycle
+ *
+ *   wake → MQTT READY → publish queues, in-flight windows and offline store
+ *   drained → POWER_LINGER_MS → connSuspend() → DISC / REL / STOP → PSM or
+ *   AT+CPOF → sleep until burstIntervalMs after the wake
+ *
+ * Telemetry keeps being sampled and batched meanwhile. With the link down
+ * every batch is parked in the offline store and replayed in the next
+ * burst, so the burst interval bounds data latency. Raise
+ * TELEMETRY_BATCH_MAX_AGE_MS towards it for fewer, larger payloads.
+ *
+ * Waking from PSM pulls DTR low and probes with AT; PWRKEY is pulsed only
+ * if the modem stays silent. After AT+CPOF it is always pulsed. PWRKEY is
+ * on the MCP23017 and goes through ActuatorTask (actuatorDrive()).
+ *
+ * Every wake is timed to MQTT READY (bursts) and to the first delivered
+ * publish (all modes) - see PowerStats.
+ * =============================================================================== */
+
+// ===== Power Configuration =====
+#define POWER_DTR_WAKE_MS        50      // DTR low → modem UART usable
+#define POWER_PWRKEY_PULSE_MS    1500    // PWRKEY low time (power on)
+#define POWER_BOOT_MS            10000   // PWRKEY pulse → first AT probe
+#define POWER_WAKE_PROBES        3       // "AT" attempts out of PSM before PWRKEY
+#define POWER_CONNECT_TIMEOUT_MS 120000  // Burst ends if MQTT isn't READY by then
+#define POWER_LINGER_MS          5000    // Stay up once drained - commands, late results
+#define POWER_AWAKE_MAX_MS       300000  // Burst ends even with a backlog left
+#define POWER_SUSPEND_WAIT_MS    35000   // ConnectionTask finishing its current step
+#define POWER_MIN_SLEEP_MS       10000   // Shortest sleep when a burst overran
+#define POWER_POLL_MS            250
+
+#define PRIORITY_POWER           2
+#define STACK_SIZE_POWER         3072
+#define CORE_POWER               CORE_APP
+
+enum PowerMode : uint8_t {
+  POWER_ALWAYS_ON,
+  POWER_DTR_SLEEP,
+  POWER_PSM,
+  POWER_OFF,
+};
+
+/**
+ * @brief Per-site power settings
+ */
+struct PowerConfig {
+  PowerMode mode;
+  int dtrPin;                 // ESP32 GPIO → SIM7600 DTR, -1 = not wired (no DTR sleep)
+  uint8_t pwrkeyPin;          // MCP23017 pin of PWRKEY
+  uint32_t idleMs;            // Modem queue idle this long → DTR sleep
+  uint32_t burstIntervalMs;   // POWER_PSM / POWER_OFF: wake to wake
+  const char* edrx;           // AT+CEDRXS cycle, e.g. "0101" (81.92 s), NULL = leave as is
+  const char* psmTau;         // AT+CPSMS T3412, e.g. "00100001" (1 h)
+  const char* psmActive;      // AT+CPSMS T3324, e.g. "00000000" (PSM right away)
+};
+
+/**
+ * @brief Power counters (snapshot)
+ */
+struct PowerStats {
+  PowerMode mode;
+  bool asleep;                // DTR sleep, PSM or off right now
+  uint32_t dtrSleeps;
+  uint32_t bursts;            // Awake windows ended (PSM / OFF)
+  uint32_t pwrkeyPulses;
+  uint32_t asleepMs;          // Since boot, including the current sleep
+  uint32_t lastReadyMs;       // Wake → MQTT READY, last burst
+  uint32_t maxReadyMs;
+  uint32_t lastPublishMs;     // Wake → first delivered publish after it
+  uint32_t maxPublishMs;
+};
+
+extern TaskHandle_t xPowerTaskHandle;
+
+// ===== API =====
+bool powerInit(const PowerConfig* config);  // Call from setup() after actuatorInit()
+bool powerBurstMode();                      // POWER_PSM / POWER_OFF - create PowerTask
+const char* powerModeName(PowerMode mode);
+void powerGetStats(PowerStats* stats);
+
+// ConnConfig.onModemUp - AT+CSCLK / AT+CEDRXS / AT+CPSMS for the mode (ModemTask)
+void powerConfigureModem();
+
+// ModemTask hooks (modem.cpp)
+TickType_t powerIdleWait();  // How long to wait for a request before DTR sleep
+void powerModemIdle();       // Queue stayed empty - raise DTR
+void powerModemWake();       // Before serving a request - no-op when awake
+
+void powerNoteDelivered();   // From PublishTask on every delivered message
+
+void vPowerTask(void *pvParameters);
+
+#endif // MODEM_POWER_H
@@ -0,0 +1,55 @@
+#ifndef MQTT_BATCH_H
+#define MQTT_BATCH_H
+
+#include <Arduino.h>
+#include "msg_pool.h"
+
+/* ===============================================================================
+ * MQTT BATCH - Coalesce many samples into one publish
+ * ===============================================================================
+ *
+ * Every separate publish costs a full TOPIC / PAYLOAD / PUB round-trip over
+ * the air. A batch collects samples and hands them to the publish queue as a
+ * single payload when the first of these limits is reached:
+ *
+ * - maxSamples samples collected
+ * - maxAgeMs elapsed since the first sample (checked by batchPoll())
+ * - the next sample would not fit in one payload (MSG_PAYLOAD_MAX)
+ *
+ * Samples are written straight into a pooled message buffer, so flushing is
+ * just an enqueue - no extra copy. A separator byte (e.g. '\n') is inserted
+ * between samples; use 0 for self-delimiting records such as CBOR items.
+ *
+ * A batch belongs to one producer task and is not thread-safe.
+ * =============================================================================== */
+
+// AT+CMQTTPAYLOAD accepts at most 10240 bytes
+#define MQTT_PAYLOAD_LIMIT 10240
+static_assert(MSG_PAYLOAD_MAX <= MQTT_PAYLOAD_LIMIT, "MSG_PAYLOAD_MAX exceeds CMQTTPAYLOAD limit");
+
+struct MqttBatch {
+  // Configuration (set by batchInit)
+  const char* topic;
+  uint8_t qos;
+  uint8_t client;      // MQTT client index (batchInit sets MQTT_CLIENT_TELEMETRY)
+  uint16_t maxSamples;
+  uint32_t maxAgeMs;
+  char separator;
+
+  // State
+  PublishMsg* msg;     // Pooled buffer being filled, NULL when empty
+  uint16_t count;      // Samples in msg
+  uint32_t openedAt;   // millis() of the first sample
+  uint32_t flushed;    // Batches handed to the publish queue
+  uint32_t rejected;   // Samples lost (no pool buffer / too large / queue full)
+};
+
+void batchInit(MqttBatch* batch, const char* topic, uint16_t maxSamples,
+               uint32_t maxAgeMs, char separator = '\n', uint8_t qos = 1);
+bool batchAdd(MqttBatch* batch, const void* sample, size_t len);
+bool batchAdd(MqttBatch* batch, const char* sample);
+bool batchPoll(MqttBatch* batch);   // Flush if maxAgeMs has passed
+bool batchFlush(MqttBatch* batch);  // Flush now (no-op when empty)
+size_t batchRemaining(const MqttBatch* batch);  // Bytes still free in this batch
+
+#endif // MQTT_BATCH_H
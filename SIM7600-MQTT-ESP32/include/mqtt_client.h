@@ -0,0 +1,79 @@
+#ifndef MQTT_CLIENT_H
+#define MQTT_CLIENT_H
+
+#include <Arduino.h>
+#include "at_engine.h"
+
+/* ===============================================================================
+ * MQTT CLIENTS - The modem's MQTT client slots
+ * ===============================================================================
+ *
+ * The SIM7600 runs up to two MQTT clients side by side. Every AT+CMQTT*
+ * command and URC carries the client index, and each client has its own
+ * broker connection, topic/payload buffers and publish results.
+ *
+ * This firmware uses them as two independent connections:
+ *
+ * - MQTT_CLIENT_TELEMETRY (0): high-rate telemetry publishes
+ * - MQTT_CLIENT_CONTROL (1):   commands in, status out - never waits behind
+ *                              a queue of telemetry
+ *
+ * Each client has its own broker configuration (MqttBrokerConfig) and its
+ * own publish queue and PublishTask (mqtt_publish.h). Build with
+ * -DMQTT_CLIENT_COUNT=1 to run everything on client 0.
+ *
+ * Functions that send AT commands must run on ModemTask (modem.h).
+ * =============================================================================== */
+
+// ===== Client Configuration =====
+#ifndef MQTT_CLIENT_COUNT
+#define MQTT_CLIENT_COUNT      2     // Client slots in use (1 or 2)
+#endif
+
+#define MQTT_CLIENT_TELEMETRY  0
+#define MQTT_CLIENT_CONTROL    (MQTT_CLIENT_COUNT > 1 ? 1 : 0)
+
+#define MQTT_CONNECT_TIMEOUT_MS   30000  // +CMQTTCONNECT: <client>,<err>
+#define MQTT_SUBSCRIBE_TIMEOUT_MS 5000   // +CMQTTSUB: <client>,<err>
+#define MQTT_DISCONNECT_TIMEOUT_S 10     // Modem-side limit of AT+CMQTTDISC
+#define MQTT_SUBSCRIBE_BATCH      8      // Topics set with AT+CMQTTSUBTOPIC per AT+CMQTTSUB
+
+static_assert(MQTT_CLIENT_COUNT >= 1 && MQTT_CLIENT_COUNT <= AT_MQTT_CLIENTS,
+              "The SIM7600 has two MQTT client slots");
+
+/**
+ * @brief Broker settings for one client slot
+ */
+struct MqttBrokerConfig {
+  const char* host;
+  uint16_t port;
+  const char* user;      // NULL or "" connects without credentials
+  const char* password;
+  const char* clientId;  // Must differ between clients on the same broker
+  uint16_t keepAliveS;
+  bool cleanSession;
+  bool tls;              // TLS with the CA from mqttTlsConfigure() (mqtt_tls.h)
+};
+
+// ===== API =====
+void mqttClientConfigure(uint8_t client, const MqttBrokerConfig* config);
+const MqttBrokerConfig* mqttClientConfig(uint8_t client);  // NULL if not configured
+
+// Run on ModemTask
+bool mqttClientAcquire(uint8_t client);   // AT+CMQTTACCQ + receive mode (+ SSL context)
+void mqttClientRelease(uint8_t client);   // AT+CMQTTREL (errors ignored)
+bool mqttClientConnect(uint8_t client);   // AT+CMQTTCONNECT, waits for the result
+bool mqttClientDisconnect(uint8_t client);  // AT+CMQTTDISC, waits for the result
+// count <= MQTT_SUBSCRIBE_BATCH, one SUB. false = not subscribed and worth
+// retrying (no '>' / OK / result, not connected); error 12 (filter refused
+// by the broker) is logged and reported as done.
+bool mqttClientSubscribeBatch(uint8_t client, const char* const* topics, const uint8_t* qos,
+                              uint8_t count);
+
+bool mqttClientIsConnected(uint8_t client);
+void mqttClientSetConnected(uint8_t client, bool connected);
+
+// Client index from a "+CMQTTxxx: <client>,..." line, -1 if there is none
+int mqttClientIndexOf(const char* line);
+
+#endif // MQTT_CLIENT_H
@@ -0,0 +1,82 @@
+#ifndef MQTT_INBOX_H
+#define MQTT_INBOX_H
+
+#include <Arduino.h>
+#include "psram_ring.h"
+
+/* ===============================================================================
+ * MQTT INBOX - Received messages, buffered in PSRAM, delivered by topic filter
+ * ===============================================================================
+ *
+ * UartReaderTask writes every +CMQTTRXSTART ... +CMQTTRXEND block straight
+ * into one record of a PSRAM ring (psram_ring.h). The topic and payload
+ * bytes are read from the UART driver directly into the ring, counted by
+ * the lengths in +CMQTTRXTOPIC / +CMQTTRXPAYLOAD - never split at newlines,
+ * so binary and multi-line payloads arrive intact.
+ *
+ * ReceiveTask calls inboxDispatch() when it sees +CMQTTRXEND. Each message
+ * goes to every handler whose filter matches (mqtt_router.h). The handler
+ * gets an InboundMsg view pointing into the ring - no copy - that is valid
+ * only until the handler returns:
+ *
+ *   void onCommand(const InboundMsg& msg, void* ctx) { ... }
+ *
+ * Messages nobody handles are counted and dropped. Without PSRAM the inbox uses
+ * INBOX_FALLBACK_BYTES of internal heap; a message that doesn't fit is
+ * dropped and counted.
+ *
+ * Single producer (UartReaderTask), single consumer (ReceiveTask).
+ * =============================================================================== */
+
+// ===== Inbox Configuration =====
+#ifndef INBOX_RAM_BYTES
+#define INBOX_RAM_BYTES       (64 * 1024)  // PSRAM ring size
+#endif
+#define INBOX_FALLBACK_BYTES  4096         // Internal heap when there is no PSRAM
+
+/**
+ * @brief One received message - a view into the inbox ring
+ */
+struct InboundMsg {
+  uint8_t client;
+  const char* topic;       // NOT NUL-terminated
+  uint16_t topicLen;
+  const uint8_t* payload;
+  uint32_t payloadLen;
+  uint32_t receivedAt;     // micros() when +CMQTTRXSTART arrived
+};
+
+typedef void (*MqttMessageHandler)(const InboundMsg& msg, void* ctx);
+
+enum InboxPart : uint8_t {
+  INBOX_TOPIC,
+  INBOX_PAYLOAD,
+};
+
+/**
+ * @brief Inbox counters (snapshot)
+ */
+struct InboxStats {
+  PsramRingStats ring;
+  uint32_t dropped;        // Messages that found no room
+  uint32_t delivered;      // Messages handed to at least one handler
+  uint32_t unhandled;      // Messages no filter matched
+};
+
+// ===== Lifecycle =====
+bool inboxInit();  // Call from setup()
+
+// ===== Producer (UartReaderTask) =====
+bool inboxBegin(uint8_t client, uint16_t topicLen, uint32_t payloadLen);
+uint8_t* inboxWritePtr(InboxPart part, size_t* room);  // NULL if no message is open
+void inboxAdvance(InboxPart part, size_t n);           // n bytes written at inboxWritePtr()
+void inboxCommit();                                    // Publish the message begun last
+void inboxAbort();                                     // Discard it (e.g. UART overflow)
+
+// ===== Consumer (ReceiveTask) =====
+uint32_t inboxDispatch();  // Run handlers for every waiting message, returns the count
+bool inboxPeek(InboundMsg* msg);
+void inboxPop();
+void inboxGetStats(InboxStats* stats);
+
+#endif // MQTT_INBOX_H
@@ -0,0 +1,107 @@
+#ifndef MQTT_PUBLISH_H
+#define MQTT_PUBLISH_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include "msg_pool.h"
+#include "mqtt_client.h"
+
+/* ===============================================================================
+ * MQTT PUBLISH ENGINE - Asynchronous, pipelined publish queue
+ * ===============================================================================
+ *
+ * Producers call mqttPublishAsync(). The topic and payload are copied into a
+ * message buffer from the static pool (msg_pool.h), a pointer to the slot
+ * goes into its client's publish queue and the call returns immediately - it
+ * never waits for the modem. Every message gets a sequence number when it is
+ * queued.
+ *
+ * Each MQTT client (mqtt_client.h) has its own queue, in-flight window and
+ * topic cache, drained by its own PublishTask - control messages never wait
+ * behind a backlog of telemetry. A PublishTask is the only task that
+ * publishes on its client: it drains the client's queue and hands one
+ * message at a time to ModemTask (modem.h), which runs the prompt-driven
+ * AT+CMQTTTOPIC / AT+CMQTTPAYLOAD / AT+CMQTTPUB sequence. The request ends
+ * as soon as AT+CMQTTPUB answers OK - it does NOT wait for the
+ * +CMQTTPUB: 0,<err> result (the broker's PUBACK for QoS 1).
+ *
+ * Staged messages move to an in-flight window of up to PUBLISH_INFLIGHT_MAX
+ * entries while their result is outstanding, so the next message is staged
+ * during the previous one's round-trip to the broker. The result line only
+ * carries the client index, so results are matched to that client's messages
+ * in the order they were published (the modem reports them in that order). Delivered
+ * messages go back to the pool; failed or timed-out ones are retried from
+ * the front of the queue up to PUBLISH_MAX_RETRIES times.
+ *
+ * The topic loaded into the modem is remembered: consecutive publishes to
+ * the same topic skip AT+CMQTTTOPIC, saving one of three round-trips.
+ * Anything that could make the modem forget it (connect, +CMQTTCONNLOST)
+ * must call mqttPublishInvalidateTopic().
+ * When AT+CMQTTPUB rejects a publish that skipped the topic, it is
+ * repeated at once with the topic, and reuse is turned off if that works
+ * (firmware that clears the topic after each PUB). A rejection
+ * never re-sends the messages already in flight - their queued results
+ * are still matched in order. Only a result that never comes restarts
+ * the window.
+ *
+ * While MQTT is down, queued messages wait in the queue.
+ * =============================================================================== */
+
+// ===== Publish Configuration =====
+#define PUBLISH_QUEUE_LEN      MSG_POOL_COUNT  // Queue can hold every pooled message
+
+#ifndef PUBLISH_INFLIGHT_MAX
+#define PUBLISH_INFLIGHT_MAX   4      // Published, result pending (1 = stop-and-wait)
+#endif
+#define PUBLISH_MAX_RETRIES    3      // Attempts after the first before a message is dropped
+
+// Per-step publish timeouts (ms) - each step returns as soon as the modem answers
+#define PUB_PROMPT_TIMEOUT_MS  1000   // '>' prompt after CMQTTTOPIC / CMQTTPAYLOAD
+#define PUB_INPUT_TIMEOUT_MS   1000   // OK after topic / payload bytes / CMQTTPUB
+#define PUB_ACK_TIMEOUT_MS     65000  // +CMQTTPUB: 0,<err> (modem gives up after 60 s)
+#define PUB_POLL_MS            10     // Result check interval while messages are in flight
+
+#define PUBLISH_REUSE_TOPIC    true   // Skip AT+CMQTTTOPIC when the topic is unchanged
+
+static_assert(PUBLISH_INFLIGHT_MAX >= 1 && PUBLISH_INFLIGHT_MAX < MSG_POOL_COUNT,
+              "In-flight window must leave pool slots for new messages");
+
+/**
+ * @brief Publish engine counters (snapshot)
+ */
+struct MqttPublishStats {
+  uint32_t queued;            // Waiting in the client's publish queue
+  uint32_t inFlight;          // Published, result not yet received
+  uint32_t delivered;         // Confirmed with +CMQTTPUB: 0,0
+  uint32_t dropped;           // Rejected by mqttPublishAsync (no slot / queue full)
+  uint32_t failed;            // Given up after PUBLISH_MAX_RETRIES
+  uint32_t retried;           // Publish attempts repeated
+  uint32_t topicSkips;        // AT+CMQTTTOPIC round-trips saved
+  uint32_t lastDeliveredSeq;  // Sequence number of the newest delivered message
+};
+
+/**
+ * @brief Called from PublishTask with the final outcome of every message
+ * @note delivered = +CMQTTPUB: <c>,0, latency from the first enqueue. Not
+ *       called for messages parked in the offline store. Must be quick.
+ */
+typedef void (*PublishResultHook)(const PublishMsg* msg, bool delivered, uint32_t latencyMs);
+
+// ===== API =====
+bool mqttPublishInit();  // Create queues - call from setup() before creating tasks
+
+// Telemetry client (MQTT_CLIENT_TELEMETRY)
+bool mqttPublishAsync(const char* topic, const char* payload, uint8_t qos = 1);
+bool mqttPublishAsync(const char* topic, const char* payload, size_t len, uint8_t qos);
+// Any client
+bool mqttPublishAsync(uint8_t client, const char* topic, const char* payload, size_t len, uint8_t qos);
+
+bool mqttPublishSubmit(PublishMsg* msg);  // Queue a pre-filled pool buffer on msg->client (takes ownership)
+void mqttPublishGetStats(uint8_t client, MqttPublishStats* stats);
+void mqttPublishInvalidateTopic(uint8_t client);  // Modem may have lost its topic - resend next time
+void mqttPublishSetResultHook(PublishResultHook hook);  // One hook for all clients, NULL to remove
+
+void vPublishTask(void *pvParameters);  // pvParameters = client index (uintptr_t)
+
+#endif // MQTT_PUBLISH_H
@@ -0,0 +1,47 @@
+#ifndef MQTT_ROUTER_H
+#define MQTT_ROUTER_H
+
+#include <Arduino.h>
+#include "mqtt_inbox.h"
+#include "mqtt_client.h"
+
+/* ===============================================================================
+ * MQTT ROUTER - Subscription registry + topic-filter trie
+ * ===============================================================================
+ *
+ * Every filter registered here becomes a path in a trie with one node per
+ * topic level ("device", "+", "cmd"). An incoming topic is matched by
+ * walking its levels once: at each node only the literal child for that
+ * level, the '+' child and the '#' child are followed. Routing cost depends
+ * on the topic's depth, not on how many filters are registered.
+ *
+ *   mqttSubscribe("device/+/cmd", 1, onDeviceCommand);   // Subscribe + route
+ *   mqttSubscribe("ota/#", 1, onOta);
+ *   mqttOnMessage("local/debug", onDebug);               // Route only
+ *
+ * Subscriptions are sent by ConnectionTask's SUBSCRIBE state, batched per
+ * MQTT client: one AT+CMQTTSUBTOPIC per filter, then a single AT+CMQTTSUB
+ * for up to MQTT_SUBSCRIBE_BATCH filters. They are re-sent after every
+ * reconnect of that client.
+ *
+ * Register everything in setup() before the tasks start - routing reads
+ * the trie without a lock. Filters must stay valid (string literals).
+ * =============================================================================== */
+
+// ===== Router Configuration =====
+#define ROUTER_MAX_ROUTES  16   // Registered filters
+#define ROUTER_MAX_NODES   64   // Trie nodes (one per distinct filter level)
+
+// ===== Registration (setup() only) =====
+bool mqttSubscribe(const char* filter, uint8_t qos, MqttMessageHandler handler,
+                   void* ctx = NULL, uint8_t client = MQTT_CLIENT_CONTROL);
+bool mqttOnMessage(const char* filter, MqttMessageHandler handler, void* ctx = NULL);
+
+// ===== Routing =====
+bool mqttRouteMessage(const InboundMsg& msg);  // Run every matching handler, false if none
+
+// ===== Subscriptions (run on ModemTask) =====
+uint8_t mqttRouterSubscriptionCount(uint8_t client);
+bool mqttRouterSubscribe(uint8_t client);  // Batched SUBTOPIC/SUB for every filter of client
+
+#endif // MQTT_ROUTER_H
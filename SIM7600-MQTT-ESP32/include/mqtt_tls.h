@@ -0,0 +1,63 @@
+#ifndef MQTT_TLS_H
+#define MQTT_TLS_H
+
+#include <Arduino.h>
+
+/* ===============================================================================
+ * MQTT TLS - CA certificate in modem storage and the shared SSL context
+ * ===============================================================================
+ *
+ * Clients with MqttBrokerConfig.tls set connect over TLS (port 8883 on
+ * most brokers). The SIM7600 does the handshake itself; the firmware
+ * only has to give it a CA certificate and an SSL context:
+ *
+ *   AT+CCERTDOWN="<caFile>",<len>  CA certificate into the modem's file system
+ *   AT+CSSLCFG=...,<ctx>,...       TLS 1.2, verify the server, CA file, SNI
+ *   AT+CMQTTACCQ=<client>,"<id>",1 the client is a TLS client
+ *   AT+CMQTTSSLCFG=<client>,<ctx>  ... and uses this context
+ *
+ * CA ONCE: the certificate is a few kilobytes and survives modem power
+ * cycles, so it is only uploaded when its hash differs from the one in NVS
+ * (namespace MQTT_TLS_NVS_NAMESPACE) or AT+CCERTLIST no longer lists the
+ * file (a replaced modem). Every other bring-up sends no certificate bytes.
+ *
+ * CONTEXT REUSE: the context is configured in MQTT_START only, before
+ * AT+CMQTTSTART. A reconnect whose service and clients survived skips
+ * MQTT_START (conn_manager.h), so neither the context nor the certificate
+ * is touched and only the broker handshake remains. The SIM7600 has no AT
+ * control over TLS session tickets - keeping the MQTT session alive is
+ * what saves handshakes.
+ *
+ * The modem checks the certificate dates against its own clock. It is
+ * often unset right after power-up (no NITZ yet), so the context ignores
+ * the local time; the chain and the host name are still verified.
+ *
+ * Functions that send AT commands must run on ModemTask (modem.h).
+ * =============================================================================== */
+
+// ===== TLS Configuration =====
+#define MQTT_TLS_SSL_CTX        0           // SSL context shared by every TLS client
+#define MQTT_TLS_CA_FILE        "mqtt_ca.pem"
+#define MQTT_TLS_NVS_NAMESPACE  "mqtttls"
+#define MQTT_TLS_PROMPT_MS      5000        // AT+CCERTDOWN '>' prompt
+#define MQTT_TLS_UPLOAD_MS      10000       // Certificate bytes → OK
+
+/**
+ * @brief TLS counters since boot
+ */
+struct MqttTlsStats {
+  uint32_t caUploads;         // Certificate written to the modem
+  uint32_t caUploadsSkipped;  // Modem already held this certificate
+  uint32_t contextSetups;     // AT+CSSLCFG sequences (full MQTT_START only)
+};
+
+// ===== API =====
+void mqttTlsConfigure(const char* caPem);  // PEM text, NULL = no TLS clients possible
+bool mqttTlsInUse();                       // Some configured client has tls set
+void mqttTlsGetStats(MqttTlsStats* stats);
+
+// Run on ModemTask
+bool mqttTlsPrepare();                 // CA (when changed) + SSL context; true if no TLS client
+bool mqttTlsBind(uint8_t client);      // AT+CMQTTSSLCFG after AT+CMQTTACCQ
+
+#endif // MQTT_TLS_H
@@ -0,0 +1,67 @@
+#ifndef MSG_POOL_H
+#define MSG_POOL_H
+
+#include <Arduino.h>
+
+/* ===============================================================================
+ * MESSAGE POOL - Fixed-size slab for queued MQTT messages
+ * ===============================================================================
+ *
+ * MSG_POOL_COUNT message buffers are allocated statically at link time, so
+ * queued publishes never call malloc and memory use is the same after a
+ * minute or a month. Free buffers sit on an index stack: acquire and release
+ * are O(1) and run inside a portMUX critical section taken with the _SAFE
+ * variant, so they may be called from tasks AND from ISRs.
+ *
+ * Override the sizes with build flags, e.g. in platformio.ini:
+ *   build_flags = -DMSG_POOL_COUNT=24 -DMSG_PAYLOAD_MAX=512
+ *
+ * The whole slab must fit MSG_POOL_BUDGET_BYTES (the 16 KB that a
+ * STACK_SIZE_PUBLISH task stack used to cost) - checked at compile time.
+ * =============================================================================== */
+
+// ===== Pool Configuration =====
+#ifndef MSG_POOL_COUNT
+#define MSG_POOL_COUNT         12     // Buffers in the slab
+#endif
+#ifndef MSG_TOPIC_MAX
+#define MSG_TOPIC_MAX          128    // Longest topic (modem allows 1024)
+#endif
+#ifndef MSG_PAYLOAD_MAX
+#define MSG_PAYLOAD_MAX        1024   // Longest payload (modem allows 10240)
+#endif
+#define MSG_POOL_BUDGET_BYTES  (16 * 1024)
+
+/**
+ * @brief One pooled message (topic + payload + metadata)
+ */
+struct PublishMsg {
+  char topic[MSG_TOPIC_MAX + 1];
+  char payload[MSG_PAYLOAD_MAX];
+  uint16_t payloadLen;
+  uint8_t qos;
+  uint8_t client;       // MQTT client index to publish on
+  uint8_t poolIndex;    // Owned by the pool - do not modify
+  uint8_t retries;      // Publish attempts that failed so far
+  uint32_t seq;         // Publish sequence number (assigned when queued)
+  uint32_t enqueuedAt;  // millis() when first queued
+  uint32_t sentAt;      // millis() when AT+CMQTTPUB was accepted
+};
+
+/**
+ * @brief Pool usage counters (snapshot)
+ */
+struct MsgPoolStats {
+  uint16_t capacity;    // MSG_POOL_COUNT
+  uint16_t inUse;       // Buffers currently handed out
+  uint16_t highWater;   // Most buffers ever handed out at once
+  uint32_t acquired;    // Successful acquires since boot
+  uint32_t exhausted;   // Acquires that found the pool empty
+};
+
+// ===== API (task and ISR safe) =====
+PublishMsg* msgPoolAcquire();             // NULL when the pool is empty
+void msgPoolRelease(PublishMsg* msg);
+void msgPoolGetStats(MsgPoolStats* stats);
+
+#endif // MSG_POOL_H
@@ -0,0 +1,90 @@
+#ifndef OFFLINE_STORE_H
+#define OFFLINE_STORE_H
+
+#include <Arduino.h>
+#include "msg_pool.h"
+#include "psram_ring.h"
+#include "task_cores.h"
+
+/* ===============================================================================
+ * OFFLINE STORE - Store-and-forward log in flash (LittleFS)
+ * ===============================================================================
+ *
+ * While a client's broker link is down (or its publish queue is full),
+ * mqttPublishSubmit() appends the message here instead of dropping it.
+ * When the connection state machine reports the link up again,
+ * StoreReplayTask feeds the stored messages back into the normal publish
+ * queues, oldest first.
+ *
+ * Layout: an append-only ring of segment files in STORE_DIR, named by an
+ * increasing number. Records are appended to the newest segment; a segment
+ * is deleted once it has been replayed. When the ring holds
+ * STORE_MAX_SEGMENTS segments the oldest is deleted to make room - the
+ * newest data wins. Each boot starts a fresh segment, so a record torn by a
+ * power cut is only ever at the end of an old segment, where its CRC is
+ * caught and the rest of that segment skipped.
+ *
+ * Record: magic, client, qos, topicLen, payloadLen (LE), CRC-16 of topic +
+ * payload (LE), topic, payload.
+ *
+ * The replay position is saved in STORE_DIR/cursor after every replay batch,
+ * so a reset repeats at most one batch (at-least-once, like QoS 1).
+ *
+ * RAM TIER: with PSRAM, a STORE_RAM_BYTES ring (psram_ring.h) sits in
+ * front of the flash log. Messages go to RAM first while the flash log is
+ * empty, and to flash once RAM is full - so RAM always holds the older
+ * records and replay drains RAM first, keeping replay oldest first. Minutes
+ * of high-rate samples are absorbed without a flash write; the price is
+ * that whatever is only in RAM is lost on a reset or power cut.
+ *
+ * Replay never starves live traffic: at most STORE_REPLAY_BATCH messages go
+ * out per STORE_REPLAY_INTERVAL_MS, and only while the target client has no
+ * more than STORE_REPLAY_MAX_BACKLOG live messages queued or in flight.
+ * =============================================================================== */
+
+// ===== Store Configuration =====
+#ifndef OFFLINE_STORE_ENABLED
+#define OFFLINE_STORE_ENABLED    1
+#endif
+#define STORE_DIR                "/sf"
+#define STORE_SEGMENT_BYTES      16384  // Segment file size limit
+#define STORE_MAX_SEGMENTS       16     // Ring capacity: 16 x 16 KB = 256 KB of flash
+#ifndef STORE_RAM_BYTES
+#define STORE_RAM_BYTES          (512 * 1024)  // PSRAM tier (0 = flash only)
+#endif
+#define STORE_REPLAY_INTERVAL_MS 500
+#define STORE_REPLAY_BATCH       4      // Messages per interval (8 msg/s max)
+#define STORE_REPLAY_MAX_BACKLOG 2      // Live queued + in-flight messages that pause replay
+
+#define PRIORITY_STORE_REPLAY    1      // Same as telemetry publishing
+#define STACK_SIZE_STORE_REPLAY  4096
+#define CORE_STORE_REPLAY        CORE_APP
+
+/**
+ * @brief Store counters (snapshot)
+ */
+struct StoreStats {
+  bool mounted;
+  uint32_t ramBytes;        // In the PSRAM tier, not yet replayed
+  uint32_t ramCapacity;     // 0 without PSRAM
+  uint32_t ramRecords;
+  uint32_t pendingBytes;    // In flash, not yet replayed
+  uint32_t segments;        // Segment files in the ring
+  uint32_t appended;        // Records written to flash since boot
+  uint32_t ramAppended;     // Records kept in the PSRAM tier since boot
+  uint32_t replayed;        // Records handed back to the publish queues
+  uint32_t lostSegments;    // Oldest segments deleted because the ring was full
+  uint32_t corrupt;         // Bad records (torn write / CRC mismatch) skipped
+};
+
+// ===== API =====
+bool storeInit();                        // PSRAM tier + LittleFS, recover ring - call from setup()
+bool storeAppend(const PublishMsg* msg); // false if neither tier took the message
+bool storePeek(PublishMsg* msg);         // Oldest record into msg (not consumed), false if empty
+void storeConsume();                     // Step past the record returned by storePeek()
+void storeSync();                        // Persist the replay position
+void storeGetStats(StoreStats* stats);
+
+void vStoreReplayTask(void *pvParameters);
+
+#endif // OFFLINE_STORE_H
@@ -0,0 +1,64 @@
+#ifndef PSRAM_RING_H
+#define PSRAM_RING_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+
+/* ===============================================================================
+ * PSRAM RING - Large record FIFO in external RAM
+ * ===============================================================================
+ *
+ * A byte ring holding variable-length records, allocated once from PSRAM
+ * (ps_malloc) at init. Every record is contiguous - one that doesn't fit
+ * before the end of the buffer starts over at offset 0 - so the producer
+ * writes straight into the ring and the consumer reads straight out of it:
+ *
+ *   Producer:  p = psramRingReserve(&r, maxLen); fill p; psramRingCommit(&r, len);
+ *   Consumer:  p = psramRingPeek(&r, &len);      use p; psramRingPop(&r);
+ *
+ * One producer and one consumer may run concurrently without a lock; only
+ * the index update is a short portMUX critical section. Several producers
+ * (or consumers) must serialize among themselves.
+ *
+ * Without PSRAM the ring falls back to fallbackBytes of internal heap, or
+ * stays disabled (every reserve fails) when that is 0.
+ * =============================================================================== */
+
+#define PSRAM_RING_ALIGN 4
+
+/**
+ * @brief Ring usage counters (snapshot)
+ */
+struct PsramRingStats {
+  bool inPsram;         // false: internal heap fallback (or disabled)
+  uint32_t capacity;    // Bytes
+  uint32_t used;        // Bytes, including record headers
+  uint32_t highWater;   // Most bytes ever used
+  uint32_t records;     // Records waiting
+  uint32_t pushed;      // Records committed since boot
+  uint32_t rejected;    // Reserves that found no room
+};
+
+struct PsramRing {
+  uint8_t* buf;
+  uint32_t size;
+  uint32_t head;            // Producer: next write offset
+  uint32_t tail;            // Consumer: oldest record
+  volatile uint32_t used;   // Bytes between tail and head (incl. skipped ends)
+  volatile uint32_t records;
+  uint32_t resAt;           // Pending reservation
+  uint32_t resWaste;
+  PsramRingStats stats;
+  portMUX_TYPE lock;
+};
+
+// ===== API =====
+bool psramRingInit(PsramRing* ring, size_t bytes, size_t fallbackBytes = 0);
+uint8_t* psramRingReserve(PsramRing* ring, uint32_t maxLen);  // NULL when full
+void psramRingCommit(PsramRing* ring, uint32_t len);           // len <= maxLen
+const uint8_t* psramRingPeek(PsramRing* ring, uint32_t* len); // Oldest record, NULL if empty
+void psramRingPop(PsramRing* ring);
+bool psramRingEmpty(const PsramRing* ring);
+void psramRingGetStats(PsramRing* ring, PsramRingStats* stats);
+
+#endif // PSRAM_RING_H
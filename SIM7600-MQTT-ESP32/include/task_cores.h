@@ -0,0 +1,39 @@
+#ifndef TASK_CORES_H
+#define TASK_CORES_H
+
+#include <freertos/FreeRTOS.h>
+
+/* ===============================================================================
+ * TASK CORES - Which CPU core runs which task
+ * ===============================================================================
+ *
+ * The ESP32-S3 has two cores. Tasks are split by what they wait for:
+ *
+ * - CORE_MODEM_IO: UartReaderTask, ModemTask, ConnectionTask and the
+ *   PublishTasks - everything on the modem's side of the queues. The UART
+ *   driver interrupt is installed from ModemTask (atUartBegin), so it
+ *   lands on this core as well.
+ * - CORE_APP: ReceiveTask (router dispatch), ActuatorTask (I2C),
+ *   TelemetryTask (sampling, batching, CBOR encoding), StoreReplayTask,
+ *   MetricsTask, BenchTask, PowerTask, WatchdogTask - and Arduino's loop().
+ *
+ * The two sides only meet in queues, so protocol work never delays
+ * sampling and the other way round. Per-core load is in the metrics
+ * document ("cpu") and the watchdog report.
+ *
+ * Each module names its own core next to its priority (CORE_MODEM,
+ * CORE_ACTUATOR, ...). Build with -DCORE_MODEM_IO=1 to put everything
+ * back on one core.
+ * =============================================================================== */
+
+#ifndef CORE_MODEM_IO
+#define CORE_MODEM_IO  0
+#endif
+#ifndef CORE_APP
+#define CORE_APP       1
+#endif
+
+static_assert(CORE_MODEM_IO < portNUM_PROCESSORS && CORE_APP < portNUM_PROCESSORS,
+              "Task core does not exist on this chip");
+
+#endif // TASK_CORES_H
@@ -0,0 +1,35 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* ===============================================================================
+ * TELEMETRY RECORDS - One sample, two wire formats
+ * ===============================================================================
+ *
+ * TELEMETRY_FORMAT_TEXT: "Msg#<seq> | Uptime:<s>s" (human readable, ~22 bytes)
+ * TELEMETRY_FORMAT_CBOR: versioned CBOR array (~12 bytes), see
+ *                        TELEMETRY_ENCODING.md for the schema and a decoder
+ *
+ * CBOR records are self-delimiting, so a batch of them is simply the records
+ * back to back (an RFC 8742 CBOR sequence) - no separator byte needed.
+ * =============================================================================== */
+
+#define TELEMETRY_FORMAT_TEXT 0
+#define TELEMETRY_FORMAT_CBOR 1
+
+#define TELEMETRY_SCHEMA_VERSION 1   // Bump when fields are added or reordered
+#define TELEMETRY_RECORD_MAX     40  // Worst case: "Msg#4294967295 | Uptime:4294967295s" + NUL (CBOR: 17)
+
+struct TelemetryRecord {
+  uint32_t seq;       // Sample sequence number (starts at 1)
+  uint32_t uptimeS;   // Seconds since boot
+  uint32_t freeHeap;  // ESP.getFreeHeap() at sample time
+};
+
+// Both return the encoded length, or 0 if 'cap' was too small
+size_t telemetryEncodeText(const TelemetryRecord& rec, char* out, size_t cap);
+size_t telemetryEncodeCbor(const TelemetryRecord& rec, uint8_t* out, size_t cap);
+
+#endif // TELEMETRY_H
@@ -0,0 +1,49 @@
+#ifndef WARM_START_H
+#define WARM_START_H
+
+#include <Arduino.h>
+
+/* ===============================================================================
+ * WARM START - Last-known modem setup, kept in NVS across ESP32 resets
+ * ===============================================================================
+ *
+ * An ESP32 reset (OTA restart, watchdog, panic, brownout) usually leaves
+ * the modem powered, registered and connected. ConnectionTask stores what
+ * it set the modem up with once it reaches READY:
+ *
+ * - baud:       rate the modem answered at (probed first after the reset)
+ * - apnHash:    APN and credentials
+ * - brokerHash: every client's broker, port, client ID and credentials
+ *
+ * After the reset the stored record says what the modem *should* still
+ * have; the modem itself (AT+CGATT?, AT+CMQTTCONNECT?, AT+CMQTTACCQ?)
+ * says whether it still does. Only the combination lets bring-up resume
+ * past SIM / REG / PDP / MQTT_START (see conn_manager.h).
+ *
+ * The record is only written when it changed, so NVS sees one write per
+ * configuration or rate change, not one per boot.
+ * =============================================================================== */
+
+#define WARM_NVS_NAMESPACE  "warmstart"
+#define WARM_VERSION        1        // Bump when WarmRecord changes
+
+struct WarmRecord {
+  uint32_t version;
+  uint32_t baud;
+  uint32_t apnHash;
+  uint32_t brokerHash;
+};
+
+// ===== API =====
+bool warmLoad(WarmRecord* rec);         // false if nothing (valid) is stored
+bool warmStore(const WarmRecord* rec);  // No write if unchanged
+void warmClear();
+
+// FNV-1a, chained: h = warmHash(warmHash(WARM_HASH_SEED, a), b)
+#define WARM_HASH_SEED  2166136261u
+uint32_t warmHash(uint32_t h, const char* text);  // NULL hashes like ""
+uint32_t warmHash(uint32_t h, uint32_t value);
+
+const char* warmResetReason();  // "power-on", "software", "brownout", ...
+
+#endif // WARM_START_H
@@ -0,0 +1,200 @@
+#include "actuator.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include "mqtt_client.h"
+#include "mqtt_publish.h"
+
+/**
+ * @brief One command for ActuatorTask - set the bits of mask to value
+ */
+struct ActuatorCmd {
+  uint16_t mask;
+  uint16_t value;
+  uint32_t receivedAt;        // micros() at +CMQTTRXSTART
+  bool internal;              // actuatorDrive() - not a relay command
+};
+
+// ===== Global Variables =====
+static McpPort* port = NULL;
+static QueueHandle_t cmdQueue = NULL;
+static uint16_t allowed = 0;
+static const char* ackTopic = NULL;
+
+static portMUX_TYPE statsLock = portMUX_INITIALIZER_UNLOCKED;
+static ActuatorStats stats = {};
+static uint64_t latencySumUs = 0;
+
+// ===== Lifecycle =====
+
+bool actuatorInit(McpPort* mcp, uint16_t allowedPins, const char* topic) {
+  cmdQueue = xQueueCreate(ACTUATOR_QUEUE_LEN, sizeof(ActuatorCmd));
+  if (cmdQueue == NULL || mcp == NULL) {
+    return false;
+  }
+  port = mcp;
+  allowed = allowedPins;
+  ackTopic = topic;
+  stats.port = mcpPortLatch(port);
+  stats.minLatencyUs = UINT32_MAX;
+  return true;
+}
+
+// ===== Commands =====
+
+/**
+ * @brief Parse "<pin>=<0|1>[,...]" / "all=<0|1>" into mask + value
+ */
+static bool parseCommand(const uint8_t* payload, uint32_t len, uint16_t* mask, uint16_t* value) {
+  if (len == 0 || len > ACTUATOR_MAX_PAYLOAD) {
+    return false;
+  }
+  char text[ACTUATOR_MAX_PAYLOAD + 1];
+  memcpy(text, payload, len);
+  text[len] = '\0';
+
+  *mask = 0;
+  *value = 0;
+  char* save = NULL;
+  for (char* tok = strtok_r(text, ", \r\n", &save); tok != NULL; tok = strtok_r(NULL, ", \r\n", &save)) {
+    char* eq = strchr(tok, '=');
+    if (eq == NULL || (strcmp(eq + 1, "0") != 0 && strcmp(eq + 1, "1") != 0)) {
+      return false;
+    }
+    *eq = '\0';
+    uint16_t bits;
+    if (strcmp(tok, "all") == 0) {
+      bits = allowed;
+    } else {
+      char* end;
+      long pin = strtol(tok, &end, 10);
+      if (end == tok || *end != '\0' || pin < 0 || pin > 15 || !(allowed & (1u << pin))) {
+        return false;
+      }
+      bits = 1u << pin;
+    }
+    *mask |= bits;
+    if (eq[1] == '1') {
+      *value |= bits;
+    } else {
+      *value &= ~bits;
+    }
+  }
+  return *mask != 0;
+}
+
+bool actuatorSubmit(uint16_t mask, uint16_t value, uint32_t receivedAt) {
+  ActuatorCmd cmd = { (uint16_t)(mask & allowed), value, receivedAt, false };
+  if (cmdQueue == NULL || xQueueSend(cmdQueue, &cmd, 0) != pdTRUE) {
+    portENTER_CRITICAL_SAFE(&statsLock);
+    stats.dropped++;
+    portEXIT_CRITICAL_SAFE(&statsLock);
+    return false;
+  }
+  return true;
+}
+
+bool actuatorDrive(uint16_t mask, uint16_t value) {
+  ActuatorCmd cmd = { mask, value, 0, true };
+  // A power pulse must not be lost to a burst of relay commands - wait for room
+  return cmdQueue != NULL && xQueueSend(cmdQueue, &cmd, pdMS_TO_TICKS(100)) == pdTRUE;
+}
+
+void actuatorOnMessage(const InboundMsg& msg, void* ctx) {
+  uint16_t mask, value;
+  if (!parseCommand(msg.payload, msg.payloadLen, &mask, &value)) {
+    portENTER_CRITICAL_SAFE(&statsLock);
+    stats.rejected++;
+    portEXIT_CRITICAL_SAFE(&statsLock);
+    Serial.printf("✗ Bad output command: %.*s\n", (int)min(msg.payloadLen, (uint32_t)ACTUATOR_MAX_PAYLOAD),
+                  (const char*)msg.payload);
+    return;
+  }
+  if (!actuatorSubmit(mask, value, msg.receivedAt)) {
+    Serial.println("⚠ Output command queue full, command dropped");
+  }
+}
+
+void actuatorGetStats(ActuatorStats* out) {
+  portENTER_CRITICAL_SAFE(&statsLock);
+  *out = stats;
+  out->avgLatencyUs = stats.writes > 0 ? (uint32_t)(latencySumUs / stats.writes) : 0;
+  if (stats.writes == 0) {
+    out->minLatencyUs = 0;
+  }
+  portEXIT_CRITICAL_SAFE(&statsLock);
+}
+
+// ===== Task =====
+
+/**
+ * @brief Actuator Task - Applies output commands to the MCP23017
+ * @note Sole runtime writer of the port; merges whatever is queued into one
+ *       port write
+ */
+void vActuatorTask(void *pvParameters) {
+  Serial.println("🔌 ActuatorTask started");
+
+  ActuatorCmd cmd;
+  while (1) {
+    if (xQueueReceive(cmdQueue, &cmd, portMAX_DELAY) != pdTRUE) {
+      continue;
+    }
+
+    // Later commands win bit by bit; latency is taken from the oldest
+    mcpPortSet(port, cmd.mask, cmd.value);
+    uint32_t oldest = cmd.receivedAt;
+    uint32_t merged = cmd.internal ? 0 : 1;
+    while (xQueueReceive(cmdQueue, &cmd, 0) == pdTRUE) {
+      mcpPortSet(port, cmd.mask, cmd.value);
+      if (cmd.internal) {
+        continue;
+      }
+      if (merged == 0) {
+        oldest = cmd.receivedAt;
+      }
+      merged++;
+    }
+
+    uint32_t start = micros();
+    bool ok = mcpPortFlush(port);
+    uint32_t done = micros();
+    uint16_t next = mcpPortLatch(port);
+    if (!ok) {
+      portENTER_CRITICAL_SAFE(&statsLock);
+      stats.writeErrors++;
+      portEXIT_CRITICAL_SAFE(&statsLock);
+      Serial.printf("✗ Output write to 0x%02X failed (0x%04X pending)\n", port->addr, next);
+      continue;
+    }
+
+    if (merged == 0) {
+      // Only reserved pins changed - no relay command to account for
+      portENTER_CRITICAL_SAFE(&statsLock);
+      stats.port = next;
+      portEXIT_CRITICAL_SAFE(&statsLock);
+      continue;
+    }
+
+    uint32_t latency = done - oldest;
+    portENTER_CRITICAL_SAFE(&statsLock);
+    stats.port = next;
+    stats.commands += merged;
+    stats.writes++;
+    stats.lastLatencyUs = latency;
+    stats.lastWriteUs = done - start;
+    stats.minLatencyUs = min(stats.minLatencyUs, latency);
+    stats.maxLatencyUs = max(stats.maxLatencyUs, latency);
+    latencySumUs += latency;
+    portEXIT_CRITICAL_SAFE(&statsLock);
+
+    // Serial and the ack come after the write - never in front of it
+    Serial.printf("🔌 Outputs = 0x%04X (%lu command(s), %lu us from UART, %lu us I2C)\n",
+                  next, (unsigned long)merged, (unsigned long)latency,
+                  (unsigned long)(done - start));
+    if (ackTopic != NULL && mqttClientIsConnected(MQTT_CLIENT_CONTROL)) {
+      char ack[40];
+      int len = snprintf(ack, sizeof(ack), "port=0x%04X us=%lu", next, (unsigned long)latency);
+      mqttPublishAsync(MQTT_CLIENT_CONTROL, ackTopic, ack, len, ACTUATOR_ACK_QOS);
+    }
+  }
+}
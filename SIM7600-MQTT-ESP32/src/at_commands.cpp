@@ -0,0 +1,72 @@
+#include "at_commands.h"
+#include <stdlib.h>
+#include "mqtt_client.h"
+#include "mqtt_publish.h"
+#include "mqtt_tls.h"
+
+// ===== Command Table =====
+
+// Prefix and result lengths are sizeof() of the literals - no strlen at run time
+#define AT_CMD_ENTRY(id, name, expect, result, timeoutMs, resultMs) \
+  { id, name, "AT+" name "=", sizeof("AT+" name "=") - 1, expect, result, sizeof(result) - 1, timeoutMs, resultMs }
+
+constexpr AtCommand AT_COMMANDS[AT_CMD_COUNT] = {
+  AT_CMD_ENTRY(AT_CMD_CMQTTACCQ,     "CMQTTACCQ",     AT_EXPECT_OK,     "",               5000, 0),
+  AT_CMD_ENTRY(AT_CMD_CMQTTCFG,      "CMQTTCFG",      AT_EXPECT_OK,     "",               3000, 0),
+  AT_CMD_ENTRY(AT_CMD_CMQTTREL,      "CMQTTREL",      AT_EXPECT_OK,     "",               2000, 0),
+  AT_CMD_ENTRY(AT_CMD_CMQTTCONNECT,  "CMQTTCONNECT",  AT_EXPECT_RESULT, "+CMQTTCONNECT:",
+               MQTT_CONNECT_TIMEOUT_MS, MQTT_CONNECT_TIMEOUT_MS),
+  AT_CMD_ENTRY(AT_CMD_CMQTTDISC,     "CMQTTDISC",     AT_EXPECT_RESULT, "+CMQTTDISC:",
+               2000, MQTT_DISCONNECT_TIMEOUT_S * 1000 + 1000),
+  AT_CMD_ENTRY(AT_CMD_CMQTTSUBTOPIC, "CMQTTSUBTOPIC", AT_EXPECT_PROMPT, "",               3000, 2000),
+  AT_CMD_ENTRY(AT_CMD_CMQTTSUB,      "CMQTTSUB",      AT_EXPECT_RESULT, "+CMQTTSUB:",
+               MQTT_SUBSCRIBE_TIMEOUT_MS, MQTT_SUBSCRIBE_TIMEOUT_MS),
+  AT_CMD_ENTRY(AT_CMD_CMQTTTOPIC,    "CMQTTTOPIC",    AT_EXPECT_PROMPT, "",
+               PUB_PROMPT_TIMEOUT_MS, PUB_INPUT_TIMEOUT_MS),
+  AT_CMD_ENTRY(AT_CMD_CMQTTPAYLOAD,  "CMQTTPAYLOAD",  AT_EXPECT_PROMPT, "",
+               PUB_PROMPT_TIMEOUT_MS, PUB_INPUT_TIMEOUT_MS),
+  AT_CMD_ENTRY(AT_CMD_CMQTTPUB,      "CMQTTPUB",      AT_EXPECT_RESULT, "+CMQTTPUB:",
+               PUB_INPUT_TIMEOUT_MS, PUB_ACK_TIMEOUT_MS),
+  AT_CMD_ENTRY(AT_CMD_CMQTTSSLCFG,   "CMQTTSSLCFG",   AT_EXPECT_OK,     "",               2000, 0),
+  AT_CMD_ENTRY(AT_CMD_CSSLCFG,       "CSSLCFG",       AT_EXPECT_OK,     "",               2000, 0),
+  AT_CMD_ENTRY(AT_CMD_CCERTDOWN,     "CCERTDOWN",     AT_EXPECT_PROMPT, "",
+               MQTT_TLS_PROMPT_MS, MQTT_TLS_UPLOAD_MS),
+};
+
+// Entries must sit at their own index - atCommand(id) is a plain array lookup
+static constexpr bool tableInOrder(size_t i) {
+  return i == AT_CMD_COUNT || (AT_COMMANDS[i].id == i && tableInOrder(i + 1));
+}
+static_assert(tableInOrder(0), "AT_COMMANDS entries out of AtCmdId order");
+
+// Longest numeric command: prefix plus three 10-digit arguments and commas
+static_assert(sizeof("AT+CMQTTSUBTOPIC=") - 1 + 3 * 11 <= AT_CMD_MAX - 1,
+              "AT_CMD_MAX too small for the numeric commands");
+
+// ===== Result Lines =====
+
+bool atParseResult(AtCmdId id, const char* line, int* client, int* err) {
+  const AtCommand& cmd = AT_COMMANDS[id];
+  if (cmd.resultLen == 0 || strncmp(line, cmd.result, cmd.resultLen) != 0) {
+    return false;
+  }
+
+  const char* p = line + cmd.resultLen;
+  while (*p == ' ') {
+    p++;
+  }
+  char* end = NULL;
+  long c = strtol(p, &end, 10);
+  if (end == p || *end != ',') {
+    return false;
+  }
+  p = end + 1;
+  long e = strtol(p, &end, 10);
+  if (end == p) {
+    return false;
+  }
+
+  *client = (int)c;
+  *err = (int)e;
+  return true;
+}
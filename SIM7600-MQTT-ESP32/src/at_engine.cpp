@@ -0,0 +1,331 @@
+#include "at_engine.h"
+#include "mqtt_inbox.h"
+#include "metrics.h"
+
+// ===== Global Variables =====
+static QueueHandle_t xResponseQueue = NULL;
+static QueueHandle_t xUrcQueue = NULL;
+static QueueHandle_t xPubAckQueue[AT_MQTT_CLIENTS] = {};
+
+// Line ring: the reader fills one free slot per line, consumers release it
+static char lineRing[AT_LINE_SLOTS][AT_LINE_MAX + 1];
+static volatile bool slotBusy[AT_LINE_SLOTS];
+static uint8_t nextSlot = 0;
+static volatile uint32_t droppedLines = 0;
+static volatile uint32_t rxOverflows = 0;
+static volatile uint32_t txBytes = 0;
+static volatile uint32_t rxBytes = 0;
+
+// Answer of the command in progress - only ModemTask touches it
+static AtResponse response;
+
+// Protocol side of the reader (at_parser.h) - UartReaderTask only
+static AtParser parser;
+
+// ===== Parser Sink =====
+
+static int acquireSlot() {
+  for (uint8_t i = 0; i < AT_LINE_SLOTS; i++) {
+    uint8_t slot = (nextSlot + i) % AT_LINE_SLOTS;
+    if (!slotBusy[slot]) {
+      slotBusy[slot] = true;
+      nextSlot = (slot + 1) % AT_LINE_SLOTS;
+      return slot;
+    }
+  }
+  return -1;
+}
+
+static char* sinkAcquire(void*) {
+  int slot = acquireSlot();
+  return slot >= 0 ? lineRing[slot] : NULL;
+}
+
+/**
+ * @brief Hand a completed line to the right queue
+ * @note Runs in UartReaderTask only
+ */
+static void sinkLine(void*, char* text, uint16_t len, AtLineKind kind, uint8_t client) {
+  uint8_t slot = (uint8_t)((text - lineRing[0]) / (AT_LINE_MAX + 1));
+  AtLine line = { text, len, slot };
+  QueueHandle_t target = kind == AT_LINE_URC ? xUrcQueue
+                       : kind == AT_LINE_PUBACK ? xPubAckQueue[client]
+                       : xResponseQueue;
+  if (xQueueSend(target, &line, 0) != pdTRUE) {
+    slotBusy[slot] = false;
+    droppedLines++;
+  }
+}
+
+// Received topic / payload bytes go straight into the inbox
+static void sinkRxBegin(void*, uint8_t client, uint16_t topicLen, uint32_t payloadLen) {
+  inboxBegin(client, topicLen, payloadLen);
+}
+
+static uint8_t* sinkRxWritePtr(void*, AtRawPart part, size_t* room) {
+  return inboxWritePtr(part == AT_RAW_TOPIC ? INBOX_TOPIC : INBOX_PAYLOAD, room);
+}
+
+static void sinkRxAdvance(void*, AtRawPart part, size_t n) {
+  inboxAdvance(part == AT_RAW_TOPIC ? INBOX_TOPIC : INBOX_PAYLOAD, n);
+}
+
+static void sinkRxEnd(void*) {
+  inboxCommit();  // Before the line is queued - ReceiveTask dispatches on it
+}
+
+static void sinkRxAbort(void*) {
+  inboxAbort();
+}
+
+// ===== Lifecycle =====
+
+bool atEngineInit() {
+  const AtParserSink sink = {
+    NULL, sinkAcquire, sinkLine,
+    sinkRxBegin, sinkRxWritePtr, sinkRxAdvance, sinkRxEnd, sinkRxAbort,
+  };
+  atParserInit(&parser, &sink);
+
+  xResponseQueue = xQueueCreate(AT_RESPONSE_QUEUE_LEN, sizeof(AtLine));
+  xUrcQueue = xQueueCreate(AT_URC_QUEUE_LEN, sizeof(AtLine));
+  bool ok = xResponseQueue != NULL && xUrcQueue != NULL;
+  for (uint8_t i = 0; i < AT_MQTT_CLIENTS; i++) {
+    xPubAckQueue[i] = xQueueCreate(AT_PUBACK_QUEUE_LEN, sizeof(AtLine));
+    ok = ok && xPubAckQueue[i] != NULL;
+  }
+  return ok;
+}
+
+/**
+ * @brief Move everything the UART has buffered into the line assembler
+ * @note UartReaderTask (at_uart.cpp) calls it on every RX event
+ */
+void atEngineDrain() {
+  uint8_t chunk[AT_RX_CHUNK];
+  size_t buffered = atPortBuffered();
+
+  while (buffered > 0) {
+    // Topic / payload bytes: read from the driver straight into the inbox
+    size_t room = 0;
+    uint8_t* dst = atParserRawWritePtr(&parser, &room);
+    if (dst != NULL && room > 0) {
+      size_t want = buffered < room ? buffered : room;
+      size_t got = atPortRead(dst, want);
+      if (got == 0) {
+        break;
+      }
+      atParserRawAdvance(&parser, got);
+      rxBytes += (uint32_t)got;
+      buffered -= got;
+      continue;
+    }
+
+    size_t want = buffered < sizeof(chunk) ? buffered : sizeof(chunk);
+    size_t got = atPortRead(chunk, want);
+    if (got == 0) {
+      break;
+    }
+    atParserFeed(&parser, chunk, got);
+    rxBytes += (uint32_t)got;
+    buffered -= got;
+  }
+}
+
+void atEngineRxLost() {
+  atParserReset(&parser);  // Also drops a received message that lost bytes
+  rxOverflows++;
+}
+
+// ===== Line Access =====
+
+bool atNextResponseLine(AtLine* line, TickType_t wait) {
+  return xQueueReceive(xResponseQueue, line, wait) == pdTRUE;
+}
+
+bool atNextUrcLine(AtLine* line, TickType_t wait) {
+  return xQueueReceive(xUrcQueue, line, wait) == pdTRUE;
+}
+
+bool atNextPubAck(uint8_t client, AtLine* line, TickType_t wait) {
+  return xQueueReceive(xPubAckQueue[client], line, wait) == pdTRUE;
+}
+
+void atReleaseLine(const AtLine& line) {
+  slotBusy[line.slot] = false;
+}
+
+void atFlushResponses() {
+  AtLine line;
+  while (atNextResponseLine(&line, 0)) {
+    Serial.printf("📡 Unsolicited: %s\n", line.text);
+    atReleaseLine(line);
+  }
+}
+
+uint32_t atDroppedLines() {
+  return droppedLines + parser.dropped;
+}
+
+uint32_t atRxOverflows() {
+  return rxOverflows;
+}
+
+uint32_t atTxBytes() {
+  return txBytes;
+}
+
+uint32_t atRxBytes() {
+  return rxBytes;
+}
+
+// ===== UART Writes =====
+
+void atWrite(const char* data, size_t len) {
+  atPortWrite((const uint8_t*)data, len);
+  txBytes += len;  // Only ModemTask writes
+}
+
+void atWrite(const char* text) {
+  atWrite(text, strlen(text));
+}
+
+void atWriteLine(const char* text) {
+  atWrite(text);
+  atWrite("\r\n", 2);
+}
+
+// ===== AT Commands =====
+
+const AtResponse& sendATCommand(const char* command, unsigned long timeout) {
+  atFlushResponses();
+
+  Serial.printf(">> %s\n", command);
+  atWriteLine(command);
+
+  response.clear();
+  unsigned long startTime = millis();
+  bool finalResult = false;
+
+  while (!finalResult) {
+    unsigned long elapsed = millis() - startTime;
+    if (elapsed >= timeout) {
+      break;
+    }
+
+    AtLine line;
+    if (!atNextResponseLine(&line, pdMS_TO_TICKS(timeout - elapsed))) {
+      break;
+    }
+
+    Serial.println(line.text);
+    response.appendLine(line.text);
+    finalResult = atIsFinalResult(line.text);
+    atReleaseLine(line);
+  }
+
+  metricsRecordAt(command, millis() - startTime);
+
+  if (response.empty()) {
+    Serial.println("⚠ No response (timeout)");
+  } else if (response.contains("ERROR")) {
+    Serial.println("⚠ Command returned ERROR");
+  }
+  Serial.println();
+
+  return response;
+}
+
+// What waitLine() is looking for
+enum AtWaitMatch : uint8_t {
+  AT_WAIT_TEXT,     // Any line containing 'expected' (waitForResponse)
+  AT_WAIT_PROMPT,   // The '>' input prompt
+  AT_WAIT_OK,       // A line that is exactly OK
+  AT_WAIT_RESULT,   // The command's "+NAME: <client>,<err>" result line
+};
+
+/**
+ * @brief Collect response lines until one matches, a final error arrives or time runs out
+ * @note For AT_WAIT_RESULT, *err gets the parsed error code
+ */
+static bool waitLine(AtWaitMatch match, const char* expected, AtCmdId id, uint8_t client,
+                     unsigned long timeout, int* err) {
+  unsigned long startTime = millis();
+  response.clear();
+
+  while (1) {
+    unsigned long elapsed = millis() - startTime;
+    if (elapsed >= timeout) {
+      return false;
+    }
+
+    AtLine line;
+    if (!atNextResponseLine(&line, pdMS_TO_TICKS(timeout - elapsed))) {
+      return false;
+    }
+
+    Serial.println(line.text);
+    response.appendLine(line.text);
+    const char* text = line.text;
+    bool found = false;
+    bool failed = false;
+    int lineClient = -1;
+    switch (match) {
+      case AT_WAIT_TEXT:
+        found = strstr(text, expected) != NULL;
+        failed = !found && strstr(text, "ERROR") != NULL;
+        break;
+      case AT_WAIT_PROMPT:
+        found = text[0] == '>' && text[1] == '\0';
+        failed = !found && atIsFinalResult(text);
+        break;
+      case AT_WAIT_OK:
+        found = strcmp(text, "OK") == 0;
+        failed = !found && atIsFinalResult(text);
+        break;
+      case AT_WAIT_RESULT:
+        // The OK before the result is expected; only an error ends the wait early
+        found = atParseResult(id, text, &lineClient, err) && lineClient == client;
+        failed = !found && atIsFinalResult(text) && strcmp(text, "OK") != 0;
+        break;
+    }
+    atReleaseLine(line);
+
+    if (found) {
+      return true;
+    }
+    if (failed) {
+      return false;
+    }
+  }
+}
+
+bool waitForResponse(const char* expected, unsigned long timeout) {
+  // Returns as soon as a line containing 'expected' arrives. Gives up early
+  // on ERROR so a rejected step does not burn its whole timeout. The lines
+  // seen are left in atResponse() for callers that parse result codes.
+  return waitLine(AT_WAIT_TEXT, expected, AT_CMD_COUNT, 0, timeout, NULL);
+}
+
+// ===== Table-Driven Commands =====
+
+bool atWaitPrompt(AtCmdId id) {
+  return waitLine(AT_WAIT_PROMPT, NULL, id, 0, atCommand(id).timeoutMs, NULL);
+}
+
+bool atWaitOk(AtCmdId id, bool afterData) {
+  const AtCommand& cmd = atCommand(id);
+  return waitLine(AT_WAIT_OK, NULL, id, 0, afterData ? cmd.resultMs : cmd.timeoutMs, NULL);
+}
+
+int atWaitResult(AtCmdId id, uint8_t client) {
+  int err = -1;
+  if (!waitLine(AT_WAIT_RESULT, NULL, id, client, atCommand(id).resultMs, &err)) {
+    return -1;
+  }
+  return err;
+}
+
+const AtResponse& atResponse() {
+  return response;
+}
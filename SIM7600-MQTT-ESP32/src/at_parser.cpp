@@ -0,0 +1,200 @@
+#include "at_parser.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Lines starting with these prefixes are never a command's answer
+static const char* const URC_PREFIXES[] = {
+  "+CMQTTRX",        // +CMQTTRXSTART / RXTOPIC / RXPAYLOAD / RXEND
+  "+CMQTTCONNLOST",  // Broker connection lost
+  "+CMQTTNONET",     // Network dropped
+};
+
+// ===== Line Helpers =====
+
+static bool startsWith(const char* text, const char* prefix) {
+  return strncmp(text, prefix, strlen(prefix)) == 0;
+}
+
+bool atIsUrc(const char* text) {
+  for (size_t i = 0; i < sizeof(URC_PREFIXES) / sizeof(URC_PREFIXES[0]); i++) {
+    if (startsWith(text, URC_PREFIXES[i])) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool atIsFinalResult(const char* text) {
+  return strcmp(text, "OK") == 0 ||
+         strcmp(text, "ERROR") == 0 ||
+         startsWith(text, "+CME ERROR") ||
+         startsWith(text, "+CMS ERROR");
+}
+
+// Client of a "+CMQTTPUB: <client>,<err>" line, -1 if the index is bad
+static int pubAckClient(const char* text) {
+  const char* p = text + strlen("+CMQTTPUB:");
+  while (*p == ' ') {
+    p++;
+  }
+  int client = *p - '0';
+  return (client >= 0 && client < AT_MQTT_CLIENTS) ? client : -1;
+}
+
+// Last number of a "+CMQTTRX...: a,b,c" header
+static uint32_t lastField(const char* text) {
+  const char* p = strrchr(text, ',');
+  return p != NULL ? strtoul(p + 1, NULL, 10) : 0;
+}
+
+// ===== Message Body =====
+
+// Open / fill / close the message for the +CMQTTRX* block in progress
+static void trackRxHeader(AtParser* p, const char* text) {
+  const AtParserSink& s = p->sink;
+  if (startsWith(text, "+CMQTTRXSTART")) {
+    unsigned client = 0, topicLen = 0, payloadLen = 0;
+    sscanf(text, "+CMQTTRXSTART: %u,%u,%u", &client, &topicLen, &payloadLen);
+    p->inRxMessage = true;
+    if (s.rxBegin != NULL) {
+      s.rxBegin(s.ctx, (uint8_t)client, (uint16_t)topicLen, payloadLen);
+    }
+  } else if (startsWith(text, "+CMQTTRXTOPIC")) {
+    p->rawPart = AT_RAW_TOPIC;
+    p->rawRemaining = lastField(text);
+  } else if (startsWith(text, "+CMQTTRXPAYLOAD")) {
+    p->rawPart = AT_RAW_PAYLOAD;
+    p->rawRemaining = lastField(text);
+  } else if (startsWith(text, "+CMQTTRXEND")) {
+    p->inRxMessage = false;
+    if (s.rxEnd != NULL) {
+      s.rxEnd(s.ctx);  // Before the line goes out - consumers act on it
+    }
+  }
+}
+
+uint8_t* atParserRawWritePtr(AtParser* p, size_t* room) {
+  *room = 0;
+  if (p->rawRemaining == 0 || p->sink.rxWritePtr == NULL) {
+    return NULL;
+  }
+  uint8_t* dst = p->sink.rxWritePtr(p->sink.ctx, p->rawPart, room);
+  if (*room > p->rawRemaining) {
+    *room = p->rawRemaining;
+  }
+  return dst;
+}
+
+void atParserRawAdvance(AtParser* p, size_t n) {
+  if (p->sink.rxAdvance != NULL) {
+    p->sink.rxAdvance(p->sink.ctx, p->rawPart, n);
+  }
+  p->rawRemaining -= n;
+}
+
+// Raw bytes that arrived in a chunk together with lines
+static void storeRaw(AtParser* p, const uint8_t* data, size_t len) {
+  while (len > 0) {
+    size_t room;
+    uint8_t* dst = atParserRawWritePtr(p, &room);
+    if (dst == NULL || room == 0) {
+      p->rawRemaining -= len;  // No room left: the bytes are lost with the message
+      return;
+    }
+    size_t n = len < room ? len : room;  // The sink may hand out room in pieces
+    memcpy(dst, data, n);
+    atParserRawAdvance(p, n);
+    data += n;
+    len -= n;
+  }
+}
+
+// ===== Lines =====
+
+static void deliverLine(AtParser* p) {
+  char* text = p->buf;
+  uint16_t len = p->len;
+  text[len] = '\0';
+  p->buf = NULL;
+  p->len = 0;
+
+  bool urc = p->inRxMessage || atIsUrc(text);
+  int client = (!urc && startsWith(text, "+CMQTTPUB:")) ? pubAckClient(text) : -1;
+  if (startsWith(text, "+CMQTTRX")) {
+    trackRxHeader(p, text);
+  }
+
+  AtLineKind kind = urc ? AT_LINE_URC : (client >= 0 ? AT_LINE_PUBACK : AT_LINE_RESPONSE);
+  p->lines++;
+  p->sink.line(p->sink.ctx, text, len, kind, client >= 0 ? (uint8_t)client : 0);
+}
+
+// ===== API =====
+
+void atParserInit(AtParser* p, const AtParserSink* sink) {
+  memset(p, 0, sizeof(*p));
+  p->sink = *sink;
+}
+
+void atParserReset(AtParser* p) {
+  // Keep the acquired buffer for the next line - only its content is garbage
+  p->len = 0;
+  p->skipping = false;
+  p->rawRemaining = 0;
+  if (p->inRxMessage) {
+    p->inRxMessage = false;
+    if (p->sink.rxAbort != NULL) {
+      p->sink.rxAbort(p->sink.ctx);  // The message lost bytes - never deliver it
+    }
+  }
+}
+
+void atParserFeed(AtParser* p, const uint8_t* data, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    if (p->rawRemaining > 0) {
+      size_t n = count - i < p->rawRemaining ? count - i : p->rawRemaining;
+      storeRaw(p, data + i, n);
+      i += n - 1;
+      continue;
+    }
+
+    char c = (char)data[i];
+
+    if (c == '\r') {
+      continue;
+    }
+    if (c == '\n') {
+      if (p->buf != NULL && p->len > 0) {
+        deliverLine(p);
+      }
+      p->len = 0;
+      p->skipping = false;
+      continue;
+    }
+    if (p->skipping) {
+      continue;
+    }
+    // Skip the space the modem sends after the '>' prompt
+    if (p->len == 0 && c == ' ' && !p->inRxMessage) {
+      continue;
+    }
+
+    if (p->buf == NULL) {
+      p->buf = p->sink.acquire(p->sink.ctx);
+      if (p->buf == NULL) {
+        p->dropped++;  // Consumers are not keeping up
+        p->skipping = true;
+        continue;
+      }
+    }
+
+    p->buf[p->len++] = c;
+
+    // '>' input prompt is not newline-terminated: deliver it right away
+    bool prompt = (p->len == 1 && c == '>' && !p->inRxMessage);
+    if (prompt || p->len == AT_LINE_MAX) {
+      deliverLine(p);
+    }
+  }
+}
@@ -0,0 +1,158 @@
+#include "at_uart.h"
+#include <driver/uart.h>
+#include "at_engine.h"
+
+// ===== Global Variables =====
+TaskHandle_t xUartReaderTaskHandle = NULL;
+
+static QueueHandle_t xUartEventQueue = NULL;  // Filled by the IDF UART driver
+static uint32_t uartBaud = 0;
+static bool uartFlowControl = false;
+
+// ===== Lifecycle =====
+
+bool atUartBegin(uint32_t baud, int rxPin, int txPin) {
+  // Installed by an earlier call - UartReaderTask already owns its event queue
+  if (uart_is_driver_installed(AT_UART_NUM)) {
+    return atUartSetBaud(baud);
+  }
+
+  uart_config_t config = {};
+  config.baud_rate = (int)baud;
+  config.data_bits = UART_DATA_8_BITS;
+  config.parity = UART_PARITY_DISABLE;
+  config.stop_bits = UART_STOP_BITS_1;
+  config.flow_ctrl = UART_HW_FLOWCTRL_DISABLE;
+
+  esp_err_t err = uart_driver_install(AT_UART_NUM, AT_UART_RX_BUFFER, AT_UART_TX_BUFFER,
+                                      AT_UART_EVENT_QUEUE_LEN, &xUartEventQueue, 0);
+  if (err != ESP_OK) {
+    Serial.printf("✗ UART driver install failed: %s\n", esp_err_to_name(err));
+    return false;
+  }
+
+  err = uart_param_config(AT_UART_NUM, &config);
+  if (err == ESP_OK) err = uart_set_pin(AT_UART_NUM, txPin, rxPin,
+                                        UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
+  // One '\n' per event; chr_tout/post_idle/pre_idle 9/0/0 as in the IDF example
+  if (err == ESP_OK) err = uart_enable_pattern_det_baud_intr(AT_UART_NUM, '\n', 1, 9, 0, 0);
+  if (err == ESP_OK) err = uart_pattern_queue_reset(AT_UART_NUM, AT_UART_PATTERN_QUEUE_LEN);
+
+  if (err != ESP_OK) {
+    // Remove the driver again so the retry starts from scratch - the reader
+    // has not been released yet, nothing is waiting on the event queue
+    Serial.printf("✗ UART driver setup failed: %s\n", esp_err_to_name(err));
+    uart_driver_delete(AT_UART_NUM);
+    xUartEventQueue = NULL;
+    return false;
+  }
+
+  uartBaud = baud;
+
+  // Reader was created in setup() and is waiting for the driver
+  if (xUartReaderTaskHandle != NULL) {
+    xTaskNotifyGive(xUartReaderTaskHandle);
+  }
+  return true;
+}
+
+bool atUartSetBaud(uint32_t baud) {
+  uart_wait_tx_done(AT_UART_NUM, pdMS_TO_TICKS(100));  // Don't garble the last command
+  if (uart_set_baudrate(AT_UART_NUM, baud) != ESP_OK) {
+    return false;
+  }
+  uartBaud = baud;
+
+  // Whatever arrived around the switch was decoded at the wrong rate
+  vTaskDelay(pdMS_TO_TICKS(20));
+  uart_flush_input(AT_UART_NUM);
+  atFlushResponses();
+  return true;
+}
+
+bool atUartSetFlowControl(bool enable, int rtsPin, int ctsPin) {
+  esp_err_t err = ESP_OK;
+  if (enable) {
+    err = uart_set_pin(AT_UART_NUM, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE, rtsPin, ctsPin);
+  }
+  if (err == ESP_OK) {
+    err = uart_set_hw_flow_ctrl(AT_UART_NUM,
+                                enable ? UART_HW_FLOWCTRL_CTS_RTS : UART_HW_FLOWCTRL_DISABLE,
+                                AT_UART_RTS_THRESH);
+  }
+  if (err != ESP_OK) {
+    Serial.printf("✗ UART flow control setup failed: %s\n", esp_err_to_name(err));
+    return false;
+  }
+  uartFlowControl = enable;
+  return true;
+}
+
+uint32_t atUartBaud() {
+  return uartBaud;
+}
+
+bool atUartFlowControl() {
+  return uartFlowControl;
+}
+
+// ===== Port =====
+
+size_t atPortBuffered() {
+  size_t buffered = 0;
+  uart_get_buffered_data_len(AT_UART_NUM, &buffered);
+  return buffered;
+}
+
+size_t atPortRead(uint8_t* dst, size_t len) {
+  int got = uart_read_bytes(AT_UART_NUM, dst, len, 0);
+  return got > 0 ? (size_t)got : 0;
+}
+
+void atPortWrite(const uint8_t* data, size_t len) {
+  uart_write_bytes(AT_UART_NUM, (const char*)data, len);
+}
+
+// ===== FreeRTOS Task =====
+
+/**
+ * @brief UART Reader Task - Sole owner of the SIM7600 RX line
+ * @note Blocks until atUartBegin() installs the driver, then sleeps on the
+ *       driver's event queue and only wakes when bytes have arrived
+ */
+void vUartReaderTask(void *pvParameters) {
+  // Wait for ConnectionTask to bring the UART up
+  ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+  Serial.println("📡 UartReaderTask active - dispatching modem lines");
+
+  uart_event_t event;
+
+  while (1) {
+    if (xQueueReceive(xUartEventQueue, &event, portMAX_DELAY) != pdTRUE) {
+      continue;
+    }
+
+    switch (event.type) {
+      case UART_DATA:         // FIFO threshold or RX idle timeout ('>' prompt)
+      case UART_PATTERN_DET:  // A '\n' arrived
+        atEngineDrain();
+        // Line splitting is done in software, so the recorded '\n' positions
+        // are only needed as wakeups - discard them before the driver's queue fills
+        while (uart_pattern_pop_pos(AT_UART_NUM) != -1) {
+        }
+        break;
+
+      case UART_FIFO_OVF:
+      case UART_BUFFER_FULL:
+        // Bytes are already lost - start clean rather than parse garbage
+        Serial.println("⚠ SIM7600 UART overflow - flushing RX");
+        uart_flush_input(AT_UART_NUM);
+        xQueueReset(xUartEventQueue);
+        atEngineRxLost();
+        break;
+
+      default:
+        break;
+    }
+  }
+}
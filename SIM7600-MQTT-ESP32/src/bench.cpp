@@ -0,0 +1,290 @@
+#include "bench.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "mqtt_batch.h"
+#include "mqtt_client.h"
+#include "mqtt_publish.h"
+
+#define BENCH_NO_CASE 0xFF
+
+// ===== Global Variables =====
+static const BenchCase cases[] = BENCH_CASES;
+#define BENCH_CASE_COUNT (sizeof(cases) / sizeof(cases[0]))
+static_assert(BENCH_CASE_COUNT < BENCH_NO_CASE, "Too many BENCH_CASES");
+
+static BenchResult results[BENCH_CASE_COUNT];
+static const char* benchTopic = NULL;
+static const char* resultTopic = NULL;
+static TaskHandle_t benchTask = NULL;
+static volatile bool running = false;
+static volatile bool stopRequested = false;
+
+// Filled by the result hook (PublishTask), read by BenchTask
+static portMUX_TYPE benchLock = portMUX_INITIALIZER_UNLOCKED;
+static volatile uint8_t activeCase = BENCH_NO_CASE;
+static uint16_t activeSampleBytes = 0;
+static uint32_t latencies[BENCH_MAX_SAMPLES];
+static uint32_t latencyCount = 0;
+static uint32_t caseDelivered = 0;
+static uint32_t casePublishes = 0;
+static uint32_t caseFailed = 0;
+static uint32_t caseMaxMs = 0;
+static uint32_t lastResultAt = 0;
+
+// ===== Control =====
+
+void benchInit(const char* topic, const char* results) {
+  benchTopic = topic;
+  resultTopic = results;
+}
+
+bool benchStart() {
+  if (running || benchTask == NULL) {
+    return false;
+  }
+  stopRequested = false;
+  running = true;
+  xTaskNotifyGive(benchTask);
+  return true;
+}
+
+void benchStop() {
+  stopRequested = true;
+}
+
+bool benchRunning() {
+  return running;
+}
+
+void benchOnMessage(const InboundMsg& msg, void* ctx) {
+  uint32_t len = msg.payloadLen;
+  while (len > 0 && (msg.payload[len - 1] == '\r' || msg.payload[len - 1] == '\n' ||
+                     msg.payload[len - 1] == ' ')) {
+    len--;
+  }
+  if (len == 5 && memcmp(msg.payload, "start", 5) == 0) {
+    Serial.println(benchStart() ? "📊 Benchmark starting" : "⚠ Benchmark already running");
+  } else if (len == 4 && memcmp(msg.payload, "stop", 4) == 0) {
+    benchStop();
+    Serial.println("📊 Benchmark stop requested");
+  } else {
+    Serial.printf("⚠ Unknown bench command: %.*s\n", (int)len, (const char*)msg.payload);
+  }
+}
+
+// ===== Result Tracking =====
+
+/**
+ * @brief Publish result hook - counts results for the active case only
+ * @note Samples start with "B<case>:", so leftovers from an earlier case (or
+ *       replayed from the offline store) are ignored
+ */
+static void onPublishResult(const PublishMsg* msg, bool delivered, uint32_t latencyMs) {
+  if (activeCase == BENCH_NO_CASE || benchTopic == NULL || strcmp(msg->topic, benchTopic) != 0 ||
+      msg->payloadLen < 2 || msg->payload[0] != 'B') {
+    return;
+  }
+  uint32_t caseIndex = 0;
+  for (uint16_t i = 1; i < msg->payloadLen && msg->payload[i] != ':'; i++) {
+    caseIndex = caseIndex * 10 + (msg->payload[i] - '0');
+  }
+
+  portENTER_CRITICAL_SAFE(&benchLock);
+  if (caseIndex == activeCase) {
+    // Fixed-size samples, '\n' between them
+    uint32_t samples = (msg->payloadLen + 1) / (activeSampleBytes + 1);
+    if (delivered) {
+      caseDelivered += samples;
+      casePublishes++;
+      if (latencyCount < BENCH_MAX_SAMPLES) {
+        latencies[latencyCount++] = latencyMs;
+      }
+      caseMaxMs = max(caseMaxMs, latencyMs);
+    } else {
+      caseFailed += samples;
+    }
+    lastResultAt = millis();
+  }
+  portEXIT_CRITICAL_SAFE(&benchLock);
+}
+
+static int compareU32(const void* a, const void* b) {
+  uint32_t x = *(const uint32_t*)a;
+  uint32_t y = *(const uint32_t*)b;
+  return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+// ===== Cases =====
+
+/**
+ * @brief Build one sample: "B<case>:<seq>:" padded with 'x' to sampleBytes
+ */
+static size_t makeSample(char* buf, uint8_t caseIndex, uint32_t seq, uint16_t sampleBytes) {
+  int len = snprintf(buf, sampleBytes + 1, "B%u:%lu:", (unsigned)caseIndex, (unsigned long)seq);
+  if (len < 0 || len > sampleBytes) {
+    len = sampleBytes;
+  }
+  memset(buf + len, 'x', sampleBytes - len);
+  return sampleBytes;
+}
+
+static void runCase(uint8_t index, BenchResult* res) {
+  const BenchCase& c = cases[index];
+  memset(res, 0, sizeof(*res));
+  res->config = c;
+
+  size_t publishBytes = (size_t)c.batch * (c.sampleBytes + 1) - 1;
+  if (c.rateHz == 0 || c.batch == 0 || c.sampleBytes < 16 || publishBytes > MSG_PAYLOAD_MAX) {
+    res->skipped = true;
+    return;
+  }
+
+  portENTER_CRITICAL_SAFE(&benchLock);
+  latencyCount = 0;
+  caseDelivered = 0;
+  casePublishes = 0;
+  caseFailed = 0;
+  caseMaxMs = 0;
+  activeSampleBytes = c.sampleBytes;
+  activeCase = index;
+  portEXIT_CRITICAL_SAFE(&benchLock);
+
+  Serial.printf("📊 Bench case %u: %u Hz | %u bytes | QoS %u | %u per publish\n",
+                (unsigned)index, c.rateHz, c.sampleBytes, (unsigned)c.qos, (unsigned)c.batch);
+
+  // A partly filled batch may wait twice its fill time, never longer than a second
+  uint32_t maxAge = c.batch > 1 ? min((uint32_t)1000, 2000u * c.batch / c.rateHz) : 0;
+  MqttBatch batch;
+  batchInit(&batch, benchTopic, c.batch, maxAge, '\n', c.qos);
+
+  static char sample[MSG_PAYLOAD_MAX + 1];
+  TickType_t period = pdMS_TO_TICKS(1000 / c.rateHz);
+  if (period == 0) {
+    period = 1;
+  }
+
+  uint32_t start = millis();
+  TickType_t xLastWakeTime = xTaskGetTickCount();
+  while (millis() - start < BENCH_STEP_MS && !stopRequested &&
+         mqttClientIsConnected(MQTT_CLIENT_TELEMETRY)) {
+    vTaskDelayUntil(&xLastWakeTime, period);
+    size_t len = makeSample(sample, index, res->generated, c.sampleBytes);
+    batchAdd(&batch, sample, len);
+    res->generated++;
+    batchPoll(&batch);
+  }
+  batchFlush(&batch);
+
+  // Wait for the results still outstanding
+  uint32_t drainStart = millis();
+  while (millis() - drainStart < BENCH_DRAIN_MS && !stopRequested) {
+    portENTER_CRITICAL_SAFE(&benchLock);
+    uint32_t settled = caseDelivered + caseFailed;
+    portEXIT_CRITICAL_SAFE(&benchLock);
+    if (settled + batch.rejected >= res->generated) {
+      break;
+    }
+    vTaskDelay(pdMS_TO_TICKS(100));
+  }
+
+  portENTER_CRITICAL_SAFE(&benchLock);
+  activeCase = BENCH_NO_CASE;
+  res->delivered = caseDelivered;
+  res->publishes = casePublishes;
+  res->failed = caseFailed;
+  res->maxMs = caseMaxMs;
+  uint32_t end = casePublishes > 0 ? lastResultAt : millis();
+  uint32_t kept = latencyCount;
+  portEXIT_CRITICAL_SAFE(&benchLock);
+
+  // Hook is idle now (activeCase cleared) - safe to sort in place
+  if (kept > 0) {
+    qsort(latencies, kept, sizeof(latencies[0]), compareU32);
+    res->p50Ms = latencies[(kept - 1) * 50 / 100];
+    res->p99Ms = latencies[(kept - 1) * 99 / 100];
+  }
+  res->elapsedMs = end - start;
+  res->msgsPerSecX10 = res->elapsedMs > 0 ? (uint32_t)((uint64_t)res->delivered * 10000 / res->elapsedMs) : 0;
+}
+
+// ===== Reporting =====
+
+static void reportResult(uint8_t index, const BenchResult* r) {
+  const BenchCase& c = r->config;
+  if (r->skipped) {
+    Serial.printf("   %2u | %4u Hz | %4u B | QoS %u | x%-3u | skipped (batch > MSG_PAYLOAD_MAX)\n",
+                  (unsigned)index, c.rateHz, c.sampleBytes, (unsigned)c.qos, (unsigned)c.batch);
+    return;
+  }
+  uint32_t lost = r->generated - min(r->generated, r->delivered);
+  uint32_t lossX10 = r->generated > 0 ? (uint32_t)((uint64_t)lost * 1000 / r->generated) : 0;
+  Serial.printf("   %2u | %4u Hz | %4u B | QoS %u | x%-3u | %5lu.%lu msg/s | p50 %5lu ms | p99 %5lu ms | max %5lu ms | loss %lu/%lu (%lu.%lu%%)\n",
+                (unsigned)index, c.rateHz, c.sampleBytes, (unsigned)c.qos, (unsigned)c.batch,
+                (unsigned long)(r->msgsPerSecX10 / 10), (unsigned long)(r->msgsPerSecX10 % 10),
+                (unsigned long)r->p50Ms, (unsigned long)r->p99Ms, (unsigned long)r->maxMs,
+                (unsigned long)lost, (unsigned long)r->generated,
+                (unsigned long)(lossX10 / 10), (unsigned long)(lossX10 % 10));
+
+  if (resultTopic != NULL && mqttClientIsConnected(MQTT_CLIENT_CONTROL)) {
+    char json[200];
+    int len = snprintf(json, sizeof(json),
+                       "{\"case\":%u,\"hz\":%u,\"bytes\":%u,\"qos\":%u,\"batch\":%u,\"gen\":%lu,"
+                       "\"ok\":%lu,\"pubs\":%lu,\"failed\":%lu,\"mps\":%lu.%lu,\"p50\":%lu,\"p99\":%lu,\"max\":%lu}",
+                       (unsigned)index, c.rateHz, c.sampleBytes, (unsigned)c.qos, (unsigned)c.batch,
+                       (unsigned long)r->generated, (unsigned long)r->delivered,
+                       (unsigned long)r->publishes, (unsigned long)r->failed,
+                       (unsigned long)(r->msgsPerSecX10 / 10), (unsigned long)(r->msgsPerSecX10 % 10),
+                       (unsigned long)r->p50Ms, (unsigned long)r->p99Ms, (unsigned long)r->maxMs);
+    if (len > 0 && len < (int)sizeof(json)) {
+      mqttPublishAsync(MQTT_CLIENT_CONTROL, resultTopic, json, len, 1);
+    }
+  }
+}
+
+// ===== FreeRTOS Task =====
+
+/**
+ * @brief Bench Task - Runs the case sweep when benchStart() is called
+ */
+void vBenchTask(void *pvParameters) {
+  benchTask = xTaskGetCurrentTaskHandle();
+  mqttPublishSetResultHook(onPublishResult);
+  Serial.printf("📊 BenchTask ready - %u case(s)%s\n", (unsigned)BENCH_CASE_COUNT,
+                BENCH_AUTOSTART ? ", starting after the first connect" : "");
+
+#if BENCH_AUTOSTART
+  while (!mqttClientIsConnected(MQTT_CLIENT_TELEMETRY)) {
+    vTaskDelay(pdMS_TO_TICKS(1000));
+  }
+  benchStart();
+#endif
+
+  while (1) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    if (!running) {
+      continue;
+    }
+
+    // Let telemetry already queued drain before the first case
+    vTaskDelay(pdMS_TO_TICKS(2000));
+
+    uint8_t done = 0;
+    for (uint8_t i = 0; i < BENCH_CASE_COUNT && !stopRequested; i++) {
+      if (!mqttClientIsConnected(MQTT_CLIENT_TELEMETRY)) {
+        Serial.println("⚠ Benchmark aborted - telemetry client disconnected");
+        break;
+      }
+      runCase(i, &results[i]);
+      done++;
+    }
+
+    Serial.printf("\n📊 ===== BENCHMARK SUMMARY (%u/%u cases, step %lu s) =====\n",
+                  (unsigned)done, (unsigned)BENCH_CASE_COUNT, (unsigned long)(BENCH_STEP_MS / 1000));
+    for (uint8_t i = 0; i < done; i++) {
+      reportResult(i, &results[i]);
+      vTaskDelay(pdMS_TO_TICKS(200));  // Don't take every pool buffer at once
+    }
+    Serial.println("📊 ===== END OF BENCHMARK =====\n");
+    running = false;
+  }
+}
@@ -0,0 +1,97 @@
+#include "cbor_writer.h"
+#include <string.h>
+
+// Major types (RFC 8949 section 3.1)
+#define CBOR_UINT   0
+#define CBOR_NEGINT 1
+#define CBOR_BYTES  2
+#define CBOR_TEXT   3
+#define CBOR_ARRAY  4
+#define CBOR_MAP    5
+#define CBOR_SIMPLE 7
+
+static void put(CborWriter* w, const uint8_t* data, size_t len) {
+  if (w->overflow || len > w->cap - w->len) {
+    w->overflow = true;
+    return;
+  }
+  memcpy(w->buf + w->len, data, len);
+  w->len += len;
+}
+
+// Initial byte + shortest big-endian argument
+static void writeHead(CborWriter* w, uint8_t major, uint64_t arg) {
+  uint8_t head[9];
+  size_t n;
+
+  if (arg < 24) {
+    head[0] = (uint8_t)((major << 5) | arg);
+    n = 1;
+  } else if (arg <= 0xFF) {
+    head[0] = (uint8_t)((major << 5) | 24);
+    head[1] = (uint8_t)arg;
+    n = 2;
+  } else if (arg <= 0xFFFF) {
+    head[0] = (uint8_t)((major << 5) | 25);
+    head[1] = (uint8_t)(arg >> 8);
+    head[2] = (uint8_t)arg;
+    n = 3;
+  } else if (arg <= 0xFFFFFFFFULL) {
+    head[0] = (uint8_t)((major << 5) | 26);
+    for (int i = 0; i < 4; i++) head[1 + i] = (uint8_t)(arg >> (24 - 8 * i));
+    n = 5;
+  } else {
+    head[0] = (uint8_t)((major << 5) | 27);
+    for (int i = 0; i < 8; i++) head[1 + i] = (uint8_t)(arg >> (56 - 8 * i));
+    n = 9;
+  }
+  put(w, head, n);
+}
+
+void cborInit(CborWriter* w, uint8_t* buf, size_t cap) {
+  w->buf = buf;
+  w->cap = cap;
+  w->len = 0;
+  w->overflow = false;
+}
+
+void cborWriteUint(CborWriter* w, uint64_t value) {
+  writeHead(w, CBOR_UINT, value);
+}
+
+void cborWriteInt(CborWriter* w, int64_t value) {
+  if (value >= 0) {
+    writeHead(w, CBOR_UINT, (uint64_t)value);
+  } else {
+    writeHead(w, CBOR_NEGINT, (uint64_t)(-1 - value));  // -1 encodes as 0
+  }
+}
+
+void cborWriteBytes(CborWriter* w, const uint8_t* data, size_t len) {
+  writeHead(w, CBOR_BYTES, len);
+  put(w, data, len);
+}
+
+void cborWriteText(CborWriter* w, const char* text) {
+  size_t len = strlen(text);
+  writeHead(w, CBOR_TEXT, len);
+  put(w, (const uint8_t*)text, len);
+}
+
+void cborWriteArray(CborWriter* w, size_t count) {
+  writeHead(w, CBOR_ARRAY, count);
+}
+
+void cborWriteMap(CborWriter* w, size_t pairs) {
+  writeHead(w, CBOR_MAP, pairs);
+}
+
+void cborWriteBool(CborWriter* w, bool value) {
+  uint8_t b = (uint8_t)((CBOR_SIMPLE << 5) | (value ? 21 : 20));
+  put(w, &b, 1);
+}
+
+void cborWriteNull(CborWriter* w) {
+  uint8_t b = (uint8_t)((CBOR_SIMPLE << 5) | 22);
+  put(w, &b, 1);
+}
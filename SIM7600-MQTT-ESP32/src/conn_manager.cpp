@@ -0,0 +1,664 @@
+#include "conn_manager.h"
+#include "at_engine.h"
+#include "mqtt_client.h"
+#include "mqtt_publish.h"
+#include "mqtt_router.h"
+#include "mqtt_tls.h"
+#include "modem.h"
+#include "warm_start.h"
+
+// ===== Global Variables =====
+TaskHandle_t xConnectionTaskHandle = NULL;
+
+static const ConnConfig* config = NULL;
+static volatile ConnState state = CONN_UART;
+static uint32_t stateEnteredAt = 0;  // millis() when the current state began
+static uint8_t stateFailures = 0;
+static bool stateSetupDone = false;  // One-time commands of the current attempt sent
+static uint8_t backoffAttempt = 0;   // Consecutive failures since the last READY
+
+// Reconnect bookkeeping - the flags are set from ReceiveTask
+static volatile bool networkLost = false;
+static volatile bool clientSubscribed[MQTT_CLIENT_COUNT] = {};  // Router filters sent
+static bool reconnecting = false;     // Recovering an established session
+static uint32_t reconnects = 0;
+static bool upshiftFailed = false;    // Upshift rate didn't verify - stay put until reboot
+static volatile bool suspendRequested = false;  // connSuspend() - go to OFF
+
+// Warm start (warm_start.h) - the modem may have outlived an ESP32 reset
+static WarmRecord warm = {};
+static bool warmKnown = false;        // NVS held a record at boot
+static bool warmChecked = false;      // First modem answer since reset handled
+static ConnState resumeState = CONN_SIM;  // Where STEP_RESUME continues
+
+// Rates tried when the modem answers at neither the configured nor the
+// upshift rate: the SIM7600-AT-BASICS scan plus the fast rates
+static const uint32_t BAUD_SCAN[] = { 115200, 9600, 57600, 19200, 230400, 460800, 921600 };
+
+static const char* const STATE_NAMES[] = {
+  "UART", "MODEM", "SIM", "REG", "PDP", "MQTT_START", "ACCQ", "CONNECT", "SUBSCRIBE", "READY", "OFF",
+};
+
+// Outcome of one state step
+enum StepResult {
+  STEP_DONE,    // Advance to the next state
+  STEP_AGAIN,   // Not there yet - poll again after CONN_POLL_MS
+  STEP_FAILED,  // Retry after backoff
+  STEP_SKIP,    // MQTT session still valid - jump straight to CONNECT
+  STEP_RESUME,  // Modem setup survived an ESP32 reset - continue at resumeState
+};
+
+// ===== API =====
+
+void connInit(const ConnConfig* cfg) {
+  config = cfg;
+}
+
+ConnState connGetState() {
+  return state;
+}
+
+const char* connStateName(ConnState s) {
+  return s < sizeof(STATE_NAMES) / sizeof(STATE_NAMES[0]) ? STATE_NAMES[s] : "?";
+}
+
+uint32_t connReconnectCount() {
+  return reconnects;
+}
+
+// Every client down - publishes are held (or parked) from here on
+static void markAllDown() {
+  for (uint8_t c = 0; c < MQTT_CLIENT_COUNT; c++) {
+    mqttClientSetConnected(c, false);
+    mqttPublishInvalidateTopic(c);
+    clientSubscribed[c] = false;
+  }
+  mqttConnected = false;
+}
+
+void connNotifyLinkLost(int client) {
+  if (client < 0) {
+    // +CMQTTNONET - the network is gone for every client
+    networkLost = true;
+    markAllDown();
+  } else if (client < MQTT_CLIENT_COUNT) {
+    mqttClientSetConnected(client, false);
+    mqttPublishInvalidateTopic(client);
+    clientSubscribed[client] = false;
+  }
+
+  if (!mqttClientIsConnected(MQTT_CLIENT_TELEMETRY)) {
+    mqttConnected = false;
+  }
+  if (xConnectionTaskHandle != NULL) {
+    xTaskNotifyGive(xConnectionTaskHandle);
+  }
+}
+
+void connSuspend() {
+  suspendRequested = true;
+  markAllDown();
+  if (xConnectionTaskHandle != NULL) {
+    xTaskNotifyGive(xConnectionTaskHandle);
+  }
+}
+
+void connResume() {
+  suspendRequested = false;
+  networkLost = false;
+  if (xConnectionTaskHandle != NULL) {
+    xTaskNotifyGive(xConnectionTaskHandle);
+  }
+}
+
+// ===== Helpers =====
+
+static void enterState(ConnState next) {
+  state = next;
+  stateEnteredAt = millis();
+  stateFailures = 0;
+  stateSetupDone = false;
+  Serial.printf("🔌 Connection: %s\n", connStateName(next));
+}
+
+static bool pastDeadline(uint32_t timeoutMs) {
+  return millis() - stateEnteredAt >= timeoutMs;
+}
+
+// Equal jitter: at least half of the exponential step, so retries from many
+// units that lost the same cell don't arrive in lockstep
+static uint32_t backoffDelayMs(uint8_t attempt) {
+  uint32_t ceiling = CONN_BACKOFF_BASE_MS << (attempt < 6 ? attempt : 6);
+  if (ceiling > CONN_BACKOFF_MAX_MS) {
+    ceiling = CONN_BACKOFF_MAX_MS;
+  }
+  return ceiling / 2 + esp_random() % (ceiling / 2 + 1);
+}
+
+// True if the MQTT service is running and every configured client is still
+// acquired under its own ID ("+CMQTTACCQ: <n>,\"<id>\",<type>" per client)
+static bool sessionStillValid() {
+  const AtResponse& r = sendATCommand("AT+CMQTTACCQ?", 2000);
+  if (!r.contains("OK")) {
+    return false;  // Service stopped
+  }
+  for (uint8_t client = 0; client < MQTT_CLIENT_COUNT; client++) {
+    const MqttBrokerConfig* cfg = mqttClientConfig(client);
+    char expected[96];
+    snprintf(expected, sizeof(expected), "+CMQTTACCQ: %u,\"%s\"",
+             (unsigned)client, cfg != NULL ? cfg->clientId : "");
+    if (!r.contains(expected)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// ===== Warm Start =====
+
+static uint32_t apnHash() {
+  uint32_t h = warmHash(WARM_HASH_SEED, config->apn);
+  h = warmHash(h, config->apnUser);
+  return warmHash(h, config->apnPassword);
+}
+
+static uint32_t brokerHash() {
+  uint32_t h = WARM_HASH_SEED;
+  for (uint8_t client = 0; client < MQTT_CLIENT_COUNT; client++) {
+    const MqttBrokerConfig* cfg = mqttClientConfig(client);
+    if (cfg == NULL) {
+      h = warmHash(h, (uint32_t)0);
+      continue;
+    }
+    h = warmHash(h, cfg->host);
+    h = warmHash(h, (uint32_t)cfg->port);
+    h = warmHash(h, cfg->clientId);
+    h = warmHash(h, cfg->user);
+    h = warmHash(h, cfg->password);
+    h = warmHash(h, (uint32_t)cfg->keepAliveS);
+    h = warmHash(h, (uint32_t)cfg->cleanSession);
+    h = warmHash(h, (uint32_t)cfg->tls);
+  }
+  return h;
+}
+
+// Remember what the modem was set up with - called on READY
+static void saveWarmRecord() {
+  WarmRecord rec = { WARM_VERSION, atUartBaud(), apnHash(), brokerHash() };
+  if (!warmStore(&rec)) {
+    Serial.println("⚠ Warm start record not saved");
+  }
+  warm = rec;
+  warmKnown = true;
+}
+
+// Every configured client connected to its own broker ("+CMQTTCONNECT: <n>,\"tcp://host:port\",...")
+static bool clientsStillConnected() {
+  const AtResponse& r = sendATCommand("AT+CMQTTCONNECT?", 2000);
+  for (uint8_t client = 0; client < MQTT_CLIENT_COUNT; client++) {
+    const MqttBrokerConfig* cfg = mqttClientConfig(client);
+    if (cfg == NULL) {
+      continue;
+    }
+    char expected[160];
+    snprintf(expected, sizeof(expected), "+CMQTTCONNECT: %u,\"tcp://%s:%u\"",
+             (unsigned)client, cfg->host, (unsigned)cfg->port);
+    if (!r.contains(expected)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief First modem answer after an ESP32 reset: how much of the setup survived?
+ * @return The state to continue at - CONN_SIM when nothing can be skipped
+ */
+static ConnState warmResumeState() {
+  Serial.printf("♻ ESP32 reset (%s) - checking what the modem kept\n", warmResetReason());
+  if (!warmKnown || warm.apnHash != apnHash()) {
+    return CONN_SIM;  // Unknown or different APN - configure from scratch
+  }
+  if (!sendATCommand("AT+CGATT?").contains("+CGATT: 1")) {
+    return CONN_SIM;
+  }
+  if (warm.brokerHash != brokerHash()) {
+    return CONN_MQTT_START;  // Broker settings changed - new MQTT session
+  }
+  if (clientsStillConnected()) {
+    for (uint8_t client = 0; client < MQTT_CLIENT_COUNT; client++) {
+      mqttClientSetConnected(client, mqttClientConfig(client) != NULL);
+      mqttPublishInvalidateTopic(client);  // Unknown what the modem holds
+    }
+    return CONN_SUBSCRIBE;
+  }
+  return sessionStillValid() ? CONN_CONNECT : CONN_MQTT_START;
+}
+
+/**
+ * @brief Pick the state to resume from after a link loss and start there
+ * @note Clients that are still connected are left alone
+ */
+static void startRecovery() {
+  bool anyDown = false;
+  for (uint8_t client = 0; client < MQTT_CLIENT_COUNT; client++) {
+    anyDown = anyDown || !mqttClientIsConnected(client);
+  }
+  if (!networkLost && !anyDown) {
+    return;  // Stale wakeup - the loss was handled by an earlier attempt
+  }
+
+  reconnecting = true;
+  reconnects++;
+  mqttConnected = mqttClientIsConnected(MQTT_CLIENT_TELEMETRY);
+
+  if (networkLost) {
+    networkLost = false;
+    Serial.println("📡 Network lost - reconnecting from registration");
+    enterState(CONN_REG);
+  } else {
+    Serial.println("📡 MQTT connection lost - reconnecting");
+    enterState(CONN_MQTT_START);
+  }
+}
+
+// ===== State Steps (run on ModemTask) =====
+
+static StepResult stepUart() {
+  warmKnown = warmLoad(&warm);
+  uint32_t baud = warmKnown && warm.baud != 0 ? warm.baud : config->baud;
+  if (!atUartBegin(baud, config->rxPin, config->txPin)) {
+    return STEP_FAILED;
+  }
+  Serial.printf("✓ UART initialized on RX:%d, TX:%d at %lu baud%s\n",
+                config->rxPin, config->txPin, (unsigned long)baud,
+                warmKnown ? " (last known rate)" : "");
+  return STEP_DONE;
+}
+
+static bool probeModem(int attempts) {
+  for (int i = 0; i < attempts; i++) {
+    if (sendATCommand("AT", 500).contains("OK")) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Find the rate the modem is at - the boot-time probing replaces the fixed
+// boot wait, the scan covers a modem left at some other rate
+static bool findModemBaud() {
+  // The current rate first - after a reset that is the last known one
+  uint32_t candidates[3] = { atUartBaud(), 0, 0 };
+  int count = 1;
+  if (config->baud != candidates[0]) {
+    candidates[count++] = config->baud;
+  }
+  if (config->upshiftBaud != 0 && config->upshiftBaud != candidates[0] &&
+      config->upshiftBaud != config->baud) {
+    candidates[count++] = config->upshiftBaud;
+  }
+
+  for (int i = 0; i < CONN_MODEM_PROBES; i++) {
+    uint32_t baud = candidates[i % count];
+    if (baud != atUartBaud()) {
+      atUartSetBaud(baud);
+    }
+    if (sendATCommand("AT", 500).contains("OK")) {
+      return true;
+    }
+  }
+
+  Serial.println("⚠ No response - scanning baud rates");
+  for (size_t i = 0; i < sizeof(BAUD_SCAN) / sizeof(BAUD_SCAN[0]); i++) {
+    Serial.printf("Trying baud rate: %lu\n", (unsigned long)BAUD_SCAN[i]);
+    atUartSetBaud(BAUD_SCAN[i]);
+    if (probeModem(2)) {
+      Serial.printf("✓ Module is responding at %lu baud!\n", (unsigned long)BAUD_SCAN[i]);
+      return true;
+    }
+  }
+  atUartSetBaud(config->baud);
+  return false;
+}
+
+static void enableFlowControl() {
+  if (config->rtsPin < 0 || config->ctsPin < 0) {
+    return;
+  }
+  if (!sendATCommand("AT+IFC=2,2").contains("OK")) {
+    Serial.println("⚠ Modem rejected RTS/CTS flow control");
+    return;
+  }
+  if (atUartSetFlowControl(true, config->rtsPin, config->ctsPin) && probeModem(3)) {
+    Serial.printf("✓ RTS/CTS flow control on (RTS:%d, CTS:%d)\n", config->rtsPin, config->ctsPin);
+    return;
+  }
+  // Handshake lines not wired as configured
+  Serial.println("⚠ No response with RTS/CTS - flow control off");
+  atUartSetFlowControl(false);
+  sendATCommand("AT+IFC=0,0");
+}
+
+/**
+ * @brief Switch the link to upshiftBaud: temporary, verified, then permanent
+ * @note A rate that doesn't verify is not tried again until reboot
+ */
+static void upshiftUart() {
+  uint32_t from = atUartBaud();
+  uint32_t to = config->upshiftBaud;
+  if (to == 0 || to == from || upshiftFailed) {
+    return;
+  }
+
+  char cmd[32];
+  snprintf(cmd, sizeof(cmd), "AT+IPR=%lu", (unsigned long)to);
+  if (!sendATCommand(cmd).contains("OK")) {
+    Serial.printf("⚠ Modem rejected %lu baud\n", (unsigned long)to);
+    upshiftFailed = true;
+    return;
+  }
+
+  // The OK came at the old rate - the modem has switched now
+  atUartSetBaud(to);
+  if (probeModem(CONN_BAUD_VERIFY_PROBES)) {
+    snprintf(cmd, sizeof(cmd), "AT+IPREX=%lu", (unsigned long)to);
+    bool saved = sendATCommand(cmd).contains("OK");
+    Serial.printf("✓ UART upshifted to %lu baud%s\n", (unsigned long)to,
+                  saved ? " (saved)" : " (not saved)");
+    return;
+  }
+
+  // Wiring or level shifter can't carry the rate. AT+IPR was not saved,
+  // so a modem restart also brings it back to the old rate.
+  Serial.printf("⚠ No response at %lu baud - staying at %lu\n",
+                (unsigned long)to, (unsigned long)from);
+  upshiftFailed = true;
+  atUartSetBaud(from);
+}
+
+static StepResult stepModem() {
+  if (atUartFlowControl()) {
+    atUartSetFlowControl(false);  // Modem may have restarted with IFC off
+  }
+  if (!findModemBaud()) {
+    Serial.println("✗ Module not responding! Check connections.");
+    return STEP_FAILED;
+  }
+
+  Serial.println("✓ Module responding!");
+  sendATCommand("ATE0");  // Disable echo
+
+  ConnState resume = CONN_SIM;
+  if (!warmChecked) {
+    warmChecked = true;
+    resume = warmResumeState();
+  }
+  if (resume == CONN_SIM) {
+    sendATCommand("ATI");   // Module info
+  }
+  enableFlowControl();      // Our side of RTS/CTS starts off after every reset
+  upshiftUart();
+  if (config->onModemUp != NULL) {
+    config->onModemUp();
+  }
+
+  if (resume != CONN_SIM) {
+    Serial.printf("♻ Warm start - resuming at %s\n", connStateName(resume));
+    resumeState = resume;
+    return STEP_RESUME;
+  }
+  return STEP_DONE;
+}
+
+static StepResult stepSim() {
+  if (!sendATCommand("AT+CPIN?").contains("READY")) {
+    Serial.println("✗ SIM card not ready!");
+    return STEP_FAILED;
+  }
+  return STEP_DONE;
+}
+
+static StepResult stepRegistration() {
+  const AtResponse& r = sendATCommand("AT+CREG?", 1000);
+  if (r.contains(",1") || r.contains(",5")) {
+    Serial.println("✓ Registered on network");
+    sendATCommand("AT+CSQ");  // Signal quality, for the log
+    return STEP_DONE;
+  }
+  if (pastDeadline(CONN_REG_TIMEOUT_MS)) {
+    Serial.println("✗ Failed to register on network!");
+    return STEP_FAILED;
+  }
+  return STEP_AGAIN;
+}
+
+static StepResult stepPdp() {
+  // Configure the APN once per attempt, then poll until the module has attached
+  if (!stateSetupDone) {
+    char cmd[128];
+    snprintf(cmd, sizeof(cmd), "AT+CGDCONT=1,\"IP\",\"%s\"", config->apn);
+    sendATCommand(cmd);
+
+    if (config->apnUser != NULL && config->apnUser[0] != '\0') {
+      // 1 = PAP auth, username, password
+      snprintf(cmd, sizeof(cmd), "AT+CGAUTH=1,1,\"%s\",\"%s\"", config->apnUser,
+               config->apnPassword != NULL ? config->apnPassword : "");
+      sendATCommand(cmd);
+    }
+    stateSetupDone = true;
+  }
+
+  if (sendATCommand("AT+CGATT?").contains("+CGATT: 1")) {
+    Serial.println("✓ Network connection established");
+    return STEP_DONE;
+  }
+  if (pastDeadline(CONN_ATTACH_TIMEOUT_MS)) {
+    Serial.println("✗ Packet domain not attached!");
+    return STEP_FAILED;
+  }
+  return STEP_AGAIN;
+}
+
+static StepResult stepMqttStart() {
+  // Fast path after a drop: keep the service and clients if they survived
+  if (reconnecting && sessionStillValid()) {
+    Serial.println("✓ MQTT service and clients still valid - skipping STOP/REL/START/ACCQ");
+    return STEP_SKIP;
+  }
+
+  // Every client is rebuilt from scratch - including its subscriptions, a
+  // clean-session CONNECT starts with none on the broker
+  markAllDown();
+
+  // A previous session can survive an ESP32 reset - clear it first.
+  // Error 21 = "operation not allowed" (nothing to stop) - IGNORE
+  sendATCommand("AT+CMQTTSTOP", 3000);
+  for (uint8_t client = 0; client < MQTT_CLIENT_COUNT; client++) {
+    mqttClientRelease(client);
+  }
+
+  // CA certificate (only when it changed) and the SSL context for TLS clients
+  if (!mqttTlsPrepare()) {
+    return STEP_FAILED;
+  }
+
+  sendATCommand("AT+CMQTTSTART", CONN_START_TIMEOUT_MS);
+  if (!atResponse().contains("+CMQTTSTART:")) {
+    waitForResponse("+CMQTTSTART:", CONN_START_TIMEOUT_MS);
+  }
+
+  // Error 23 = "network not ready" but the service still starts - IGNORE
+  const char* result = atResponse().find("+CMQTTSTART:");
+  int err = result != NULL ? atoi(result + strlen("+CMQTTSTART:")) : -1;
+  if (err != 0 && err != 23) {
+    Serial.printf("✗ MQTT service did not start (error %d)\n", err);
+    return STEP_FAILED;
+  }
+  Serial.println("✓ MQTT service initialized");
+  return STEP_DONE;
+}
+
+static StepResult stepAccq() {
+  for (uint8_t client = 0; client < MQTT_CLIENT_COUNT; client++) {
+    if (!mqttClientAcquire(client) && client == MQTT_CLIENT_TELEMETRY) {
+      return STEP_FAILED;
+    }
+  }
+  return STEP_DONE;
+}
+
+static StepResult stepConnect() {
+  for (uint8_t client = 0; client < MQTT_CLIENT_COUNT; client++) {
+    if (mqttClientIsConnected(client)) {
+      continue;  // Connected on an earlier attempt
+    }
+    if (!mqttClientConnect(client)) {
+      if (client == MQTT_CLIENT_TELEMETRY) {
+        return STEP_FAILED;
+      }
+      Serial.printf("⚠ Client %u not connected, continuing without it...\n", (unsigned)client);
+    }
+  }
+  return STEP_DONE;
+}
+
+static StepResult stepSubscribe() {
+  for (uint8_t client = 0; client < MQTT_CLIENT_COUNT; client++) {
+    if (clientSubscribed[client] || !mqttClientIsConnected(client) ||
+        mqttRouterSubscriptionCount(client) == 0) {
+      continue;
+    }
+    // Retry after backoff; clients already subscribed are skipped then
+    if (!mqttRouterSubscribe(client)) {
+      return STEP_FAILED;
+    }
+    clientSubscribed[client] = true;
+  }
+  return STEP_DONE;
+}
+
+static StepResult runStep(ConnState s) {
+  switch (s) {
+    case CONN_UART:       return stepUart();
+    case CONN_MODEM:      return stepModem();
+    case CONN_SIM:        return stepSim();
+    case CONN_REG:        return stepRegistration();
+    case CONN_PDP:        return stepPdp();
+    case CONN_MQTT_START: return stepMqttStart();
+    case CONN_ACCQ:       return stepAccq();
+    case CONN_CONNECT:    return stepConnect();
+    case CONN_SUBSCRIBE:  return stepSubscribe();
+    default:              return STEP_DONE;
+  }
+}
+
+// ModemJob wrapper - one state step is one modem request
+static int stepJob(void* arg) {
+  return runStep(*(const ConnState*)arg);
+}
+
+// ===== FreeRTOS Task =====
+
+/**
+ * @brief Connection Task - Drives the bring-up state machine, never exits
+ * @note Hands one state step at a time to ModemTask. Sleeps in READY
+ *       until connNotifyLinkLost() wakes it, and in OFF until connResume().
+ */
+void vConnectionTask(void *pvParameters) {
+  Serial.println("🔌 ConnectionTask started");
+  if (config == NULL) {
+    Serial.println("✗ ConnectionTask: connInit() was not called");
+    vTaskDelete(NULL);
+    return;
+  }
+
+  uint32_t bringUpStart = millis();
+  enterState(CONN_UART);
+
+  while (1) {
+    if (suspendRequested && state != CONN_OFF) {
+      markAllDown();  // Again - a step finishing after connSuspend() may have raised a flag
+      reconnecting = false;
+      enterState(CONN_OFF);
+    }
+
+    if (state == CONN_OFF) {
+      // Link-loss URCs from a modem going down are stale - only a resume counts
+      ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+      if (!suspendRequested) {
+        bringUpStart = millis();
+        backoffAttempt = 0;
+        reconnecting = true;
+        enterState(CONN_MODEM);
+      }
+      continue;
+    }
+
+    if (state == CONN_READY) {
+      // Nothing to drive until a link-loss URC wakes us
+      ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+      if (suspendRequested) {
+        continue;
+      }
+      bringUpStart = millis();
+      startRecovery();
+      continue;
+    }
+
+    ConnState current = state;
+    StepResult result = (StepResult)modemCall(stepJob, &current, pdMS_TO_TICKS(30000),
+                                              false, STEP_FAILED);
+
+    switch (result) {
+      case STEP_SKIP:
+        enterState(CONN_CONNECT);
+        break;
+
+      case STEP_RESUME:
+        enterState(resumeState);
+        break;
+
+      case STEP_DONE:
+        enterState((ConnState)(state + 1));
+        if (state == CONN_READY) {
+          mqttConnected = true;
+          backoffAttempt = 0;
+          saveWarmRecord();
+          Serial.printf("\n✓✓✓ System ready! MQTT %s in %lu ms ✓✓✓\n",
+                        reconnecting ? "reconnected" : "connected",
+                        (unsigned long)(millis() - bringUpStart));
+          reconnecting = false;
+          if (config->onReady != NULL) {
+            config->onReady();
+          }
+        }
+        break;
+
+      case STEP_AGAIN:
+        vTaskDelay(pdMS_TO_TICKS(CONN_POLL_MS));
+        break;
+
+      case STEP_FAILED: {
+        stateSetupDone = false;
+        uint32_t delayMs = backoffDelayMs(backoffAttempt);
+        if (backoffAttempt < 255) {
+          backoffAttempt++;
+        }
+        if (++stateFailures >= CONN_STATE_RETRIES && state > CONN_MODEM) {
+          // Fall back one tier and redo the full sequence from there
+          ConnState fallback = state > CONN_MQTT_START ? CONN_MQTT_START : CONN_MODEM;
+          Serial.printf("⚠ %s failed %u times - falling back to %s\n",
+                        connStateName(state), (unsigned)stateFailures, connStateName(fallback));
+          reconnecting = false;
+          enterState(fallback);
+        } else {
+          Serial.printf("⚠ %s failed - retrying in %lu ms\n",
+                        connStateName(state), (unsigned long)delayMs);
+        }
+        vTaskDelay(pdMS_TO_TICKS(delayMs));
+        break;
+      }
+    }
+  }
+}
@@ -1,9 +1,23 @@
 #include <Arduino.h>
-#include <Adafruit_MCP23X17.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
-#include <freertos/semphr.h>
 #include <freertos/queue.h>
+#include "at_engine.h"
+#include "modem.h"
+#include "conn_manager.h"
+#include "mqtt_client.h"
+#include "mqtt_tls.h"
+#include "mqtt_publish.h"
+#include "mqtt_batch.h"
+#include "offline_store.h"
+#include "mqtt_inbox.h"
+#include "mqtt_router.h"
+#include "mcp_port.h"
+#include "actuator.h"
+#include "metrics.h"
+#include "bench.h"
+#include "telemetry.h"
+#include "modem_power.h"
 
 /* ===============================================================================
  * SIM7600 MQTT CLIENT - FreeRTOS Edition
@@ -13,11 +27,20 @@
  * FreeRTOS multi-tasking for robust, concurrent operation.
  * 
  * FREERTOS ARCHITECTURE:
- * - InitTask: Initializes hardware, network, and MQTT (runs once, deletes self)
- * - PublishTask: Publishes status messages every 30 seconds
- * - ReceiveTask: Monitors incoming MQTT messages (checks every 100ms)
+ * - UartReaderTask: Sole reader of the SIM7600 UART, splits lines and routes
+ *   command responses and URCs to separate queues (see at_engine.h)
+ * - ModemTask: Sole writer to the SIM7600 UART - every other task sends it
+ *   AT commands and jobs through one request queue (see modem.h)
+ * - ConnectionTask: Brings up modem, network and MQTT as a state machine that
+ *   advances on modem responses and never exits (see conn_manager.h)
+ * - TelemetryTask: Takes a status sample every second, batches samples into
+ *   one payload and queues it (see mqtt_batch.h)
+ * - PublishTask (one per MQTT client): Sole publisher on its client - drains
+ *   that client's publish queue (see mqtt_publish.h)
+ * - ReceiveTask: Processes incoming MQTT URCs as soon as they are queued
  * - WatchdogTask: Reports system health every 60 seconds
- * - Mutex protection: SIM7600 UART is protected by a mutex for thread safety
+ * - PowerTask: Burst power modes only - wakes the modem, drains, and puts
+ *   it back into PSM or off (see modem_power.h)
  * 
  * KEY LEARNING: The SIM7600 MQTT implementation is SIMPLE!
  * Based on real-world tutorials (MQTT_tutorial.txt and MQTT_tutorial2.txt),
@@ -31,9 +54,10 @@
  * 
  * 2. MQTT INITIALIZATION:
  *    - AT+CMQTTSTOP - Stop any existing service (error 21 is NORMAL if not running)
- *    - AT+CMQTTREL=0 - Release any existing client
+ *    - AT+CMQTTREL=<n> - Release any existing client
  *    - AT+CMQTTSTART - Start MQTT service (error 23 can be ignored!)
- *    - AT+CMQTTACCQ=0,"client_id" - Acquire a client
+ *    - AT+CMQTTACCQ=<n>,"client_id" - Acquire a client
+ *    - Two clients run side by side: 0 = telemetry, 1 = control (see mqtt_client.h)
  * 
  * 3. MQTT CONNECTION:
  *    - AT+CMQTTCONNECT=0,"tcp://broker:port",keepalive,clean,"user","pass"
@@ -41,10 +65,10 @@
  *    - Any other code (0,12 etc.) indicates the error type
  * 
  * 4. PUBLISH MESSAGE:
- *    - AT+CMQTTTOPIC=0,<length> → Send topic string
- *    - AT+CMQTTPAYLOAD=0,<length> → Send payload string
- *    - AT+CMQTTPUB=0,<qos>,<timeout> → Publish
- *    - Use 1 second delays between commands (no prompt waiting needed!)
+ *    - AT+CMQTTTOPIC=0,<length> → wait for '>' → send topic → wait for OK
+ *    - AT+CMQTTPAYLOAD=0,<length> → wait for '>' → send payload → wait for OK
+ *    - AT+CMQTTPUB=0,<qos>,<timeout> → wait for +CMQTTPUB: 0,0
+ *    - No fixed delays: each step moves on as soon as the modem answers
  * 
  * 5. SUBSCRIBE:
  *    - AT+CMQTTSUB=0,"topic",<qos>
@@ -63,30 +87,54 @@
 
 // ===== MCP23017 Configuration =====
 #define DO_1_ADDR 0x27
-Adafruit_MCP23X17 mcpDO_1;  // 0x27 - Digital outputs
+McpPort mcpDO_1;  // 0x27 - Digital outputs (shadow registers, mcp_port.h)
 
 // ===== SIM7600 UART Configuration =====
 #define SIM7600_RX 19  // ESP32 RX <- SIM7600 TX
 #define SIM7600_TX 20  // ESP32 TX -> SIM7600 RX
 #define SIM7600_PWRKEY 9  // MCP23017 pin number for PWRKEY
 #define SIM7600_BAUD 115200
+#define SIM7600_UPSHIFT_BAUD 921600  // Negotiated once the module answers (0 = stay at SIM7600_BAUD)
+#define SIM7600_RTS -1  // ESP32 RTS -> SIM7600 CTS (-1 = not wired)
+#define SIM7600_CTS -1  // ESP32 CTS <- SIM7600 RTS (-1 = not wired)
+#define SIM7600_DTR -1  // ESP32 GPIO -> SIM7600 DTR (-1 = not wired, no DTR sleep)
+
+// ===== Power Management (see modem_power.h) =====
+// Latency vs. energy for this site: POWER_ALWAYS_ON, POWER_DTR_SLEEP,
+// POWER_PSM or POWER_OFF (the last two publish in bursts)
+#define POWER_MODE              POWER_ALWAYS_ON
+#define POWER_IDLE_MS           2000      // Modem idle → DTR sleep
+#define POWER_BURST_INTERVAL_MS 600000    // PSM / OFF: one burst every 10 minutes
+#define POWER_EDRX              NULL      // e.g. "0101" = 81.92 s paging cycle
+#define POWER_PSM_TAU           "00100001"  // T3412: 1 hour
+#define POWER_PSM_ACTIVE        "00000000"  // T3324: PSM right after the burst
 
 // ===== Network Configuration (Safaricom Kenya) =====
-// APN: safaricom
-// Username: saf
-// Password: data
-// These are configured in setupNetwork() function
+#define NETWORK_APN          "safaricom"
+#define NETWORK_APN_USER     "saf"
+#define NETWORK_APN_PASSWORD "data"
 
-HardwareSerial SIM7600(1); // Use Serial1
+// UART1 is driven through the ESP-IDF UART driver by at_uart.cpp
 
 // ===== MQTT Configuration - Shiftr.io (Testing without SSL) =====
-const char* mqtt_broker = "khamisembeddedtests.cloud.shiftr.io";
-const uint16_t mqtt_port = 1883;  // Plain MQTT (no SSL)
-const char* mqtt_user = "khamisembeddedtests";
-const char* mqtt_password = "EoYhF6hrBs1FGzFT";
-const char* mqtt_client_id = "SIM7600_ESP32_Client";
-
-// Original HiveMQ Cloud config (switch back once working):
+// One entry per modem client slot. Client IDs must differ - a broker drops
+// the older connection when a second one arrives with the same ID.
+const MqttBrokerConfig mqtt_clients[MQTT_CLIENT_COUNT] = {
+  // MQTT_CLIENT_TELEMETRY
+  { "khamisembeddedtests.cloud.shiftr.io", 1883,  // Plain MQTT (no SSL)
+    "khamisembeddedtests", "EoYhF6hrBs1FGzFT",
+    "SIM7600_ESP32_Client", 90, true, false },
+#if MQTT_CLIENT_COUNT > 1
+  // MQTT_CLIENT_CONTROL
+  { "khamisembeddedtests.cloud.shiftr.io", 1883,
+    "khamisembeddedtests", "EoYhF6hrBs1FGzFT",
+    "SIM7600_ESP32_Control", 60, true, false },
+#endif
+};
+
+// Original HiveMQ Cloud config (switch back once working) - port 8883 with
+// the last field (tls) set to true; root_ca below is uploaded to the modem
+// once and reused (mqtt_tls.h):
 // mqtt_broker = "ebd627a5b511476dae2e77a7aac9064b.s1.eu.hivemq.cloud"
 // mqtt_port = 8883
 // mqtt_user = "OctaviaAdmin"
@@ -95,6 +143,13 @@ const char* mqtt_client_id = "SIM7600_ESP32_Client";
 // Test topics
 const char* test_topic_pub = "test/sim7600/status";
 const char* test_topic_sub = "test/sim7600/command";
+const char* test_topic_cbor = "test/sim7600/telemetry/cbor";  // Binary telemetry (TELEMETRY_FORMAT_CBOR)
+const char* test_topic_do1 = "test/sim7600/do1";              // Relay commands for mcpDO_1 ("3=1,5=0")
+const char* test_topic_do1_state = "test/sim7600/do1/state";  // Output state + latency after each write
+const char* test_topic_metrics = "test/sim7600/metrics";      // Latency histograms + counters (metrics.h)
+const char* test_topic_bench = "test/sim7600/bench";          // "start" / "stop" a benchmark run (bench.h)
+const char* test_topic_bench_data = "test/sim7600/bench/data";
+const char* test_topic_bench_result = "test/sim7600/bench/result";
 
 // ===== HiveMQ Cloud Let's Encrypt CA Certificate =====
 const char *root_ca = 
@@ -131,50 +186,73 @@ const char *root_ca =
 "-----END CERTIFICATE-----\r\n";
 
 // ===== Global Variables =====
-String response = "";
 bool mqttConnected = false;
 
 // ===== FreeRTOS Task Handles and Synchronization =====
-TaskHandle_t xInitTaskHandle = NULL;
-TaskHandle_t xPublishTaskHandle = NULL;
+TaskHandle_t xPublishTaskHandle[MQTT_CLIENT_COUNT] = {};
+TaskHandle_t xTelemetryTaskHandle = NULL;
 TaskHandle_t xReceiveTaskHandle = NULL;
 TaskHandle_t xWatchdogTaskHandle = NULL;
-
-// Semaphore to protect SIM7600 UART access (shared resource)
-SemaphoreHandle_t xSIM7600Mutex = NULL;
-
-// Queue for publish requests (optional - for future expansion)
-QueueHandle_t xPublishQueue = NULL;
+TaskHandle_t xStoreReplayTaskHandle = NULL;
+TaskHandle_t xActuatorTaskHandle = NULL;
+TaskHandle_t xMetricsTaskHandle = NULL;
+TaskHandle_t xBenchTaskHandle = NULL;
 
 // Task priorities (higher number = higher priority)
-#define PRIORITY_INIT       4    // Highest - run first
 #define PRIORITY_WATCHDOG   3    // High - monitor connection
-#define PRIORITY_RECEIVE    2    // Medium-High - check incoming messages
-#define PRIORITY_PUBLISH    1    // Medium - periodic publishing
+#define PRIORITY_RECEIVE    3    // High - dispatches relay commands, never waits for the modem
+#define PRIORITY_PUBLISH    1    // Medium - drains the telemetry publish queue
+#define PRIORITY_PUBLISH_CONTROL 2  // Control publishes also jump the modem queue
+#define PRIORITY_TELEMETRY  1    // Medium - periodic sampling
 
 // Task stack sizes (in words, not bytes)
-#define STACK_SIZE_INIT     8192
 #define STACK_SIZE_PUBLISH  4096
 #define STACK_SIZE_RECEIVE  4096
 #define STACK_SIZE_WATCHDOG 2048
+#define STACK_SIZE_TELEMETRY 2048
+
+// Task cores (see task_cores.h) - publishing is modem I/O, the rest is application
+#define CORE_PUBLISH        CORE_MODEM_IO
+#define CORE_RECEIVE        CORE_APP
+#define CORE_WATCHDOG       CORE_APP
+#define CORE_TELEMETRY      CORE_APP
+
+// Telemetry batching - samples are published together when either limit hits
+// Set TELEMETRY_BATCH_SAMPLES to 1 to publish every sample on its own
+#define TELEMETRY_BATCH_SAMPLES    10     // Samples per publish
+#define TELEMETRY_BATCH_MAX_AGE_MS 10000  // Oldest sample may wait this long
+
+// Telemetry wire format (see telemetry.h / TELEMETRY_ENCODING.md)
+// TELEMETRY_FORMAT_TEXT → "Msg#N | Uptime:Ns" lines on test_topic_pub
+// TELEMETRY_FORMAT_CBOR → CBOR sequence of records on test_topic_cbor
+#define TELEMETRY_FORMAT           TELEMETRY_FORMAT_TEXT
 
 // ===== Function Declarations =====
 bool initMCP23017();
 void powerOnModule();
-String sendATCommand(const char* command, unsigned long timeout = 2000);
-bool waitForResponse(const char* expected, unsigned long timeout);
-bool setupNetwork();
-bool setupMQTT();
-bool connectMQTT();
-void publishMessage(const char* topic, const char* message);
 void checkIncomingMessages();
+void onMqttReady();
+void onCommandMessage(const InboundMsg& msg, void* ctx);
 
 // FreeRTOS Task Functions
-void vInitTask(void *pvParameters);
-void vPublishTask(void *pvParameters);
+void vTelemetryTask(void *pvParameters);
 void vReceiveTask(void *pvParameters);
 void vWatchdogTask(void *pvParameters);
 
+// Connection state machine settings (see conn_manager.h)
+const ConnConfig conn_config = {
+  SIM7600_BAUD, SIM7600_RX, SIM7600_TX,
+  SIM7600_UPSHIFT_BAUD, SIM7600_RTS, SIM7600_CTS,
+  NETWORK_APN, NETWORK_APN_USER, NETWORK_APN_PASSWORD,
+  powerConfigureModem,
+  onMqttReady,
+};
+
+const PowerConfig power_config = {
+  POWER_MODE, SIM7600_DTR, SIM7600_PWRKEY, POWER_IDLE_MS, POWER_BURST_INTERVAL_MS,
+  POWER_EDRX, POWER_PSM_TAU, POWER_PSM_ACTIVE,
+};
+
 void setup() {
   Serial.begin(115200);
   delay(1000);
@@ -183,55 +261,174 @@ void setup() {
   Serial.println("║  SIM7600 MQTT Client - FreeRTOS Edition     ║");
   Serial.println("╚═══════════════════════════════════════════════╝\n");
   
-  // Create mutex for SIM7600 UART protection
-  xSIM7600Mutex = xSemaphoreCreateMutex();
-  if (xSIM7600Mutex == NULL) {
-    Serial.println("✗ Failed to create mutex! Halting...");
+  // Create the modem command queue (ModemTask is the only UART writer)
+  if (!modemInit()) {
+    Serial.println("✗ Failed to create modem queue! Halting...");
     while(1) delay(1000);
   }
-  Serial.println("✓ Mutex created for UART protection");
+  Serial.println("✓ Modem command queue created");
+  
+  // Create AT engine queues (responses + URCs from the UART reader)
+  if (!atEngineInit()) {
+    Serial.println("✗ Failed to create AT engine queues! Halting...");
+    while(1) delay(1000);
+  }
+  Serial.println("✓ AT engine queues created");
+  
+  // Create publish queue (message slots are copied in by mqttPublishAsync)
+  if (!mqttPublishInit()) {
+    Serial.println("✗ Failed to create publish queue! Halting...");
+    while(1) delay(1000);
+  }
+  Serial.println("✓ Publish queue created");
+  
+#if OFFLINE_STORE_ENABLED
+  // PSRAM + flash log for messages published while the link is down
+  storeInit();
+#endif
   
-  // Create publish queue (capacity of 10 messages)
-  xPublishQueue = xQueueCreate(10, sizeof(char*) * 2);  // topic + message
-  if (xPublishQueue == NULL) {
-    Serial.println("⚠ Failed to create publish queue (non-critical)");
+  // Received messages are assembled in PSRAM and delivered by topic filter
+  if (!inboxInit()) {
+    Serial.println("⚠ Failed to allocate the inbox - received messages are only logged");
+  }
+  // Subscriptions (sent by ConnectionTask on every connect) and their handlers
+  mqttSubscribe(test_topic_sub, 1, onCommandMessage);
+  mqttSubscribe(test_topic_do1, 1, actuatorOnMessage);
+  mqttSubscribe(test_topic_bench, 1, benchOnMessage);
+  benchInit(test_topic_bench_data, test_topic_bench_result);
+  
+  // Broker settings per MQTT client and the connection state machine
+  for (uint8_t client = 0; client < MQTT_CLIENT_COUNT; client++) {
+    mqttClientConfigure(client, &mqtt_clients[client]);
+  }
+  mqttTlsConfigure(root_ca);  // Only used by clients with tls set
+  connInit(&conn_config);
+  
+  // MCP23017 drives PWRKEY and the digital outputs
+  if (!initMCP23017()) {
+    Serial.println("✗ Failed to initialize MCP23017! Halting...");
+    while(1) delay(1000);
+  }
+  // Relay commands drive every output except PWRKEY
+  if (!actuatorInit(&mcpDO_1, (uint16_t)~(1u << SIM7600_PWRKEY), test_topic_do1_state)) {
+    Serial.println("✗ Failed to create actuator queue! Halting...");
+    while(1) delay(1000);
+  }
+  // DTR sleep / PSM / power-off between bursts - PWRKEY goes through ActuatorTask
+  powerInit(&power_config);
+  
+  // Per-core load for the metrics document and the watchdog report
+  if (!metricsInit()) {
+    Serial.println("⚠ Idle hooks not installed - per-core load not measured");
   }
   
   // Create FreeRTOS tasks
   Serial.println("\n--- Creating FreeRTOS Tasks ---");
   
-  // Initialization Task (runs once, then deletes itself)
+  // UART Reader Task (sole reader of the SIM7600 UART)
   BaseType_t xReturned = xTaskCreatePinnedToCore(
-    vInitTask,              // Task function
-    "InitTask",             // Task name
-    STACK_SIZE_INIT,        // Stack size
+    vUartReaderTask,
+    "UartReaderTask",
+    STACK_SIZE_UART_READER,
+    NULL,
+    PRIORITY_UART_READER,
+    &xUartReaderTaskHandle,
+    CORE_UART_READER
+  );
+  
+  if (xReturned != pdPASS) {
+    Serial.println("✗ Failed to create UartReaderTask! Halting...");
+    while(1) delay(1000);
+  }
+  Serial.println("✓ UartReaderTask created");
+  
+  // Actuator Task (sole runtime writer of mcpDO_1, relay commands)
+  xReturned = xTaskCreatePinnedToCore(
+    vActuatorTask,
+    "ActuatorTask",
+    STACK_SIZE_ACTUATOR,
+    NULL,
+    PRIORITY_ACTUATOR,
+    &xActuatorTaskHandle,
+    CORE_ACTUATOR
+  );
+  
+  if (xReturned != pdPASS) {
+    Serial.println("✗ Failed to create ActuatorTask! Halting...");
+    while(1) delay(1000);
+  }
+  Serial.println("✓ ActuatorTask created");
+  
+  // Modem Task (sole writer of the SIM7600 UART, serves AT requests)
+  xReturned = xTaskCreatePinnedToCore(
+    vModemTask,
+    "ModemTask",
+    STACK_SIZE_MODEM,
+    NULL,
+    PRIORITY_MODEM,
+    &xModemTaskHandle,
+    CORE_MODEM
+  );
+  
+  if (xReturned != pdPASS) {
+    Serial.println("✗ Failed to create ModemTask! Halting...");
+    while(1) delay(1000);
+  }
+  Serial.println("✓ ModemTask created");
+  
+  // Connection Task (modem / network / MQTT state machine, never exits)
+  xReturned = xTaskCreatePinnedToCore(
+    vConnectionTask,        // Task function
+    "ConnectionTask",       // Task name
+    STACK_SIZE_CONNECTION,  // Stack size
     NULL,                   // Parameters
-    PRIORITY_INIT,          // Priority
-    &xInitTaskHandle,       // Task handle
-    1                       // Core 1 (0 = protocol core, 1 = app core)
+    PRIORITY_CONNECTION,    // Priority
+    &xConnectionTaskHandle, // Task handle
+    CORE_CONNECTION         // Core (see task_cores.h)
   );
   
   if (xReturned != pdPASS) {
-    Serial.println("✗ Failed to create InitTask! Halting...");
+    Serial.println("✗ Failed to create ConnectionTask! Halting...");
     while(1) delay(1000);
   }
-  Serial.println("✓ InitTask created");
+  Serial.println("✓ ConnectionTask created");
+  
+  // Publish Tasks (one per MQTT client, each drains its own queue)
+  for (uint8_t client = 0; client < MQTT_CLIENT_COUNT; client++) {
+    char name[16];
+    snprintf(name, sizeof(name), "PublishTask%u", (unsigned)client);
+    xReturned = xTaskCreatePinnedToCore(
+      vPublishTask,
+      name,
+      STACK_SIZE_PUBLISH,
+      (void*)(uintptr_t)client,
+      client == MQTT_CLIENT_TELEMETRY ? PRIORITY_PUBLISH : PRIORITY_PUBLISH_CONTROL,
+      &xPublishTaskHandle[client],
+      CORE_PUBLISH
+    );
+    
+    if (xReturned != pdPASS) {
+      Serial.printf("✗ Failed to create %s!\n", name);
+    } else {
+      Serial.printf("✓ %s created\n", name);
+    }
+  }
   
-  // Publish Task (periodic status publishing)
+  // Telemetry Task (periodic status samples)
   xReturned = xTaskCreatePinnedToCore(
-    vPublishTask,
-    "PublishTask",
-    STACK_SIZE_PUBLISH,
+    vTelemetryTask,
+    "TelemetryTask",
+    STACK_SIZE_TELEMETRY,
     NULL,
-    PRIORITY_PUBLISH,
-    &xPublishTaskHandle,
-    1
+    PRIORITY_TELEMETRY,
+    &xTelemetryTaskHandle,
+    CORE_TELEMETRY
   );
   
   if (xReturned != pdPASS) {
-    Serial.println("✗ Failed to create PublishTask!");
+    Serial.println("✗ Failed to create TelemetryTask!");
   } else {
-    Serial.println("✓ PublishTask created");
+    Serial.println("✓ TelemetryTask created");
   }
   
   // Receive Task (monitor incoming MQTT messages)
@@ -242,7 +439,7 @@ void setup() {
     NULL,
     PRIORITY_RECEIVE,
     &xReceiveTaskHandle,
-    1
+    CORE_RECEIVE
   );
   
   if (xReturned != pdPASS) {
@@ -251,6 +448,78 @@ void setup() {
     Serial.println("✓ ReceiveTask created");
   }
   
+#if OFFLINE_STORE_ENABLED
+  // Store Replay Task (drains the offline store after a reconnect)
+  xReturned = xTaskCreatePinnedToCore(
+    vStoreReplayTask,
+    "StoreReplayTask",
+    STACK_SIZE_STORE_REPLAY,
+    NULL,
+    PRIORITY_STORE_REPLAY,
+    &xStoreReplayTaskHandle,
+    CORE_STORE_REPLAY
+  );
+  
+  if (xReturned != pdPASS) {
+    Serial.println("⚠ Failed to create StoreReplayTask (stored messages stay in flash)");
+  } else {
+    Serial.println("✓ StoreReplayTask created");
+  }
+#endif
+  
+  // Metrics Task (publishes latency histograms + counters)
+  xReturned = xTaskCreatePinnedToCore(
+    vMetricsTask,
+    "MetricsTask",
+    STACK_SIZE_METRICS,
+    (void*)test_topic_metrics,
+    PRIORITY_METRICS,
+    &xMetricsTaskHandle,
+    CORE_METRICS
+  );
+  
+  if (xReturned != pdPASS) {
+    Serial.println("⚠ Failed to create MetricsTask (non-critical)");
+  } else {
+    Serial.println("✓ MetricsTask created");
+  }
+  
+  // Bench Task (idle until a benchmark run is started)
+  xReturned = xTaskCreatePinnedToCore(
+    vBenchTask,
+    "BenchTask",
+    STACK_SIZE_BENCH,
+    NULL,
+    PRIORITY_BENCH,
+    &xBenchTaskHandle,
+    CORE_BENCH
+  );
+  
+  if (xReturned != pdPASS) {
+    Serial.println("⚠ Failed to create BenchTask (non-critical)");
+  } else {
+    Serial.println("✓ BenchTask created");
+  }
+  
+  // Power Task (wake / drain / sleep cycle, burst modes only)
+  if (powerBurstMode()) {
+    xReturned = xTaskCreatePinnedToCore(
+      vPowerTask,
+      "PowerTask",
+      STACK_SIZE_POWER,
+      NULL,
+      PRIORITY_POWER,
+      &xPowerTaskHandle,
+      CORE_POWER
+    );
+    
+    if (xReturned != pdPASS) {
+      Serial.println("⚠ Failed to create PowerTask (modem stays awake)");
+    } else {
+      Serial.println("✓ PowerTask created");
+    }
+  }
+  
   // Watchdog Task (monitor connection health)
   xReturned = xTaskCreatePinnedToCore(
     vWatchdogTask,
@@ -259,7 +528,7 @@ void setup() {
     NULL,
     PRIORITY_WATCHDOG,
     &xWatchdogTaskHandle,
-    1
+    CORE_WATCHDOG
   );
   
   if (xReturned != pdPASS) {
@@ -282,16 +551,17 @@ void loop() {
 bool initMCP23017() {
   Serial.println("--- Initializing MCP23017 ---");
   
-  if (!mcpDO_1.begin_I2C(DO_1_ADDR)) {
+  if (!mcpPortBegin(&mcpDO_1, DO_1_ADDR)) {
     Serial.printf("✗ Failed to initialize MCP23017 at 0x%02X\n", DO_1_ADDR);
     return false;
   }
-  Serial.printf("✓ MCP23017 at 0x%02X initialized\n", DO_1_ADDR);
+  Serial.printf("✓ MCP23017 at 0x%02X initialized (I2C %lu kHz)\n", DO_1_ADDR,
+                (unsigned long)(MCP_I2C_CLOCK_HZ / 1000));
   
-  // Configure all pins as outputs and set to LOW
-  for (int i = 0; i < 16; i++) {
-    mcpDO_1.pinMode(i, OUTPUT);
-    mcpDO_1.digitalWrite(i, LOW);
+  // Configure all pins as outputs and set to LOW - latch, then direction
+  if (!mcpPortSetDirection(&mcpDO_1, 0xFFFF, 0x0000)) {
+    Serial.println("✗ Failed to configure outputs");
+    return false;
   }
   
   Serial.println("✓ All outputs configured\n");
@@ -301,537 +571,202 @@ bool initMCP23017() {
 void powerOnModule() {
   Serial.println("--- Powering On SIM7600 Module ---");
   
-  // PWRKEY power-on sequence
-  mcpDO_1.digitalWrite(SIM7600_PWRKEY, HIGH);
+  // PWRKEY power-on sequence (one port write per edge)
+  mcpPortWritePin(&mcpDO_1, SIM7600_PWRKEY, HIGH);
+  mcpPortFlush(&mcpDO_1);
   delay(300);
   
   Serial.println("Pulling PWRKEY LOW...");
-  mcpDO_1.digitalWrite(SIM7600_PWRKEY, LOW);
+  mcpPortWritePin(&mcpDO_1, SIM7600_PWRKEY, LOW);
+  mcpPortFlush(&mcpDO_1);
   delay(1500);
   
   Serial.println("Setting PWRKEY HIGH...");
-  mcpDO_1.digitalWrite(SIM7600_PWRKEY, HIGH);
+  mcpPortWritePin(&mcpDO_1, SIM7600_PWRKEY, HIGH);
+  mcpPortFlush(&mcpDO_1);
   
   Serial.println("Waiting for module boot (10 seconds)...");
   delay(10000);
   Serial.println("✓ Module powered on\n");
 }
 
-String sendATCommand(const char* command, unsigned long timeout) {
-  Serial.printf(">> %s\n", command);
-  SIM7600.println(command);
+void checkIncomingMessages() {
+  // URC lines are queued by UartReaderTask - nothing here touches the UART.
+  // MQTT message format:
+  // +CMQTTRXSTART: 0,<topic_len>,<payload_len>
+  // +CMQTTRXTOPIC: 0,<length>
+  // <actual topic string>
+  // +CMQTTRXPAYLOAD: 0,<length>
+  // <actual payload data>
+  // +CMQTTRXEND: 0
+  // Only the header lines reach this queue - UartReaderTask puts topic and
+  // payload into the inbox, and the message is complete at +CMQTTRXEND.
   
-  response = "";
-  unsigned long startTime = millis();
+  // Block until the first URC arrives, then drain whatever else is queued
+  TickType_t wait = pdMS_TO_TICKS(1000);
+  AtLine line;
   
-  while (millis() - startTime < timeout) {
-    while (SIM7600.available()) {
-      char c = SIM7600.read();
-      response += c;
-      Serial.print(c); // Print response in real-time
-    }
+  while (atNextUrcLine(&line, wait)) {
+    wait = 0;
+    const char* text = line.text;
     
-    if (response.indexOf("OK") != -1 || response.indexOf("ERROR") != -1) {
-      break;
+    // Detect start of MQTT message
+    if (strncmp(text, "+CMQTTRXSTART", 13) == 0) {
+      Serial.println("\n📨 ===== INCOMING MQTT MESSAGE =====");
+      Serial.println(text);
     }
-  }
-  
-  if (response.length() == 0) {
-    Serial.println("⚠ No response (timeout)");
-  } else if (response.indexOf("ERROR") != -1) {
-    Serial.println("⚠ Command returned ERROR");
-  }
-  Serial.println();
-  
-  return response;
-}
-
-bool waitForResponse(const char* expected, unsigned long timeout) {
-  unsigned long startTime = millis();
-  String buffer = "";
-  
-  while (millis() - startTime < timeout) {
-    while (SIM7600.available()) {
-      char c = SIM7600.read();
-      buffer += c;
-      Serial.print(c);
+    // Detect end of MQTT message - hand it to the registered handlers
+    else if (strncmp(text, "+CMQTTRXEND", 11) == 0) {
+      Serial.println(text);
+      inboxDispatch();
+      Serial.println("📨 ===== END OF MESSAGE =====\n");
     }
-    
-    if (buffer.indexOf(expected) != -1) {
-      return true;
+    else if (strncmp(text, "+CMQTTRX", 8) == 0) {
+      Serial.println(text);  // Header line
     }
-  }
-  
-  return false;
-}
-
-bool setupNetwork() {
-  Serial.println("--- Setting Up Network Connection ---");
-  
-  // Check SIM card status
-  Serial.println("Checking SIM card...");
-  sendATCommand("AT+CPIN?");
-  if (response.indexOf("READY") == -1) {
-    Serial.println("✗ SIM card not ready!");
-    return false;
-  }
-  
-  // Check network registration
-  Serial.println("Checking network registration...");
-  bool registered = false;
-  for (int i = 0; i < 20; i++) {
-    sendATCommand("AT+CREG?", 1000);
-    if (response.indexOf(",1") != -1 || response.indexOf(",5") != -1) {
-      Serial.println("✓ Registered on network");
-      registered = true;
-      break;
+    // Connection-level URCs (+CMQTTCONNLOST, +CMQTTNONET)
+    else {
+      Serial.printf("📡 URC: %s\n", text);
+      if (strncmp(text, "+CMQTTCONNLOST", 14) == 0) {
+        // +CMQTTCONNLOST: <client>,<cause> - ConnectionTask reconnects it
+        int client = mqttClientIndexOf(text);
+        if (client >= 0) {
+          connNotifyLinkLost(client);
+        }
+      } else if (strncmp(text, "+CMQTTNONET", 11) == 0) {
+        // Network gone - affects every client
+        connNotifyLinkLost(-1);
+      }
     }
-    Serial.printf("Waiting for network... (%d/20)\n", i+1);
-    delay(2000);
-  }
-  
-  if (!registered) {
-    Serial.println("✗ Failed to register on network!");
-    return false;
-  }
-  
-  // Check signal quality
-  sendATCommand("AT+CSQ");
-  
-  // Configure APN for Safaricom Kenya
-  Serial.println("Configuring Safaricom APN...");
-  sendATCommand("AT+CGDCONT=1,\"IP\",\"safaricom\"");
-  
-  // Set authentication (PAP or CHAP)
-  Serial.println("Setting APN authentication...");
-  sendATCommand("AT+CGAUTH=1,1,\"saf\",\"data\"");  // 1=PAP auth, username, password
-  
-  // Just wait - the tutorials show no special setup needed!
-  // PDP context activation via AT+CREG is enough
-  Serial.println("Waiting for network to stabilize...");
-  vTaskDelay(pdMS_TO_TICKS(5000));
-  
-  Serial.println("✓ Network connection established\n");
-  return true;
-}
-
-bool setupMQTT() {
-  Serial.println("\n--- Setting Up MQTT Configuration ---");
-  
-  char cmd[300];
-  
-  // Following the tutorial approach - simple sequence
-  // Note: Initial errors (21, 23) are NORMAL and can be ignored
-  Serial.println("Stopping any existing MQTT service...");
-  sendATCommand("AT+CMQTTSTOP", 3000);
-  // Error 21 = "operation not allowed" (nothing to stop) - IGNORE
-  vTaskDelay(pdMS_TO_TICKS(1000));
-  
-  Serial.println("Releasing any existing MQTT client...");
-  sendATCommand("AT+CMQTTREL=0", 2000);
-  vTaskDelay(pdMS_TO_TICKS(1000));
-  
-  // Start MQTT service
-  Serial.println("Starting MQTT service...");
-  sendATCommand("AT+CMQTTSTART", 5000);
-  // Error 23 = "network not ready" but service may still start - IGNORE
-  vTaskDelay(pdMS_TO_TICKS(2000));
-  
-  Serial.println("✓ MQTT service initialized");
-  vTaskDelay(pdMS_TO_TICKS(1000));
-  
-  // Acquire MQTT client - this should succeed
-  Serial.println("Acquiring MQTT client...");
-  snprintf(cmd, sizeof(cmd), "AT+CMQTTACCQ=0,\"%s\"", mqtt_client_id);
-  sendATCommand(cmd, 5000);
-  vTaskDelay(pdMS_TO_TICKS(500));
-  
-  if (response.indexOf("OK") != -1) {
-    Serial.println("✓ MQTT client acquired successfully!");
-  } else {
-    Serial.println("⚠ Client acquisition response unclear, continuing...");
-  }
-  
-  // Configure MQTT receive mode - enable unsolicited result codes
-  Serial.println("Configuring MQTT receive mode...");
-  
-  // Try setting receive mode (some firmware versions might not support this)
-  sendATCommand("AT+CMQTTCFG=\"recv/mode\",0,1", 3000);
-  if (response.indexOf("ERROR") != -1) {
-    Serial.println("⚠ CMQTTCFG not supported, using default mode");
+    
+    atReleaseLine(line);
   }
-  vTaskDelay(pdMS_TO_TICKS(500));
-  
-  // Query current receive mode for verification
-  Serial.println("Checking receive mode...");
-  sendATCommand("AT+CMQTTCFG?", 3000);
-  vTaskDelay(pdMS_TO_TICKS(500));
-  
-  Serial.println("✓ MQTT configuration complete\n");
-  return true;
 }
 
-bool connectMQTT() {
-  Serial.println("--- Connecting to MQTT Broker ---");
-  Serial.printf("Broker: %s:%d\n", mqtt_broker, mqtt_port);
-  Serial.printf("Client ID: %s\n", mqtt_client_id);
-  
-  char cmd[300];
-  
-  // Build connection string: "tcp://broker:port"
-  char broker_url[200];
-  snprintf(broker_url, sizeof(broker_url), "tcp://%s:%d", mqtt_broker, mqtt_port);
-  
-  // Connect to broker - matching tutorial approach
-  Serial.println("Opening MQTT connection...");
-  snprintf(cmd, sizeof(cmd), "AT+CMQTTCONNECT=0,\"%s\",90,1,\"%s\",\"%s\"", 
-           broker_url, mqtt_user, mqtt_password);
-  sendATCommand(cmd, 30000);
-  vTaskDelay(pdMS_TO_TICKS(5000));  // Allow time for connection handshake
-  
-  // Check for connection success: +CMQTTCONNECT: 0,0 means SUCCESS
-  if (response.indexOf("+CMQTTCONNECT: 0,0") != -1) {
-    Serial.println("✓✓✓ MQTT CONNECTED SUCCESSFULLY! ✓✓✓");
-  } else {
-    Serial.println("⚠ Connection response unclear, but continuing...");
-  }
-  vTaskDelay(pdMS_TO_TICKS(2000));
-  
-  // Unsubscribe any existing subscription first (clean slate)
-  Serial.println("Clearing any old subscriptions...");
-  sendATCommand("AT+CMQTTUNSUB=0", 3000);
-  vTaskDelay(pdMS_TO_TICKS(500));
-  
-  // Subscribe - using tutorial 2 method (CMQTTSUBTOPIC first)
-  Serial.printf("Setting up subscription topic: %s\n", test_topic_sub);
-  
-  int topicLen = strlen(test_topic_sub);
-  
-  // Step 1: Set topic length and QoS
-  snprintf(cmd, sizeof(cmd), "AT+CMQTTSUBTOPIC=0,%d,1", topicLen);
-  sendATCommand(cmd, 3000);
-  vTaskDelay(pdMS_TO_TICKS(500));
-  
-  // Step 2: Send the actual topic string
-  SIM7600.println(test_topic_sub);
-  Serial.printf(">> %s\n", test_topic_sub);
-  vTaskDelay(pdMS_TO_TICKS(1000));
-  
-  // Read response
-  response = "";
-  unsigned long start = millis();
-  while (millis() - start < 2000) {
-    while (SIM7600.available()) {
-      char c = SIM7600.read();
-      response += c;
-      Serial.print(c);
-    }
-    if (response.indexOf("OK") != -1 || response.indexOf("ERROR") != -1) break;
-  }
-  Serial.println();
-  
-  // Step 3: Actually subscribe (QoS 1, no retain)
-  Serial.println("Subscribing to topic...");
-  sendATCommand("AT+CMQTTSUB=0", 5000);
-  vTaskDelay(pdMS_TO_TICKS(2000));
-  
-  // Check subscription
-  if (response.indexOf("+CMQTTSUB: 0,0") != -1 || response.indexOf("OK") != -1) {
-    Serial.println("✓ Subscribed successfully!");
-  } else if (response.indexOf("+CMQTTSUB: 0,12") != -1) {
-    Serial.println("⚠ Subscription error 12 (topic format issue?), but continuing...");
-  } else if (response.indexOf("+CMQTTSUB: 0,11") != -1) {
-    Serial.println("⚠ Subscription error 11 (not connected to broker?)");
-  } else {
-    Serial.println("⚠ Subscription response unclear");
-    Serial.println(response);
-  }
-  
+/**
+ * @brief Called by ConnectionTask each time the MQTT session comes up
+ */
+void onMqttReady() {
   // Print test instructions
   Serial.println("\n╔══════════════════════════════════════════════════════╗");
   Serial.println("║  📨 MQTT RECEIVE TEST                               ║");
   Serial.println("╚══════════════════════════════════════════════════════╝");
-  Serial.printf("   Subscribed to: %s\n", test_topic_sub);
-  Serial.printf("   Publishing to: %s\n", test_topic_pub);
+  Serial.printf("   Subscribed to: %s (client %u)\n", test_topic_sub, (unsigned)MQTT_CLIENT_CONTROL);
+  Serial.printf("   Publishing to: %s (client %u)\n", test_topic_pub, (unsigned)MQTT_CLIENT_TELEMETRY);
+  Serial.printf("   Relay commands: %s (e.g. \"3=1,5=0\"), state on %s\n", test_topic_do1, test_topic_do1_state);
   Serial.println("\n   To test receive, publish a message to:");
   Serial.printf("   Topic: %s\n", test_topic_sub);
   Serial.println("   Example: \"Hello SIM7600!\"");
   Serial.println("   Use your MQTT client or Shiftr.io web interface\n");
   
-  Serial.println("✓ MQTT setup complete\n");
-  return true;
-}
-
-void publishMessage(const char* topic, const char* message) {
-  char cmd[400];
-  
-  // Optimized for high-frequency publishing
-  // Reduced delays from 1000ms to 200ms (still safe, but 5x faster)
-  
-  int topicLen = strlen(topic);
-  int msgLen = strlen(message);
-  
-  // Set topic length and send topic
-  snprintf(cmd, sizeof(cmd), "AT+CMQTTTOPIC=0,%d", topicLen);
-  SIM7600.println(cmd);
-  vTaskDelay(pdMS_TO_TICKS(200));  // Reduced delay for speed
-  
-  SIM7600.println(topic);
-  vTaskDelay(pdMS_TO_TICKS(200));
-  
-  // Set payload length and send payload
-  snprintf(cmd, sizeof(cmd), "AT+CMQTTPAYLOAD=0,%d", msgLen);
-  SIM7600.println(cmd);
-  vTaskDelay(pdMS_TO_TICKS(200));
-  
-  SIM7600.println(message);
-  vTaskDelay(pdMS_TO_TICKS(200));
-  
-  // Publish with QoS 1, timeout 60 seconds
-  SIM7600.println("AT+CMQTTPUB=0,1,60");
-  vTaskDelay(pdMS_TO_TICKS(200));
-  
-  Serial.printf("✓ Published: %s → %s\n", topic, message);
-}
-
-void checkIncomingMessages() {
-  // Check for ANY data from SIM7600 (MQTT messages, URCs, etc.)
-  // We're now receiving MQTT messages! Format:
-  // +CMQTTRXSTART: 0,<topic_len>,<payload_len>
-  // +CMQTTRXTOPIC: 0,<length>
-  // <actual topic string>              ← We need to catch this!
-  // +CMQTTRXPAYLOAD: 0,<length>
-  // <actual payload data>              ← And this!
-  // +CMQTTRXEND: 0
-  
-  static String rxBuffer = "";
-  static bool inMqttMessage = false;  // Track if we're inside an MQTT message
-  
-  // Read all available data
-  while (SIM7600.available()) {
-    char c = SIM7600.read();
-    rxBuffer += c;
-    
-    // Check if we have a complete line
-    if (c == '\n') {
-      String line = rxBuffer;
-      line.trim();
-      
-      // Detect start of MQTT message
-      if (line.indexOf("+CMQTTRXSTART") != -1) {
-        inMqttMessage = true;
-        Serial.println("\n📨 ===== INCOMING MQTT MESSAGE =====");
-        Serial.println(line);
-      }
-      // Detect end of MQTT message
-      else if (line.indexOf("+CMQTTRXEND") != -1) {
-        Serial.println(line);
-        Serial.println("📨 ===== END OF MESSAGE =====\n");
-        inMqttMessage = false;
-      }
-      // Show ALL lines when inside MQTT message (including data!)
-      else if (inMqttMessage && line.length() > 0) {
-        // This is either a header or actual data
-        if (line.startsWith("+CMQTTRX")) {
-          Serial.println(line);  // Header line
-        } else {
-          // This is the actual topic or payload data!
-          Serial.println("   📩 DATA: " + line);
-        }
-      }
-      // Check for other MQTT receive indicators
-      else if (line.indexOf("CMQTTRX") != -1 || 
-               line.indexOf("PAYLOAD") != -1) {
-        Serial.println("📨 MQTT RX: " + line);
-      }
-      // Show other unsolicited result codes
-      else if (line.startsWith("+") && line.length() > 1) {
-        Serial.println("📡 URC: " + line);
-      }
-      
-      rxBuffer = "";
-    }
-  }
-  
-  // If buffer gets too large without newline, print and clear
-  if (rxBuffer.length() > 512) {
-    Serial.println("📨 MQTT RX (buffer): " + rxBuffer);
-    rxBuffer = "";
-  }
+  // Publish initial status message
+  Serial.println("Queueing initial status message...");
+  mqttPublishAsync(test_topic_pub, "SIM7600 online! [FreeRTOS]");
 }
 
-// ===== FreeRTOS Task Implementations =====
-
 /**
- * @brief Initialization Task - Sets up MCP23017, SIM7600, Network, and MQTT
- * @note This task runs once and then deletes itself after successful init
+ * @brief Handler for the command topic
+ * @note Runs in ReceiveTask; msg points into the inbox and is only valid
+ *       until this returns
  */
-void vInitTask(void *pvParameters) {
-  Serial.println("🚀 InitTask started on Core 1");
-  
-  // Wait a bit for other tasks to settle
-  vTaskDelay(pdMS_TO_TICKS(500));
+void onCommandMessage(const InboundMsg& msg, void* ctx) {
+  Serial.printf("   📩 Topic: %.*s\n", (int)msg.topicLen, msg.topic);
   
-  // Initialize MCP23017
-  if (!initMCP23017()) {
-    Serial.println("✗ Failed to initialize MCP23017! Halting...");
-    mqttConnected = false;
-    vTaskDelete(NULL);  // Delete this task
-    return;
+  bool printable = true;
+  for (uint32_t i = 0; i < msg.payloadLen && printable; i++) {
+    printable = msg.payload[i] >= 0x20 || msg.payload[i] == '\n' ||
+                msg.payload[i] == '\r' || msg.payload[i] == '\t';
   }
-  
-  // Initialize SIM7600 UART
-  SIM7600.begin(SIM7600_BAUD, SERIAL_8N1, SIM7600_RX, SIM7600_TX);
-  Serial.printf("✓ UART initialized on RX:%d, TX:%d at %d baud\n", 
-                SIM7600_RX, SIM7600_TX, SIM7600_BAUD);
-  
-  // Skip PWRKEY - module should already be on
-  Serial.println("Skipping PWRKEY sequence (module should already be on)...");
-  Serial.println("Waiting for module to stabilize...");
-  vTaskDelay(pdMS_TO_TICKS(3000));
-  
-  // Basic module test
-  Serial.println("\n--- Testing Module Communication ---");
-  
-  // Acquire mutex before using SIM7600 UART
-  if (xSemaphoreTake(xSIM7600Mutex, pdMS_TO_TICKS(5000)) == pdTRUE) {
-    sendATCommand("AT");
-    
-    if (response.indexOf("OK") == -1 && response.indexOf("AT") == -1) {
-      Serial.println("✗ Module not responding! Check connections.");
-      xSemaphoreGive(xSIM7600Mutex);
-      mqttConnected = false;
-      vTaskDelete(NULL);
-      return;
-    }
-    
-    Serial.println("✓ Module responding!");
-    sendATCommand("ATE0");  // Disable echo
-    sendATCommand("ATI");   // Module info
-    
-    xSemaphoreGive(xSIM7600Mutex);  // Release mutex
-  } else {
-    Serial.println("✗ Failed to acquire mutex for AT commands!");
-    vTaskDelete(NULL);
-    return;
-  }
-  
-  // Setup network connection
-  if (xSemaphoreTake(xSIM7600Mutex, pdMS_TO_TICKS(30000)) == pdTRUE) {
-    if (!setupNetwork()) {
-      Serial.println("✗ Network setup failed! Check SIM card and signal.");
-      xSemaphoreGive(xSIM7600Mutex);
-      mqttConnected = false;
-      vTaskDelete(NULL);
-      return;
-    }
-    xSemaphoreGive(xSIM7600Mutex);
-  } else {
-    Serial.println("✗ Failed to acquire mutex for network setup!");
-    vTaskDelete(NULL);
-    return;
-  }
-  
-  // Setup MQTT
-  if (xSemaphoreTake(xSIM7600Mutex, pdMS_TO_TICKS(30000)) == pdTRUE) {
-    if (!setupMQTT()) {
-      Serial.println("✗ MQTT setup failed!");
-      xSemaphoreGive(xSIM7600Mutex);
-      mqttConnected = false;
-      vTaskDelete(NULL);
-      return;
-    }
-    xSemaphoreGive(xSIM7600Mutex);
+  if (printable) {
+    Serial.printf("   📩 Payload (%lu bytes): %.*s\n", (unsigned long)msg.payloadLen,
+                  (int)msg.payloadLen, (const char*)msg.payload);
   } else {
-    Serial.println("✗ Failed to acquire mutex for MQTT setup!");
-    vTaskDelete(NULL);
-    return;
+    Serial.printf("   📩 Payload (%lu bytes, binary)\n", (unsigned long)msg.payloadLen);
   }
-  
-  // Connect to MQTT broker
-  if (xSemaphoreTake(xSIM7600Mutex, pdMS_TO_TICKS(30000)) == pdTRUE) {
-    if (!connectMQTT()) {
-      Serial.println("✗ MQTT connection failed!");
-      xSemaphoreGive(xSIM7600Mutex);
-      mqttConnected = false;
-      vTaskDelete(NULL);
-      return;
-    }
-    xSemaphoreGive(xSIM7600Mutex);
-  } else {
-    Serial.println("✗ Failed to acquire mutex for MQTT connect!");
-    vTaskDelete(NULL);
-    return;
-  }
-  
-  // Success!
-  mqttConnected = true;
-  Serial.println("\n✓✓✓ System ready! MQTT connected. ✓✓✓");
-  
-  // Publish initial status message
-  if (xSemaphoreTake(xSIM7600Mutex, pdMS_TO_TICKS(10000)) == pdTRUE) {
-    Serial.println("Publishing initial status message...");
-    publishMessage(test_topic_pub, "SIM7600 online! [FreeRTOS]");
-    xSemaphoreGive(xSIM7600Mutex);
-  }
-  
-  Serial.println("🎯 InitTask completed successfully - deleting self");
-  
-  // Delete this task (no longer needed)
-  vTaskDelete(NULL);
 }
 
+// ===== FreeRTOS Task Implementations =====
+
 /**
- * @brief Publish Task - Periodically publishes status messages
- * @note Runs continuously every 30 seconds
+ * @brief Telemetry Task - Produces a status sample every second
+ * @note Samples are batched (one line each) and the batch is queued for
+ *       PublishTask - this task never waits for the modem
  */
-void vPublishTask(void *pvParameters) {
-  Serial.println("📤 PublishTask started on Core 1");
+void vTelemetryTask(void *pvParameters) {
+  Serial.printf("📊 TelemetryTask started on core %d\n", (int)xPortGetCoreID());
   
+#if !OFFLINE_STORE_ENABLED
   // Wait for initialization to complete
   while (!mqttConnected) {
     vTaskDelay(pdMS_TO_TICKS(1000));
   }
+#endif
   
-  Serial.println("📤 PublishTask active - will publish every 1 second (HIGH FREQUENCY TEST)");
+  Serial.println("📊 TelemetryTask active - will publish every 1 second (HIGH FREQUENCY TEST)");
   
   TickType_t xLastWakeTime = xTaskGetTickCount();
   const TickType_t xFrequency = pdMS_TO_TICKS(1000);  // 1 second (for data logging testing)
   
   unsigned long messageCount = 0;  // Track message sequence
   
+  MqttBatch batch;  // Payload lives in a pool buffer, not on this stack
+#if TELEMETRY_FORMAT == TELEMETRY_FORMAT_CBOR
+  // CBOR records are self-delimiting - no separator between them
+  batchInit(&batch, test_topic_cbor, TELEMETRY_BATCH_SAMPLES, TELEMETRY_BATCH_MAX_AGE_MS, 0);
+#else
+  batchInit(&batch, test_topic_pub, TELEMETRY_BATCH_SAMPLES, TELEMETRY_BATCH_MAX_AGE_MS);
+#endif
+  
   while (1) {
     // Wait for next cycle
     vTaskDelayUntil(&xLastWakeTime, xFrequency);
     
+    // Time-based flush for a batch that didn't fill up
+    batchPoll(&batch);
+    
+    // A benchmark run owns the telemetry client
+    if (benchRunning()) {
+      continue;
+    }
+    
+#if !OFFLINE_STORE_ENABLED
     if (!mqttConnected) {
       Serial.println("⚠ MQTT not connected, skipping publish");
       continue;
     }
+#endif
+    // With the offline store, samples keep flowing during outages and are
+    // parked in flash by mqttPublishSubmit()
     
-    // Prepare message with sequence number for tracking
+    // Prepare record with sequence number for tracking
     messageCount++;
-    char msg[100];
-    unsigned long uptime = millis() / 1000;
-    snprintf(msg, sizeof(msg), "Msg#%lu | Uptime:%lus", messageCount, uptime);
+    TelemetryRecord rec;
+    rec.seq = messageCount;
+    rec.uptimeS = millis() / 1000;
+    rec.freeHeap = ESP.getFreeHeap();
+    
+#if TELEMETRY_FORMAT == TELEMETRY_FORMAT_CBOR
+    uint8_t msg[TELEMETRY_RECORD_MAX];
+    size_t len = telemetryEncodeCbor(rec, msg, sizeof(msg));
+#else
+    char msg[TELEMETRY_RECORD_MAX];
+    size_t len = telemetryEncodeText(rec, msg, sizeof(msg));
+#endif
     
-    // Acquire mutex before publishing
-    if (xSemaphoreTake(xSIM7600Mutex, pdMS_TO_TICKS(10000)) == pdTRUE) {
-      Serial.printf("📤 Publishing: %s\n", msg);
-      publishMessage(test_topic_pub, msg);
-      xSemaphoreGive(xSIM7600Mutex);
+    if (len > 0 && batchAdd(&batch, msg, len)) {
+      Serial.printf("📤 Batched: #%lu (%u bytes)\n", messageCount, (unsigned)len);
     } else {
-      Serial.println("⚠ Failed to acquire mutex for publish!");
+      Serial.printf("⚠ Publish queue full, dropped: #%lu\n", messageCount);
     }
   }
 }
 
 /**
- * @brief Receive Task - Monitors incoming MQTT messages
- * @note Runs continuously, checking every 100ms
+ * @brief Receive Task - Processes incoming MQTT messages
+ * @note Blocks on the URC queue - wakes as soon as UartReaderTask queues a line
  */
 void vReceiveTask(void *pvParameters) {
-  Serial.println("📥 ReceiveTask started on Core 1");
+  Serial.printf("📥 ReceiveTask started on core %d\n", (int)xPortGetCoreID());
   
   // Wait for initialization to complete
   while (!mqttConnected) {
@@ -841,16 +776,8 @@ void vReceiveTask(void *pvParameters) {
   Serial.println("📥 ReceiveTask active - monitoring incoming messages");
   
   while (1) {
-    if (mqttConnected) {
-      // Acquire mutex before checking messages
-      if (xSemaphoreTake(xSIM7600Mutex, pdMS_TO_TICKS(500)) == pdTRUE) {
-        checkIncomingMessages();
-        xSemaphoreGive(xSIM7600Mutex);
-      }
-    }
-    
-    // Check every 100ms
-    vTaskDelay(pdMS_TO_TICKS(100));
+    // No mutex needed - URCs come from the reader's queue, not the UART
+    checkIncomingMessages();
   }
 }
 
@@ -859,7 +786,7 @@ void vReceiveTask(void *pvParameters) {
  * @note Runs every 60 seconds, checks connection status
  */
 void vWatchdogTask(void *pvParameters) {
-  Serial.println("🐕 WatchdogTask started on Core 1");
+  Serial.printf("🐕 WatchdogTask started on core %d\n", (int)xPortGetCoreID());
   
   // Wait for initialization to complete
   while (!mqttConnected) {
@@ -878,32 +805,109 @@ void vWatchdogTask(void *pvParameters) {
     vTaskDelayUntil(&xLastWakeTime, xFrequency);
     
     if (!mqttConnected) {
-      Serial.println("🐕⚠ Watchdog: MQTT disconnected!");
+      Serial.printf("🐕⚠ Watchdog: MQTT disconnected! (connection state %s, %lu reconnects)\n",
+                    connStateName(connGetState()), (unsigned long)connReconnectCount());
       continue;
     }
     
-    // Check if we're still connected
-    if (xSemaphoreTake(xSIM7600Mutex, pdMS_TO_TICKS(5000)) == pdTRUE) {
-      // Optional: Send a ping or check command
-      // For now, just report status
-      unsigned long uptime = millis() / 1000;
-      Serial.printf("🐕✓ Watchdog: System healthy | Uptime: %lu sec | Free heap: %d bytes\n", 
-                    uptime, ESP.getFreeHeap());
-      
-      // Report task high water marks (minimum free stack)
-      if (xPublishTaskHandle != NULL) {
-        UBaseType_t stackLeft = uxTaskGetStackHighWaterMark(xPublishTaskHandle);
-        Serial.printf("   📊 PublishTask stack: %u words remaining\n", stackLeft);
-      }
-      if (xReceiveTaskHandle != NULL) {
-        UBaseType_t stackLeft = uxTaskGetStackHighWaterMark(xReceiveTaskHandle);
-        Serial.printf("   📊 ReceiveTask stack: %u words remaining\n", stackLeft);
-      }
-      
-      xSemaphoreGive(xSIM7600Mutex);
+    // Check the modem still answers - through ModemTask like every command
+    char csq[MODEM_REPLY_MAX];
+    uint32_t pingStart = millis();
+    if (modemAt("AT+CSQ", 2000, pdMS_TO_TICKS(5000), csq, sizeof(csq))) {
+      Serial.printf("🐕✓ Watchdog: Modem answered in %lu ms | %s\n",
+                    (unsigned long)(millis() - pingStart), csq);
     } else {
-      Serial.println("🐕⚠ Watchdog: Failed to acquire mutex!");
+      Serial.println("🐕⚠ Watchdog: Modem did not answer AT+CSQ!");
+    }
+    
+    unsigned long uptime = millis() / 1000;
+    Serial.printf("🐕✓ Watchdog: System healthy | Uptime: %lu sec | Free heap: %d bytes\n", 
+                  uptime, ESP.getFreeHeap());
+    
+    // Report task high water marks (minimum free stack)
+    for (uint8_t client = 0; client < MQTT_CLIENT_COUNT; client++) {
+      if (xPublishTaskHandle[client] != NULL) {
+        UBaseType_t stackLeft = uxTaskGetStackHighWaterMark(xPublishTaskHandle[client]);
+        Serial.printf("   📊 PublishTask%u stack: %u words remaining\n", (unsigned)client, stackLeft);
+      }
+    }
+    if (xReceiveTaskHandle != NULL) {
+      UBaseType_t stackLeft = uxTaskGetStackHighWaterMark(xReceiveTaskHandle);
+      Serial.printf("   📊 ReceiveTask stack: %u words remaining\n", stackLeft);
     }
+    if (xModemTaskHandle != NULL) {
+      UBaseType_t stackLeft = uxTaskGetStackHighWaterMark(xModemTaskHandle);
+      Serial.printf("   📊 ModemTask stack: %u words remaining\n", stackLeft);
+    }
+    for (uint8_t client = 0; client < MQTT_CLIENT_COUNT; client++) {
+      MqttPublishStats pub;
+      mqttPublishGetStats(client, &pub);
+      Serial.printf("   📊 Client %u %s | queue: %lu waiting | %lu in flight | %lu delivered (last #%lu)\n",
+                    (unsigned)client, mqttClientIsConnected(client) ? "up" : "down",
+                    (unsigned long)pub.queued, (unsigned long)pub.inFlight,
+                    (unsigned long)pub.delivered, (unsigned long)pub.lastDeliveredSeq);
+      Serial.printf("   📊 Client %u errors: %lu dropped | %lu failed | %lu retried | %lu topic skips\n",
+                    (unsigned)client, (unsigned long)pub.dropped, (unsigned long)pub.failed,
+                    (unsigned long)pub.retried, (unsigned long)pub.topicSkips);
+    }
+    MsgPoolStats pool;
+    msgPoolGetStats(&pool);
+    Serial.printf("   📊 Message pool: %u/%u in use | high water %u | exhausted %lu\n",
+                  pool.inUse, pool.capacity, pool.highWater, (unsigned long)pool.exhausted);
+    Serial.printf("   📊 AT lines dropped: %lu | UART overflows: %lu | Reconnects: %lu\n",
+                  (unsigned long)atDroppedLines(), (unsigned long)atRxOverflows(),
+                  (unsigned long)connReconnectCount());
+    Serial.printf("   📊 UART: %lu baud | flow control %s | %lu bytes out | %lu bytes in\n",
+                  (unsigned long)atUartBaud(), atUartFlowControl() ? "on" : "off",
+                  (unsigned long)atTxBytes(), (unsigned long)atRxBytes());
+    Serial.printf("   📊 CPU load: core 0 %u%% | core 1 %u%% (modem I/O on core %d, app on core %d)\n",
+                  (unsigned)metricsCoreLoad(0), (unsigned)metricsCoreLoad(1), CORE_MODEM_IO, CORE_APP);
+    ModemStats modem;
+    modemGetStats(&modem);
+    Serial.printf("   📊 Modem: %lu requests | %lu waiting (high water %lu) | %lu rejected\n",
+                  (unsigned long)modem.served, (unsigned long)modem.queued,
+                  (unsigned long)modem.queueHighWater, (unsigned long)modem.rejected);
+    Serial.printf("   📊 Modem wait: last %lu ms | max %lu ms | run: last %lu ms | max %lu ms\n",
+                  (unsigned long)modem.lastWaitMs, (unsigned long)modem.maxWaitMs,
+                  (unsigned long)modem.lastRunMs, (unsigned long)modem.maxRunMs);
+#if OFFLINE_STORE_ENABLED
+    StoreStats store;
+    storeGetStats(&store);
+    Serial.printf("   📊 Offline store: %lu/%lu bytes in RAM | %lu bytes pending in %lu flash segment(s)\n",
+                  (unsigned long)store.ramBytes, (unsigned long)store.ramCapacity,
+                  (unsigned long)store.pendingBytes, (unsigned long)store.segments);
+    Serial.printf("   📊 Offline store: %lu kept in RAM | %lu written to flash | %lu replayed | %lu segments lost | %lu corrupt\n",
+                  (unsigned long)store.ramAppended, (unsigned long)store.appended,
+                  (unsigned long)store.replayed, (unsigned long)store.lostSegments,
+                  (unsigned long)store.corrupt);
+#endif
+    InboxStats inbox;
+    inboxGetStats(&inbox);
+    Serial.printf("   📊 Inbox: %lu/%lu bytes | high water %lu | %lu received | %lu handled | %lu unhandled | %lu dropped\n",
+                  (unsigned long)inbox.ring.used, (unsigned long)inbox.ring.capacity,
+                  (unsigned long)inbox.ring.highWater, (unsigned long)inbox.ring.pushed,
+                  (unsigned long)inbox.delivered, (unsigned long)inbox.unhandled,
+                  (unsigned long)inbox.dropped);
+    ActuatorStats act;
+    actuatorGetStats(&act);
+    Serial.printf("   📊 Outputs: 0x%04X | %lu commands in %lu writes | %lu rejected | %lu dropped | %lu I2C errors\n",
+                  act.port, (unsigned long)act.commands, (unsigned long)act.writes,
+                  (unsigned long)act.rejected, (unsigned long)act.dropped,
+                  (unsigned long)act.writeErrors);
+    Serial.printf("   📊 Command latency: last %lu us | min %lu | avg %lu | max %lu | I2C %lu us\n",
+                  (unsigned long)act.lastLatencyUs, (unsigned long)act.minLatencyUs,
+                  (unsigned long)act.avgLatencyUs, (unsigned long)act.maxLatencyUs,
+                  (unsigned long)act.lastWriteUs);
+    PowerStats power;
+    powerGetStats(&power);
+    Serial.printf("   📊 Power: %s | asleep %lu s total | %lu DTR sleeps | %lu bursts | %lu PWRKEY pulses\n",
+                  powerModeName(power.mode), (unsigned long)(power.asleepMs / 1000),
+                  (unsigned long)power.dtrSleeps, (unsigned long)power.bursts,
+                  (unsigned long)power.pwrkeyPulses);
+    Serial.printf("   📊 Wake to READY: last %lu ms | max %lu | to publish: last %lu ms | max %lu\n",
+                  (unsigned long)power.lastReadyMs, (unsigned long)power.maxReadyMs,
+                  (unsigned long)power.lastPublishMs, (unsigned long)power.maxPublishMs);
+    
     
     lastHeartbeat = millis();
   }
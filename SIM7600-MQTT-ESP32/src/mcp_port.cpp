@@ -0,0 +1,63 @@
+#include "mcp_port.h"
+
+// MCP23017 registers, IOCON.BANK = 0 (power-on default): A/B pairs are
+// adjacent and the address pointer increments, so one transaction covers both
+#define MCP_REG_IODIRA 0x00
+#define MCP_REG_OLATA  0x14
+
+static bool writePair(McpPort* port, uint8_t reg, uint16_t value) {
+  port->wire->beginTransmission(port->addr);
+  port->wire->write(reg);
+  port->wire->write(value & 0xFF);  // Port A (pins 0-7)
+  port->wire->write(value >> 8);    // Port B (pins 8-15)
+  port->writes++;
+  return port->wire->endTransmission() == 0;
+}
+
+bool mcpPortBegin(McpPort* port, uint8_t addr, TwoWire* wire) {
+  port->wire = wire;
+  port->addr = addr;
+  port->outputs = 0;       // Power-on default: all inputs
+  port->latch = 0;
+  port->written = 0;
+  port->writes = 0;
+  if (!port->dev.begin_I2C(addr, wire)) {
+    return false;
+  }
+  wire->setClock(MCP_I2C_CLOCK_HZ);
+  return true;
+}
+
+bool mcpPortSetDirection(McpPort* port, uint16_t outputs, uint16_t initial) {
+  // Latch before IODIR, so pins come up at their initial level without a glitch
+  port->latch = initial;
+  if (!writePair(port, MCP_REG_OLATA, initial)) {
+    return false;
+  }
+  port->written = initial;
+  port->outputs = outputs;
+  return writePair(port, MCP_REG_IODIRA, (uint16_t)~outputs);  // IODIR: 1 = input
+}
+
+void mcpPortSet(McpPort* port, uint16_t mask, uint16_t value) {
+  port->latch = (port->latch & ~mask) | (value & mask);
+}
+
+void mcpPortWritePin(McpPort* port, uint8_t pin, bool high) {
+  mcpPortSet(port, 1u << pin, high ? 0xFFFF : 0);
+}
+
+bool mcpPortFlush(McpPort* port) {
+  if (port->latch == port->written) {
+    return true;
+  }
+  if (!writePair(port, MCP_REG_OLATA, port->latch)) {
+    return false;  // Still differs - the next flush retries
+  }
+  port->written = port->latch;
+  return true;
+}
+
+uint16_t mcpPortLatch(const McpPort* port) {
+  return port->latch;
+}
@@ -0,0 +1,334 @@
+#include "metrics.h"
+#include <esp_freertos_hooks.h>
+#include <esp_timer.h>
+#include "at_engine.h"
+#include "conn_manager.h"
+#include "mqtt_inbox.h"
+#include "mqtt_publish.h"
+#include "msg_pool.h"
+
+struct AtMetric {
+  char name[METRICS_AT_NAME_MAX + 1];
+  MetricsHist hist;
+};
+
+/**
+ * @brief Everything recorded during one interval
+ */
+struct MetricsInterval {
+  AtMetric at[METRICS_AT_COMMANDS];
+  uint8_t atCount;
+  MetricsHist publish[MQTT_CLIENT_COUNT];
+  MetricsHist modemWait;
+  uint32_t modemRejects;
+  uint32_t maxQueued[MQTT_CLIENT_COUNT];
+  uint32_t startedAt;             // millis()
+};
+
+// ===== Global Variables =====
+static const uint32_t bounds[METRICS_BUCKETS - 1] = METRICS_BUCKET_BOUNDS;
+static portMUX_TYPE metricsLock = portMUX_INITIALIZER_UNLOCKED;
+static MetricsInterval current = {};
+
+// Per-core idle time (us), each written only by that core's idle hook
+static volatile uint64_t idleUs[portNUM_PROCESSORS] = {};
+static bool idleHooked = false;
+// Idle time and clock at the start of the current interval
+static uint64_t idleMark[portNUM_PROCESSORS] = {};
+static int64_t markUs = 0;
+
+// ===== Histograms =====
+
+void metricsHistAdd(MetricsHist* hist, uint32_t ms) {
+  uint8_t b = 0;
+  while (b < METRICS_BUCKETS - 1 && ms > bounds[b]) {
+    b++;
+  }
+  hist->bucket[b]++;
+  hist->count++;
+  hist->sumMs += ms;
+  if (ms > hist->maxMs) {
+    hist->maxMs = ms;
+  }
+}
+
+uint32_t metricsHistPercentile(const MetricsHist* hist, uint8_t pct) {
+  if (hist->count == 0) {
+    return 0;
+  }
+  // Rank of the sample at pct, rounded up: p99 of 10 samples is the 10th
+  uint32_t rank = (hist->count * pct + 99) / 100;
+  uint32_t seen = 0;
+  for (uint8_t b = 0; b < METRICS_BUCKETS - 1; b++) {
+    seen += hist->bucket[b];
+    if (seen >= rank) {
+      return min(bounds[b], hist->maxMs);
+    }
+  }
+  return hist->maxMs;
+}
+
+static uint32_t histAvg(const MetricsHist* hist) {
+  return hist->count > 0 ? hist->sumMs / hist->count : 0;
+}
+
+// ===== Recording =====
+
+void metricsRecordAt(const char* command, uint32_t ms) {
+  // "AT+CMQTTPUB=0,1,60" -> "CMQTTPUB", "AT" -> "AT"
+  const char* name = strncmp(command, "AT+", 3) == 0 ? command + 3 : command;
+  size_t len = strcspn(name, "=?");
+  if (len > METRICS_AT_NAME_MAX) {
+    len = METRICS_AT_NAME_MAX;
+  }
+
+  portENTER_CRITICAL_SAFE(&metricsLock);
+  AtMetric* slot = NULL;
+  for (uint8_t i = 0; i < current.atCount && slot == NULL; i++) {
+    if (strncmp(current.at[i].name, name, len) == 0 && current.at[i].name[len] == '\0') {
+      slot = &current.at[i];
+    }
+  }
+  if (slot == NULL && current.atCount < METRICS_AT_COMMANDS) {
+    slot = &current.at[current.atCount++];
+    memcpy(slot->name, name, len);
+    slot->name[len] = '\0';
+  }
+  if (slot != NULL) {
+    metricsHistAdd(&slot->hist, ms);
+  }
+  portEXIT_CRITICAL_SAFE(&metricsLock);
+}
+
+void metricsRecordPublish(uint8_t client, uint32_t ms) {
+  if (client >= MQTT_CLIENT_COUNT) {
+    return;
+  }
+  portENTER_CRITICAL_SAFE(&metricsLock);
+  metricsHistAdd(&current.publish[client], ms);
+  portEXIT_CRITICAL_SAFE(&metricsLock);
+}
+
+void metricsRecordQueueDepth(uint8_t client, uint32_t depth) {
+  if (client >= MQTT_CLIENT_COUNT) {
+    return;
+  }
+  portENTER_CRITICAL_SAFE(&metricsLock);
+  if (depth > current.maxQueued[client]) {
+    current.maxQueued[client] = depth;
+  }
+  portEXIT_CRITICAL_SAFE(&metricsLock);
+}
+
+void metricsRecordModemWait(uint32_t ms, bool served) {
+  portENTER_CRITICAL_SAFE(&metricsLock);
+  if (served) {
+    metricsHistAdd(&current.modemWait, ms);
+  } else {
+    current.modemRejects++;
+  }
+  portEXIT_CRITICAL_SAFE(&metricsLock);
+}
+
+// ===== Core Load =====
+
+/**
+ * @brief Idle hook: sleep until the next interrupt and count the time
+ * @note Does the wait itself (returns false so the idle task doesn't wait
+ *       again), so the time a core spends asleep is measured exactly
+ */
+static bool idleHook() {
+#if defined(__XTENSA__)
+  int64_t start = esp_timer_get_time();
+  asm volatile("waiti 0");
+  idleUs[xPortGetCoreID()] += (uint64_t)(esp_timer_get_time() - start);
+  return false;
+#else
+  return true;  // No WFI helper here - load stays unknown
+#endif
+}
+
+// 64-bit counter written by the other core - read until two reads agree
+static uint64_t readIdle(uint8_t core) {
+  uint64_t a, b;
+  do {
+    a = idleUs[core];
+    b = idleUs[core];
+  } while (a != b);
+  return a;
+}
+
+static void markInterval() {
+  portENTER_CRITICAL_SAFE(&metricsLock);
+  markUs = esp_timer_get_time();
+  for (uint8_t c = 0; c < portNUM_PROCESSORS; c++) {
+    idleMark[c] = readIdle(c);
+  }
+  portEXIT_CRITICAL_SAFE(&metricsLock);
+}
+
+bool metricsInit() {
+  bool ok = true;
+  for (uint8_t c = 0; c < portNUM_PROCESSORS; c++) {
+    ok = esp_register_freertos_idle_hook_for_cpu(idleHook, c) == ESP_OK && ok;
+  }
+  idleHooked = ok;
+  markInterval();
+  return ok;
+}
+
+uint8_t metricsCoreLoad(uint8_t core) {
+  if (!idleHooked || core >= portNUM_PROCESSORS) {
+    return METRICS_LOAD_UNKNOWN;
+  }
+  portENTER_CRITICAL_SAFE(&metricsLock);
+  int64_t elapsed = esp_timer_get_time() - markUs;
+  uint64_t idle = readIdle(core) - idleMark[core];
+  portEXIT_CRITICAL_SAFE(&metricsLock);
+  if (elapsed <= 0) {
+    return METRICS_LOAD_UNKNOWN;
+  }
+  if (idle >= (uint64_t)elapsed) {
+    return 0;
+  }
+  return (uint8_t)(100 - idle * 100 / (uint64_t)elapsed);
+}
+
+// ===== Reporting =====
+
+/**
+ * @brief snprintf that keeps appending at *len and stops advancing on overflow
+ */
+static void append(char* buf, size_t cap, size_t* len, const char* fmt, ...) {
+  if (*len >= cap) {
+    return;
+  }
+  va_list args;
+  va_start(args, fmt);
+  int n = vsnprintf(buf + *len, cap - *len, fmt, args);
+  va_end(args);
+  *len = n < 0 ? cap : *len + (size_t)n;
+}
+
+static void appendBuckets(char* buf, size_t cap, size_t* len, const MetricsHist* hist) {
+  append(buf, cap, len, "[");
+  for (uint8_t b = 0; b < METRICS_BUCKETS; b++) {
+    append(buf, cap, len, b == 0 ? "%lu" : ",%lu", (unsigned long)hist->bucket[b]);
+  }
+  append(buf, cap, len, "]");
+}
+
+size_t metricsFormat(char* buf, size_t cap) {
+  // Take the interval and start the next one - format outside the lock
+  static MetricsInterval snap;
+  uint8_t load[portNUM_PROCESSORS];
+  for (uint8_t c = 0; c < portNUM_PROCESSORS; c++) {
+    load[c] = metricsCoreLoad(c);
+  }
+  markInterval();
+  uint32_t now = millis();
+  portENTER_CRITICAL_SAFE(&metricsLock);
+  snap = current;
+  memset(&current, 0, sizeof(current));
+  current.startedAt = now;
+  portEXIT_CRITICAL_SAFE(&metricsLock);
+
+  MsgPoolStats pool;
+  msgPoolGetStats(&pool);
+  InboxStats inbox;
+  inboxGetStats(&inbox);
+
+  size_t len = 0;
+  append(buf, cap, &len, "{\"up\":%lu,\"s\":%lu,\"rc\":%lu,\"tx\":%lu,\"rx\":%lu,\"at\":{",
+         (unsigned long)(now / 1000), (unsigned long)((now - snap.startedAt) / 1000),
+         (unsigned long)connReconnectCount(), (unsigned long)atTxBytes(),
+         (unsigned long)atRxBytes());
+  for (uint8_t i = 0; i < snap.atCount; i++) {
+    const MetricsHist* h = &snap.at[i].hist;
+    append(buf, cap, &len, "%s\"%s\":[%lu,%lu,%lu,%lu]", i == 0 ? "" : ",", snap.at[i].name,
+           (unsigned long)h->count, (unsigned long)histAvg(h),
+           (unsigned long)metricsHistPercentile(h, 99), (unsigned long)h->maxMs);
+  }
+  append(buf, cap, &len, "},\"pub\":[");
+  for (uint8_t c = 0; c < MQTT_CLIENT_COUNT; c++) {
+    const MetricsHist* h = &snap.publish[c];
+    append(buf, cap, &len, "%s[%lu,%lu,%lu,%lu,%lu,", c == 0 ? "" : ",",
+           (unsigned long)h->count, (unsigned long)histAvg(h),
+           (unsigned long)metricsHistPercentile(h, 50), (unsigned long)metricsHistPercentile(h, 99),
+           (unsigned long)h->maxMs);
+    appendBuckets(buf, cap, &len, h);
+    append(buf, cap, &len, "]");
+  }
+  const MetricsHist* m = &snap.modemWait;
+  append(buf, cap, &len, "],\"mtx\":[%lu,%lu,%lu,%lu,%lu,",
+         (unsigned long)m->count, (unsigned long)histAvg(m),
+         (unsigned long)metricsHistPercentile(m, 99), (unsigned long)m->maxMs,
+         (unsigned long)snap.modemRejects);
+  appendBuckets(buf, cap, &len, m);
+  append(buf, cap, &len, "],\"q\":[");
+  for (uint8_t c = 0; c < MQTT_CLIENT_COUNT; c++) {
+    append(buf, cap, &len, c == 0 ? "%lu" : ",%lu", (unsigned long)snap.maxQueued[c]);
+  }
+  append(buf, cap, &len, "],\"pool\":[%u,%u],\"in\":[%lu,%lu],\"cpu\":[",
+         (unsigned)pool.inUse, (unsigned)pool.highWater,
+         (unsigned long)inbox.dropped, (unsigned long)inbox.unhandled);
+  for (uint8_t c = 0; c < portNUM_PROCESSORS; c++) {
+    // -1: load unknown (no idle hook)
+    append(buf, cap, &len, c == 0 ? "%d" : ",%d",
+           load[c] == METRICS_LOAD_UNKNOWN ? -1 : (int)load[c]);
+  }
+  append(buf, cap, &len, "]}");
+
+  return len < cap ? len : 0;
+}
+
+bool metricsPublish(const char* topic) {
+  size_t topicLen = strlen(topic);
+  if (topicLen > MSG_TOPIC_MAX) {
+    return false;
+  }
+  PublishMsg* msg = msgPoolAcquire();
+  if (msg == NULL) {
+    return false;
+  }
+  size_t len = metricsFormat(msg->payload, MSG_PAYLOAD_MAX);
+  if (len == 0) {
+    Serial.println("⚠ Metrics document larger than MSG_PAYLOAD_MAX - not published");
+    msgPoolRelease(msg);
+    return false;
+  }
+  memcpy(msg->topic, topic, topicLen + 1);
+  msg->payloadLen = (uint16_t)len;
+  msg->qos = 0;
+  msg->client = MQTT_CLIENT_TELEMETRY;
+  return mqttPublishSubmit(msg);
+}
+
+// ===== FreeRTOS Task =====
+
+/**
+ * @brief Metrics Task - Publishes the metrics document every interval
+ * @note Skips intervals while the telemetry client is down, so the next
+ *       document covers the outage too
+ */
+void vMetricsTask(void *pvParameters) {
+  const char* topic = (const char*)pvParameters;
+  Serial.printf("📊 MetricsTask started - %s every %lu s\n", topic,
+                (unsigned long)(METRICS_INTERVAL_MS / 1000));
+
+  portENTER_CRITICAL_SAFE(&metricsLock);
+  current.startedAt = millis();
+  portEXIT_CRITICAL_SAFE(&metricsLock);
+  markInterval();
+
+  TickType_t xLastWakeTime = xTaskGetTickCount();
+  while (1) {
+    vTaskDelayUntil(&xLastWakeTime, pdMS_TO_TICKS(METRICS_INTERVAL_MS));
+    if (!mqttClientIsConnected(MQTT_CLIENT_TELEMETRY)) {
+      continue;
+    }
+    if (!metricsPublish(topic)) {
+      Serial.println("⚠ Metrics not queued");
+    }
+  }
+}
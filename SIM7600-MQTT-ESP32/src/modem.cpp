@@ -0,0 +1,177 @@
+#include "modem.h"
+#include "metrics.h"
+#include "modem_power.h"
+
+// ===== Global Variables =====
+TaskHandle_t xModemTaskHandle = NULL;
+
+static QueueHandle_t xModemQueue = NULL;  // ModemRequest* - callers own the requests
+static ModemStats stats;
+static portMUX_TYPE modemLock = portMUX_INITIALIZER_UNLOCKED;
+
+// ===== Serving =====
+
+/**
+ * @brief Copy the first information line of the last answer into reply
+ * @note Skips the command echo, blank lines and the final result
+ */
+static void copyInfoLine(const char* command, const char* text, char* reply, size_t cap) {
+  reply[0] = '\0';
+  size_t commandLen = strlen(command);
+  while (*text != '\0') {
+    const char* end = strstr(text, "\r\n");
+    size_t len = end != NULL ? (size_t)(end - text) : strlen(text);
+    bool echo = len == commandLen && strncmp(text, command, len) == 0;
+    char line[MODEM_REPLY_MAX];
+    size_t n = len < sizeof(line) - 1 ? len : sizeof(line) - 1;
+    memcpy(line, text, n);
+    line[n] = '\0';
+    if (len > 0 && !echo && !atIsFinalResult(line)) {
+      snprintf(reply, cap, "%s", line);
+      return;
+    }
+    if (end == NULL) {
+      return;
+    }
+    text = end + 2;
+  }
+}
+
+static void runAt(ModemRequest* req) {
+  const AtResponse& r = sendATCommand(req->command, req->timeout);
+  // The final line decides - "OK" inside an information line does not count
+  req->result = (r.contains("\r\nOK\r\n") || r.startsWith("OK\r\n")) ? 1 : 0;
+  copyInfoLine(req->command, r.c_str(), req->reply, sizeof(req->reply));
+}
+
+static void execute(ModemRequest* req) {
+  if (req->type == MODEM_REQ_AT) {
+    runAt(req);
+  } else {
+    req->result = req->job(req->arg);
+  }
+}
+
+static void serve(ModemRequest* req) {
+  powerModemWake();  // DTR sleep (modem_power.h) - the wake counts as waiting
+  uint32_t start = millis();
+  uint32_t waited = start - req->queuedAt;
+  metricsRecordModemWait(waited, true);
+
+  execute(req);
+
+  uint32_t ran = millis() - start;
+  portENTER_CRITICAL_SAFE(&modemLock);
+  stats.served++;
+  stats.lastWaitMs = waited;
+  stats.lastRunMs = ran;
+  if (waited > stats.maxWaitMs) {
+    stats.maxWaitMs = waited;
+  }
+  if (ran > stats.maxRunMs) {
+    stats.maxRunMs = ran;
+  }
+  portEXIT_CRITICAL_SAFE(&modemLock);
+}
+
+/**
+ * @brief Queue the request and sleep until ModemTask has answered it
+ * @return false if the queue stayed full for wait
+ */
+static bool submit(ModemRequest* req, TickType_t wait, bool urgent) {
+  if (modemIsOwner()) {
+    execute(req);  // Nested request from inside a job - the channel is ours already
+    return true;
+  }
+  if (xModemQueue == NULL) {
+    return false;
+  }
+
+  req->caller = xTaskGetCurrentTaskHandle();
+  req->queuedAt = millis();
+  BaseType_t sent = urgent ? xQueueSendToFront(xModemQueue, &req, wait)
+                           : xQueueSendToBack(xModemQueue, &req, wait);
+  if (sent != pdTRUE) {
+    metricsRecordModemWait(millis() - req->queuedAt, false);
+    portENTER_CRITICAL_SAFE(&modemLock);
+    stats.rejected++;
+    portEXIT_CRITICAL_SAFE(&modemLock);
+    return false;
+  }
+
+  UBaseType_t depth = uxQueueMessagesWaiting(xModemQueue);
+  portENTER_CRITICAL_SAFE(&modemLock);
+  if (depth > stats.queueHighWater) {
+    stats.queueHighWater = depth;
+  }
+  portEXIT_CRITICAL_SAFE(&modemLock);
+
+  // Accepted: the reply will come, and it must find us still waiting.
+  // Other notifications (counting ones) are left in the value.
+  uint32_t bits = 0;
+  do {
+    xTaskNotifyWait(0, MODEM_NOTIFY_DONE, &bits, portMAX_DELAY);
+  } while ((bits & MODEM_NOTIFY_DONE) == 0);
+  return true;
+}
+
+// ===== Lifecycle =====
+
+bool modemInit() {
+  xModemQueue = xQueueCreate(MODEM_QUEUE_LEN, sizeof(ModemRequest*));
+  return xModemQueue != NULL;
+}
+
+/**
+ * @brief Modem Task - Serves requests one at a time, never exits
+ * @note Sleeps on the command queue while nothing is requested; after
+ *       powerIdleWait() without a request the modem is put to DTR sleep
+ */
+void vModemTask(void *pvParameters) {
+  Serial.println("📨 ModemTask started");
+
+  while (1) {
+    ModemRequest* req = NULL;
+    if (xQueueReceive(xModemQueue, &req, powerIdleWait()) != pdTRUE) {
+      powerModemIdle();
+      continue;
+    }
+    serve(req);
+    xTaskNotify(req->caller, MODEM_NOTIFY_DONE, eSetBits);
+  }
+}
+
+// ===== Requests =====
+
+int modemCall(ModemJob job, void* arg, TickType_t wait, bool urgent, int failResult) {
+  ModemRequest req = {};
+  req.type = MODEM_REQ_CALL;
+  req.job = job;
+  req.arg = arg;
+  return submit(&req, wait, urgent) ? req.result : failResult;
+}
+
+bool modemAt(const char* command, unsigned long timeout, TickType_t wait,
+             char* reply, size_t replyCap) {
+  ModemRequest req = {};
+  req.type = MODEM_REQ_AT;
+  req.command = command;
+  req.timeout = timeout;
+  bool ok = submit(&req, wait, false) && req.result == 1;
+  if (reply != NULL && replyCap > 0) {
+    snprintf(reply, replyCap, "%s", req.reply);
+  }
+  return ok;
+}
+
+bool modemIsOwner() {
+  return xModemTaskHandle != NULL && xTaskGetCurrentTaskHandle() == xModemTaskHandle;
+}
+
+void modemGetStats(ModemStats* out) {
+  UBaseType_t depth = xModemQueue != NULL ? uxQueueMessagesWaiting(xModemQueue) : 0;
+  portENTER_CRITICAL_SAFE(&modemLock);
+  *out = stats;
+  portEXIT_CRITICAL_SAFE(&modemLock);
+  out->queued = depth;
+}
@@ -0,0 +1,319 @@
+#include "modem_power.h"
+#include "actuator.h"
+#include "at_engine.h"
+#include "conn_manager.h"
+#include "modem.h"
+#include "mqtt_client.h"
+#include "mqtt_publish.h"
+#include "offline_store.h"
+
+// Where the modem is between requests
+enum PowerState : uint8_t {
+  POWER_AWAKE,
+  POWER_DTR_ASLEEP,   // DTR high, ModemTask wakes it on the next request
+  POWER_DOWN,         // PSM / off - only PowerTask wakes it
+};
+
+// ===== Global Variables =====
+TaskHandle_t xPowerTaskHandle = NULL;
+
+static const PowerConfig* config = NULL;
+static volatile PowerState powerState = POWER_AWAKE;
+static bool csclkEnabled = false;     // AT+CSCLK=1 accepted - DTR high lets the modem sleep
+static uint32_t sleptAt = 0;          // millis() when the current sleep began
+static uint32_t wokeAt = 0;           // millis() of the last wake
+static bool awaitingPublish = false;  // No delivery since the last wake yet
+static PowerStats stats = {};
+static portMUX_TYPE powerLock = portMUX_INITIALIZER_UNLOCKED;
+
+static const char* const MODE_NAMES[] = { "ALWAYS_ON", "DTR_SLEEP", "PSM", "OFF" };
+
+// ===== Helpers =====
+
+static bool dtrSleepEnabled() {
+  return config != NULL && config->mode != POWER_ALWAYS_ON && config->dtrPin >= 0 && csclkEnabled;
+}
+
+static void setDtr(bool high) {
+  if (config != NULL && config->dtrPin >= 0) {
+    digitalWrite(config->dtrPin, high ? HIGH : LOW);
+  }
+}
+
+static void beginSleep(PowerState next) {
+  portENTER_CRITICAL_SAFE(&powerLock);
+  powerState = next;
+  sleptAt = millis();
+  if (next == POWER_DTR_ASLEEP) {
+    stats.dtrSleeps++;
+  }
+  portEXIT_CRITICAL_SAFE(&powerLock);
+}
+
+static void endSleep() {
+  uint32_t now = millis();
+  portENTER_CRITICAL_SAFE(&powerLock);
+  if (powerState != POWER_AWAKE) {
+    stats.asleepMs += now - sleptAt;
+    powerState = POWER_AWAKE;
+  }
+  wokeAt = now;
+  awaitingPublish = true;
+  portEXIT_CRITICAL_SAFE(&powerLock);
+}
+
+// ===== API =====
+
+bool powerInit(const PowerConfig* cfg) {
+  if (cfg == NULL) {
+    return false;
+  }
+  config = cfg;
+  stats.mode = cfg->mode;
+  if (cfg->dtrPin >= 0) {
+    pinMode(cfg->dtrPin, OUTPUT);
+    digitalWrite(cfg->dtrPin, LOW);  // Awake
+  } else if (cfg->mode == POWER_DTR_SLEEP) {
+    Serial.println("⚠ DTR not wired - POWER_DTR_SLEEP keeps the modem awake");
+  }
+  endSleep();  // Boot counts as a wake
+  Serial.printf("🔋 Power mode: %s\n", powerModeName(cfg->mode));
+  return true;
+}
+
+bool powerBurstMode() {
+  return config != NULL && (config->mode == POWER_PSM || config->mode == POWER_OFF);
+}
+
+const char* powerModeName(PowerMode mode) {
+  return mode < sizeof(MODE_NAMES) / sizeof(MODE_NAMES[0]) ? MODE_NAMES[mode] : "?";
+}
+
+void powerGetStats(PowerStats* out) {
+  uint32_t now = millis();
+  portENTER_CRITICAL_SAFE(&powerLock);
+  *out = stats;
+  out->asleep = powerState != POWER_AWAKE;
+  if (out->asleep) {
+    out->asleepMs += now - sleptAt;
+  }
+  portEXIT_CRITICAL_SAFE(&powerLock);
+}
+
+void powerConfigureModem() {
+  if (config == NULL) {
+    return;
+  }
+
+  // Sleep mode 1: the modem sleeps while DTR is high and it has nothing to do
+  bool wantDtr = config->mode != POWER_ALWAYS_ON && config->dtrPin >= 0;
+  bool ok = sendATCommand(wantDtr ? "AT+CSCLK=1" : "AT+CSCLK=0").contains("OK");
+  csclkEnabled = wantDtr && ok;
+  if (wantDtr && !ok) {
+    Serial.println("⚠ AT+CSCLK not accepted - no DTR sleep");
+  }
+
+  char cmd[64];
+  if (config->mode != POWER_ALWAYS_ON && config->edrx != NULL) {
+    // 4 = E-UTRAN; the network may grant a different cycle (AT+CEDRXRDP)
+    snprintf(cmd, sizeof(cmd), "AT+CEDRXS=1,4,\"%s\"", config->edrx);
+    if (!sendATCommand(cmd).contains("OK")) {
+      Serial.println("⚠ eDRX not accepted - default paging cycle");
+    }
+  }
+  if (config->mode == POWER_PSM && config->psmTau != NULL && config->psmActive != NULL) {
+    snprintf(cmd, sizeof(cmd), "AT+CPSMS=1,,,\"%s\",\"%s\"", config->psmTau, config->psmActive);
+    if (!sendATCommand(cmd).contains("OK")) {
+      Serial.println("⚠ PSM not accepted - modem stays registered between bursts");
+    }
+  }
+}
+
+// ===== ModemTask Hooks =====
+
+TickType_t powerIdleWait() {
+  return dtrSleepEnabled() && powerState == POWER_AWAKE ? pdMS_TO_TICKS(config->idleMs)
+                                                        : portMAX_DELAY;
+}
+
+void powerModemIdle() {
+  if (!dtrSleepEnabled() || powerState != POWER_AWAKE) {
+    return;
+  }
+  setDtr(true);
+  beginSleep(POWER_DTR_ASLEEP);
+}
+
+void powerModemWake() {
+  if (powerState != POWER_DTR_ASLEEP) {
+    return;  // Awake already - or down, where only PowerTask may wake it
+  }
+  setDtr(false);
+  vTaskDelay(pdMS_TO_TICKS(POWER_DTR_WAKE_MS));
+  endSleep();
+}
+
+void powerNoteDelivered() {
+  uint32_t now = millis();
+  portENTER_CRITICAL_SAFE(&powerLock);
+  if (awaitingPublish) {
+    awaitingPublish = false;
+    stats.lastPublishMs = now - wokeAt;
+    if (stats.lastPublishMs > stats.maxPublishMs) {
+      stats.maxPublishMs = stats.lastPublishMs;
+    }
+  }
+  portEXIT_CRITICAL_SAFE(&powerLock);
+}
+
+// ===== Bursts =====
+
+// Nothing queued, nothing waiting for a result, nothing parked for replay
+static bool drained() {
+  for (uint8_t client = 0; client < MQTT_CLIENT_COUNT; client++) {
+    MqttPublishStats s;
+    mqttPublishGetStats(client, &s);
+    if (s.queued > 0 || s.inFlight > 0) {
+      return false;
+    }
+  }
+#if OFFLINE_STORE_ENABLED
+  StoreStats st;
+  storeGetStats(&st);
+  if (st.ramBytes > 0 || st.pendingBytes > 0) {
+    return false;
+  }
+#endif
+  return true;
+}
+
+/**
+ * @brief Stay up until MQTT is READY and the backlog is out, plus POWER_LINGER_MS
+ */
+static void runAwakeWindow(uint32_t wakeStart) {
+  while (connGetState() != CONN_READY) {
+    if (millis() - wakeStart >= POWER_CONNECT_TIMEOUT_MS) {
+      Serial.printf("⚠ Burst: MQTT not ready after %lu s - back to sleep\n",
+                    (unsigned long)(POWER_CONNECT_TIMEOUT_MS / 1000));
+      return;
+    }
+    vTaskDelay(pdMS_TO_TICKS(POWER_POLL_MS));
+  }
+
+  uint32_t readyMs = millis() - wakeStart;
+  portENTER_CRITICAL_SAFE(&powerLock);
+  stats.lastReadyMs = readyMs;
+  if (readyMs > stats.maxReadyMs) {
+    stats.maxReadyMs = readyMs;
+  }
+  portEXIT_CRITICAL_SAFE(&powerLock);
+  Serial.printf("🔋 Burst: MQTT ready %lu ms after wake\n", (unsigned long)readyMs);
+
+  uint32_t quietSince = millis();
+  while (millis() - wakeStart < POWER_AWAKE_MAX_MS) {
+    if (!drained() || connGetState() != CONN_READY) {
+      quietSince = millis();
+    } else if (millis() - quietSince >= POWER_LINGER_MS) {
+      return;
+    }
+    vTaskDelay(pdMS_TO_TICKS(POWER_POLL_MS));
+  }
+  Serial.println("⚠ Burst: backlog not drained - the rest goes in the next burst");
+}
+
+// ModemJob - close the MQTT side cleanly, then PSM or off
+static int shutdownJob(void* arg) {
+  for (uint8_t client = 0; client < MQTT_CLIENT_COUNT; client++) {
+    if (mqttClientConfig(client) != NULL) {
+      mqttClientDisconnect(client);
+      mqttClientRelease(client);
+    }
+  }
+  sendATCommand("AT+CMQTTSTOP", 5000);
+  if (config->mode == POWER_OFF) {
+    sendATCommand("AT+CPOF", 5000);
+  }
+  setDtr(true);  // Lets the modem sleep / enter PSM with the UART released
+  beginSleep(POWER_DOWN);
+  return 0;
+}
+
+static bool shutDown() {
+  connSuspend();
+  uint32_t start = millis();
+  while (connGetState() != CONN_OFF && millis() - start < POWER_SUSPEND_WAIT_MS) {
+    vTaskDelay(pdMS_TO_TICKS(POWER_POLL_MS));
+  }
+  return modemCall(shutdownJob, NULL, pdMS_TO_TICKS(POWER_SUSPEND_WAIT_MS), false, -1) == 0;
+}
+
+// Same edge sequence as powerOnModule(), one port write per edge
+static void pulsePwrkey() {
+  uint16_t bit = 1u << config->pwrkeyPin;
+  Serial.println("🔋 PWRKEY pulse");
+  actuatorDrive(bit, bit);
+  vTaskDelay(pdMS_TO_TICKS(300));
+  actuatorDrive(bit, 0);
+  vTaskDelay(pdMS_TO_TICKS(POWER_PWRKEY_PULSE_MS));
+  actuatorDrive(bit, bit);
+  portENTER_CRITICAL_SAFE(&powerLock);
+  stats.pwrkeyPulses++;
+  portEXIT_CRITICAL_SAFE(&powerLock);
+}
+
+static void wakeModem() {
+  endSleep();
+  setDtr(false);
+  vTaskDelay(pdMS_TO_TICKS(POWER_DTR_WAKE_MS));
+
+  // Out of PSM DTR or any UART traffic may be enough; an AT+CPOF needs PWRKEY
+  bool answered = false;
+  if (config->mode == POWER_PSM) {
+    for (uint8_t i = 0; i < POWER_WAKE_PROBES && !answered; i++) {
+      answered = modemAt("AT", 500, pdMS_TO_TICKS(1000));
+    }
+  }
+  if (!answered) {
+    pulsePwrkey();
+    vTaskDelay(pdMS_TO_TICKS(POWER_BOOT_MS));
+  }
+  connResume();
+}
+
+// ===== FreeRTOS Task =====
+
+/**
+ * @brief Power Task - Runs the wake / drain / sleep cycle, never exits
+ * @note Only created for POWER_PSM and POWER_OFF. Boot is the first burst.
+ */
+void vPowerTask(void *pvParameters) {
+  Serial.printf("🔋 PowerTask started - %s, one burst every %lu s\n",
+                powerModeName(config->mode), (unsigned long)(config->burstIntervalMs / 1000));
+
+  uint32_t wakeStart = millis();
+  while (1) {
+    runAwakeWindow(wakeStart);
+
+    if (!shutDown()) {
+      Serial.println("⚠ Modem queue full - staying awake for another burst");
+      connResume();
+      wakeStart = millis();
+      continue;
+    }
+
+    portENTER_CRITICAL_SAFE(&powerLock);
+    stats.bursts++;
+    portEXIT_CRITICAL_SAFE(&powerLock);
+
+    uint32_t awake = millis() - wakeStart;
+    uint32_t sleepMs = config->burstIntervalMs > awake + POWER_MIN_SLEEP_MS
+                       ? config->burstIntervalMs - awake : POWER_MIN_SLEEP_MS;
+    Serial.printf("🔋 Modem %s after %lu s awake - next burst in %lu s\n",
+                  config->mode == POWER_PSM ? "in PSM" : "off",
+                  (unsigned long)(awake / 1000), (unsigned long)(sleepMs / 1000));
+    vTaskDelay(pdMS_TO_TICKS(sleepMs));
+
+    wakeStart = millis();
+    wakeModem();
+  }
+}
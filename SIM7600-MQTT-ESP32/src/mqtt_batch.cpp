@@ -0,0 +1,92 @@
+#include "mqtt_batch.h"
+#include "mqtt_publish.h"
+
+void batchInit(MqttBatch* batch, const char* topic, uint16_t maxSamples,
+               uint32_t maxAgeMs, char separator, uint8_t qos) {
+  memset(batch, 0, sizeof(*batch));
+  batch->topic = topic;
+  batch->qos = qos;
+  batch->client = MQTT_CLIENT_TELEMETRY;
+  batch->maxSamples = maxSamples > 0 ? maxSamples : 1;
+  batch->maxAgeMs = maxAgeMs;
+  batch->separator = separator;
+}
+
+size_t batchRemaining(const MqttBatch* batch) {
+  if (batch->msg == NULL) {
+    return MSG_PAYLOAD_MAX;
+  }
+  size_t used = batch->msg->payloadLen + (batch->separator != 0 ? 1 : 0);
+  return used < MSG_PAYLOAD_MAX ? MSG_PAYLOAD_MAX - used : 0;
+}
+
+bool batchFlush(MqttBatch* batch) {
+  if (batch->msg == NULL) {
+    return true;
+  }
+
+  PublishMsg* msg = batch->msg;
+  uint16_t count = batch->count;
+  batch->msg = NULL;
+  batch->count = 0;
+
+  // mqttPublishSubmit() owns the buffer from here on, even on failure
+  if (!mqttPublishSubmit(msg)) {
+    batch->rejected += count;
+    return false;
+  }
+  batch->flushed++;
+  return true;
+}
+
+bool batchAdd(MqttBatch* batch, const void* sample, size_t len) {
+  if (len == 0 || len > MSG_PAYLOAD_MAX) {
+    batch->rejected++;
+    return false;
+  }
+
+  // Doesn't fit behind what we already have - send that first
+  if (batch->msg != NULL && len > batchRemaining(batch)) {
+    batchFlush(batch);
+  }
+
+  if (batch->msg == NULL) {
+    PublishMsg* msg = msgPoolAcquire();
+    if (msg == NULL) {
+      batch->rejected++;
+      return false;
+    }
+    strncpy(msg->topic, batch->topic, MSG_TOPIC_MAX);
+    msg->topic[MSG_TOPIC_MAX] = '\0';
+    msg->payloadLen = 0;
+    msg->qos = batch->qos;
+    msg->client = batch->client;
+    batch->msg = msg;
+    batch->openedAt = millis();
+  }
+
+  PublishMsg* msg = batch->msg;
+  if (batch->count > 0 && batch->separator != 0) {
+    msg->payload[msg->payloadLen++] = batch->separator;
+  }
+  memcpy(msg->payload + msg->payloadLen, sample, len);
+  msg->payloadLen += len;
+  batch->count++;
+
+  if (batch->count >= batch->maxSamples) {
+    return batchFlush(batch);
+  }
+  return true;
+}
+
+bool batchAdd(MqttBatch* batch, const char* sample) {
+  return batchAdd(batch, sample, strlen(sample));
+}
+
+bool batchPoll(MqttBatch* batch) {
+  if (batch->msg != NULL && batch->maxAgeMs > 0 &&
+      millis() - batch->openedAt >= batch->maxAgeMs) {
+    return batchFlush(batch);
+  }
+  return true;
+}
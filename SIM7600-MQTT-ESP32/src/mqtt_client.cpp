@@ -0,0 +1,214 @@
+#include "mqtt_client.h"
+#include "mqtt_publish.h"
+#include "mqtt_tls.h"
+
+// ===== Global Variables =====
+static const MqttBrokerConfig* clientConfig[MQTT_CLIENT_COUNT] = {};
+static volatile bool clientConnected[MQTT_CLIENT_COUNT] = {};
+
+// ===== Configuration =====
+
+void mqttClientConfigure(uint8_t client, const MqttBrokerConfig* config) {
+  if (client < MQTT_CLIENT_COUNT) {
+    clientConfig[client] = config;
+  }
+}
+
+const MqttBrokerConfig* mqttClientConfig(uint8_t client) {
+  return client < MQTT_CLIENT_COUNT ? clientConfig[client] : NULL;
+}
+
+bool mqttClientIsConnected(uint8_t client) {
+  return client < MQTT_CLIENT_COUNT && clientConnected[client];
+}
+
+void mqttClientSetConnected(uint8_t client, bool connected) {
+  if (client < MQTT_CLIENT_COUNT) {
+    clientConnected[client] = connected;
+  }
+}
+
+int mqttClientIndexOf(const char* line) {
+  const char* p = strchr(line, ':');
+  if (p == NULL) {
+    return -1;
+  }
+  p++;
+  while (*p == ' ') {
+    p++;
+  }
+  if (*p < '0' || *p > '9') {
+    return -1;
+  }
+  return atoi(p);
+}
+
+// ===== Client Slot =====
+
+bool mqttClientAcquire(uint8_t client) {
+  const MqttBrokerConfig* config = mqttClientConfig(client);
+  if (config == NULL) {
+    Serial.printf("✗ MQTT client %u has no broker configuration\n", (unsigned)client);
+    return false;
+  }
+
+  AtBuffer<AT_CMD_TEXT_MAX> cmd;
+  Serial.printf("Acquiring MQTT client %u (%s)...\n", (unsigned)client, config->clientId);
+  atCmdStart(cmd, AT_CMD_CMQTTACCQ);
+  atCmdArg(cmd, client);
+  atCmdArgQuoted(cmd, config->clientId);
+  atCmdArg(cmd, config->tls ? 1 : 0);  // Server type: 0 = TCP, 1 = SSL/TLS
+  bool acquired = sendATCommand(cmd.c_str(), atCommand(AT_CMD_CMQTTACCQ).timeoutMs).contains("OK");
+
+  if (acquired) {
+    Serial.printf("✓ MQTT client %u acquired successfully!\n", (unsigned)client);
+  } else {
+    Serial.printf("⚠ Client %u acquisition response unclear, continuing...\n", (unsigned)client);
+  }
+
+  // Enable unsolicited +CMQTTRX* delivery (some firmware versions might not support this)
+  atCmdStart(cmd, AT_CMD_CMQTTCFG);
+  atCmdArgQuoted(cmd, "recv/mode");
+  atCmdArg(cmd, client);
+  atCmdArg(cmd, 1);
+  if (sendATCommand(cmd.c_str(), atCommand(AT_CMD_CMQTTCFG).timeoutMs).contains("ERROR")) {
+    Serial.println("⚠ CMQTTCFG not supported, using default mode");
+  }
+
+  // A TLS client has to be bound to the SSL context before it connects
+  if (config->tls && !mqttTlsBind(client)) {
+    return false;
+  }
+  return acquired;
+}
+
+void mqttClientRelease(uint8_t client) {
+  AtBuffer<AT_CMD_MAX> cmd;
+  atCmdStart(cmd, AT_CMD_CMQTTREL);
+  atCmdArg(cmd, client);
+  sendATCommand(cmd.c_str(), atCommand(AT_CMD_CMQTTREL).timeoutMs);  // Error if nothing was acquired - IGNORE
+  mqttClientSetConnected(client, false);
+}
+
+// ===== Connection =====
+
+bool mqttClientConnect(uint8_t client) {
+  const MqttBrokerConfig* config = mqttClientConfig(client);
+  if (config == NULL) {
+    return false;
+  }
+
+  Serial.printf("--- Connecting MQTT client %u ---\n", (unsigned)client);
+  Serial.printf("Broker: %s:%u%s\n", config->host, (unsigned)config->port, config->tls ? " (TLS)" : "");
+  Serial.printf("Client ID: %s\n", config->clientId);
+
+  char url[160];
+  snprintf(url, sizeof(url), "tcp://%s:%u", config->host, (unsigned)config->port);
+  AtBuffer<AT_CMD_TEXT_MAX> cmd;
+  atCmdStart(cmd, AT_CMD_CMQTTCONNECT);
+  atCmdArg(cmd, client);
+  atCmdArgQuoted(cmd, url);
+  atCmdArg(cmd, config->keepAliveS);
+  atCmdArg(cmd, config->cleanSession ? 1 : 0);
+  if (config->user != NULL && config->user[0] != '\0') {
+    atCmdArgQuoted(cmd, config->user);
+    atCmdArgQuoted(cmd, config->password != NULL ? config->password : "");
+  }
+
+  mqttClientSetConnected(client, false);
+  mqttPublishInvalidateTopic(client);  // Fresh session - modem holds no topic
+  sendATCommand(cmd.c_str(), atCommand(AT_CMD_CMQTTCONNECT).timeoutMs);
+
+  // The result arrives after OK, once the broker handshake is done
+  // +CMQTTCONNECT: <client>,0 means SUCCESS
+  int err = atWaitResult(AT_CMD_CMQTTCONNECT, client);
+  if (err != 0) {
+    Serial.printf("⚠ MQTT client %u connect failed (error %d)\n", (unsigned)client, err);
+    return false;
+  }
+
+  Serial.printf("✓✓✓ MQTT CLIENT %u CONNECTED SUCCESSFULLY! ✓✓✓\n", (unsigned)client);
+  mqttClientSetConnected(client, true);
+  return true;
+}
+
+bool mqttClientDisconnect(uint8_t client) {
+  AtBuffer<AT_CMD_MAX> cmd;
+  atCmdStart(cmd, AT_CMD_CMQTTDISC);
+  atCmdArg(cmd, client);
+  atCmdArg(cmd, MQTT_DISCONNECT_TIMEOUT_S);
+
+  // Flags first - nothing may be staged on the client while it goes down
+  mqttClientSetConnected(client, false);
+  mqttPublishInvalidateTopic(client);
+  sendATCommand(cmd.c_str(), atCommand(AT_CMD_CMQTTDISC).timeoutMs);
+
+  // +CMQTTDISC: <client>,0 once the DISCONNECT packet went out
+  int err = atWaitResult(AT_CMD_CMQTTDISC, client);
+  if (err != 0) {
+    Serial.printf("⚠ MQTT client %u disconnect unclear (error %d)\n", (unsigned)client, err);
+    return false;
+  }
+  Serial.printf("✓ MQTT client %u disconnected\n", (unsigned)client);
+  return true;
+}
+
+bool mqttClientSubscribeBatch(uint8_t client, const char* const* topics, const uint8_t* qos,
+                              uint8_t count) {
+  AtBuffer<AT_CMD_MAX> cmd;
+  if (count == 0 || count > MQTT_SUBSCRIBE_BATCH) {
+    return false;
+  }
+
+  // Step 1: Queue every topic in the modem - length and QoS, '>' prompt, topic
+  for (uint8_t i = 0; i < count; i++) {
+    int topicLen = strlen(topics[i]);
+    Serial.printf("Subscribing client %u to: %s\n", (unsigned)client, topics[i]);
+
+    atCmdStart(cmd, AT_CMD_CMQTTSUBTOPIC);
+    atCmdArg(cmd, client);
+    atCmdArg(cmd, topicLen);
+    atCmdArg(cmd, qos[i]);
+    atFlushResponses();
+    Serial.printf(">> %s\n", cmd.c_str());
+    atWriteLine(cmd.c_str());
+    if (!atWaitPrompt(AT_CMD_CMQTTSUBTOPIC)) {
+      // Never type the topic onto the command line - it would garble the next command
+      Serial.println("⚠ Subscribe failed: no '>' prompt for topic");
+      atFlushResponses();
+      return false;
+    }
+
+    // Send the actual topic string (exactly topicLen bytes)
+    atWrite(topics[i]);
+    Serial.printf(">> %s\n", topics[i]);
+    if (!atWaitOk(AT_CMD_CMQTTSUBTOPIC, true)) {
+      Serial.println("⚠ Subscribe failed: topic not accepted");
+      atFlushResponses();
+      return false;
+    }
+  }
+
+  // Step 2: One AT+CMQTTSUB subscribes all of them
+  // +CMQTTSUB: <client>,<err> follows the OK once the broker answers
+  atCmdStart(cmd, AT_CMD_CMQTTSUB);
+  atCmdArg(cmd, client);
+  sendATCommand(cmd.c_str(), atCommand(AT_CMD_CMQTTSUB).timeoutMs);
+  int err = atWaitResult(AT_CMD_CMQTTSUB, client);
+  if (err == 0) {
+    Serial.printf("✓ Subscribed successfully! (%u topic%s)\n", (unsigned)count, count == 1 ? "" : "s");
+    return true;
+  }
+  if (err == 12) {
+    // Refused by the broker - retrying the same filter can't help
+    Serial.println("⚠ Subscription error 12 (topic format issue?), but continuing...");
+    return true;
+  }
+  if (err == 11) {
+    Serial.println("⚠ Subscription error 11 (not connected to broker?)");
+  } else {
+    Serial.println("⚠ Subscription response unclear");
+    Serial.println(atResponse().c_str());
+  }
+  return false;
+}
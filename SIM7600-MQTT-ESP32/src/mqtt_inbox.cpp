@@ -0,0 +1,144 @@
+#include "mqtt_inbox.h"
+#include "mqtt_router.h"
+
+#define INBOX_HEADER_LEN 12  // client, 0, topicLen (LE16), payloadLen (LE32), receivedAt
+
+// ===== Global Variables =====
+static PsramRing ring;
+static volatile uint32_t dropped = 0;
+static uint32_t delivered = 0;
+static uint32_t unhandled = 0;
+
+// Message being assembled
+static uint8_t* building = NULL;
+static uint16_t buildTopicMax = 0;
+static uint32_t buildPayloadMax = 0;
+static uint16_t buildTopicLen = 0;
+static uint32_t buildPayloadLen = 0;
+
+// ===== Lifecycle =====
+
+bool inboxInit() {
+  if (!psramRingInit(&ring, INBOX_RAM_BYTES, INBOX_FALLBACK_BYTES)) {
+    return false;
+  }
+  PsramRingStats st;
+  psramRingGetStats(&ring, &st);
+  Serial.printf("✓ Inbox: %lu KB in %s\n", (unsigned long)(st.capacity / 1024),
+                st.inPsram ? "PSRAM" : "internal RAM");
+  return true;
+}
+
+// ===== Producer =====
+
+bool inboxBegin(uint8_t client, uint16_t topicLen, uint32_t payloadLen) {
+  building = psramRingReserve(&ring, INBOX_HEADER_LEN + topicLen + payloadLen);
+  if (building == NULL) {
+    dropped++;
+    return false;
+  }
+  building[0] = client;
+  building[1] = 0;
+  uint32_t now = micros();
+  memcpy(building + 8, &now, sizeof(now));
+  buildTopicMax = topicLen;
+  buildPayloadMax = payloadLen;
+  buildTopicLen = 0;
+  buildPayloadLen = 0;
+  return true;
+}
+
+uint8_t* inboxWritePtr(InboxPart part, size_t* room) {
+  if (building == NULL) {
+    *room = 0;
+    return NULL;
+  }
+  if (part == INBOX_TOPIC) {
+    *room = buildTopicMax - buildTopicLen;
+    return building + INBOX_HEADER_LEN + buildTopicLen;
+  }
+  // Payload follows the full announced topic length
+  *room = buildPayloadMax - buildPayloadLen;
+  return building + INBOX_HEADER_LEN + buildTopicMax + buildPayloadLen;
+}
+
+void inboxAdvance(InboxPart part, size_t n) {
+  if (building == NULL) {
+    return;
+  }
+  if (part == INBOX_TOPIC) {
+    buildTopicLen += n;
+  } else {
+    buildPayloadLen += n;
+  }
+}
+
+void inboxCommit() {
+  if (building == NULL) {
+    return;
+  }
+  building[2] = buildTopicLen & 0xFF;
+  building[3] = buildTopicLen >> 8;
+  building[4] = buildPayloadLen & 0xFF;
+  building[5] = (buildPayloadLen >> 8) & 0xFF;
+  building[6] = (buildPayloadLen >> 16) & 0xFF;
+  building[7] = buildPayloadLen >> 24;
+  if (buildTopicLen < buildTopicMax) {
+    // Short topic - close the gap so the payload directly follows it
+    memmove(building + INBOX_HEADER_LEN + buildTopicLen,
+            building + INBOX_HEADER_LEN + buildTopicMax, buildPayloadLen);
+  }
+  psramRingCommit(&ring, INBOX_HEADER_LEN + buildTopicLen + buildPayloadLen);
+  building = NULL;
+}
+
+void inboxAbort() {
+  if (building != NULL) {
+    building = NULL;
+    dropped++;
+  }
+}
+
+// ===== Consumer =====
+
+uint32_t inboxDispatch() {
+  uint32_t count = 0;
+  InboundMsg msg;
+  while (inboxPeek(&msg)) {
+    if (mqttRouteMessage(msg)) {
+      delivered++;
+    } else {
+      unhandled++;
+      Serial.printf("⚠ No handler for topic: %.*s\n", (int)msg.topicLen, msg.topic);
+    }
+    inboxPop();
+    count++;
+  }
+  return count;
+}
+
+bool inboxPeek(InboundMsg* msg) {
+  uint32_t len;
+  const uint8_t* rec = psramRingPeek(&ring, &len);
+  if (rec == NULL) {
+    return false;
+  }
+  msg->client = rec[0];
+  msg->topicLen = rec[2] | (rec[3] << 8);
+  msg->payloadLen = rec[4] | (rec[5] << 8) | ((uint32_t)rec[6] << 16) | ((uint32_t)rec[7] << 24);
+  memcpy(&msg->receivedAt, rec + 8, sizeof(msg->receivedAt));
+  msg->topic = (const char*)(rec + INBOX_HEADER_LEN);
+  msg->payload = rec + INBOX_HEADER_LEN + msg->topicLen;
+  return true;
+}
+
+void inboxPop() {
+  psramRingPop(&ring);
+}
+
+void inboxGetStats(InboxStats* out) {
+  psramRingGetStats(&ring, &out->ring);
+  out->dropped = dropped;
+  out->delivered = delivered;
+  out->unhandled = unhandled;
+}
@@ -0,0 +1,535 @@
+#include "mqtt_publish.h"
+#include "at_engine.h"
+#include "offline_store.h"
+#include "metrics.h"
+#include "modem.h"
+#include "modem_power.h"
+
+// ===== Global Variables =====
+static volatile uint32_t droppedMessages = 0;  // Rejected before reaching a queue
+static uint32_t nextSeq = 1;
+static volatile PublishResultHook resultHook = NULL;
+
+struct InflightEntry {
+  PublishMsg* msg;
+  bool topicSkipped;  // Published relying on the topic already in the modem
+};
+
+/**
+ * @brief Publish state of one MQTT client
+ * @note Only the client's PublishTask touches it; counters are read by the watchdog
+ */
+struct PublishClient {
+  uint8_t index;
+  QueueHandle_t queue;
+
+  // In-flight window: published messages in the order their results will arrive
+  InflightEntry inflight[PUBLISH_INFLIGHT_MAX];
+  uint8_t inflightHead;
+  volatile uint8_t inflightCount;
+
+  // Topic currently loaded in the modem's slot for this client. Cleared on
+  // connect and on +CMQTTCONNLOST; topicReuse turns itself off if the modem
+  // keeps rejecting publishes that relied on it (firmware that clears the
+  // topic after PUB).
+  char loadedTopic[MSG_TOPIC_MAX + 1];
+  volatile bool topicLoaded;
+  bool topicReuse;
+  uint8_t topicReuseFailures;
+
+  volatile uint32_t delivered;
+  volatile uint32_t failed;
+  volatile uint32_t retried;
+  volatile uint32_t dropped;  // Queue full
+  volatile uint32_t topicSkips;
+  volatile uint32_t lastDeliveredSeq;
+};
+
+static PublishClient clients[MQTT_CLIENT_COUNT];
+
+// ===== API =====
+
+bool mqttPublishInit() {
+  bool ok = true;
+  for (uint8_t i = 0; i < MQTT_CLIENT_COUNT; i++) {
+    PublishClient* pc = &clients[i];
+    memset(pc, 0, sizeof(*pc));
+    pc->index = i;
+    pc->topicReuse = PUBLISH_REUSE_TOPIC;
+    pc->queue = xQueueCreate(PUBLISH_QUEUE_LEN, sizeof(PublishMsg*));
+    ok = ok && pc->queue != NULL;
+  }
+  return ok;
+}
+
+bool mqttPublishAsync(const char* topic, const char* payload, uint8_t qos) {
+  return mqttPublishAsync(MQTT_CLIENT_TELEMETRY, topic, payload, strlen(payload), qos);
+}
+
+bool mqttPublishAsync(const char* topic, const char* payload, size_t len, uint8_t qos) {
+  return mqttPublishAsync(MQTT_CLIENT_TELEMETRY, topic, payload, len, qos);
+}
+
+bool mqttPublishAsync(uint8_t client, const char* topic, const char* payload, size_t len, uint8_t qos) {
+  size_t topicLen = strlen(topic);
+  if (client >= MQTT_CLIENT_COUNT || topicLen == 0 || topicLen > MSG_TOPIC_MAX ||
+      len > MSG_PAYLOAD_MAX) {
+    Serial.printf("⚠ Publish rejected: topic %u / payload %u bytes too long\n",
+                  (unsigned)topicLen, (unsigned)len);
+    droppedMessages++;
+    return false;
+  }
+
+  PublishMsg* msg = msgPoolAcquire();
+  if (msg == NULL) {
+    droppedMessages++;
+    return false;
+  }
+
+  memcpy(msg->topic, topic, topicLen + 1);
+  memcpy(msg->payload, payload, len);
+  msg->payloadLen = (uint16_t)len;
+  msg->qos = qos;
+  msg->client = client;
+
+  return mqttPublishSubmit(msg);
+}
+
+bool mqttPublishSubmit(PublishMsg* msg) {
+  msg->enqueuedAt = millis();
+  msg->retries = 0;
+
+  // Sequence numbers are handed out by several producer tasks
+  static portMUX_TYPE seqMux = portMUX_INITIALIZER_UNLOCKED;
+  portENTER_CRITICAL_SAFE(&seqMux);
+  msg->seq = nextSeq++;
+  portEXIT_CRITICAL_SAFE(&seqMux);
+
+  if (msg->client >= MQTT_CLIENT_COUNT) {
+    msgPoolRelease(msg);
+    droppedMessages++;
+    return false;
+  }
+
+  PublishClient* pc = &clients[msg->client];
+#if OFFLINE_STORE_ENABLED
+  // Link down - park the message in flash instead of a pool slot
+  if (!mqttClientIsConnected(msg->client) && storeAppend(msg)) {
+    msgPoolRelease(msg);
+    return true;
+  }
+#endif
+
+  // Never block the producer - a full queue means the modem can't keep up
+  if (xQueueSend(pc->queue, &msg, 0) != pdTRUE) {
+#if OFFLINE_STORE_ENABLED
+    if (storeAppend(msg)) {
+      msgPoolRelease(msg);
+      return true;
+    }
+#endif
+    msgPoolRelease(msg);
+    pc->dropped++;
+    return false;
+  }
+  metricsRecordQueueDepth(msg->client, uxQueueMessagesWaiting(pc->queue));
+  return true;
+}
+
+// ===== Helpers =====
+
+static bool isPrintable(const char* data, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    uint8_t c = (uint8_t)data[i];
+    if (c < 0x20 && c != '\n' && c != '\r' && c != '\t') {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Put a failed message back at the front of the queue, or give up
+ * @note Takes ownership of msg
+ */
+static void retryOrFail(PublishClient* pc, PublishMsg* msg) {
+  if (msg->retries < PUBLISH_MAX_RETRIES) {
+    msg->retries++;
+    if (xQueueSendToFront(pc->queue, &msg, 0) == pdTRUE) {
+      pc->retried++;
+      return;
+    }
+  }
+#if OFFLINE_STORE_ENABLED
+  // Gave up because the link went away - replay it after reconnecting
+  if (!mqttClientIsConnected(pc->index) && storeAppend(msg)) {
+    msgPoolRelease(msg);
+    return;
+  }
+#endif
+  Serial.printf("✗ Publish #%lu dropped after %u attempts\n",
+                (unsigned long)msg->seq, (unsigned)msg->retries + 1);
+  pc->failed++;
+  PublishResultHook hook = resultHook;
+  if (hook != NULL) {
+    hook(msg, false, millis() - msg->enqueuedAt);
+  }
+  msgPoolRelease(msg);
+}
+
+// ===== In-Flight Window =====
+
+static void inflightPush(PublishClient* pc, PublishMsg* msg, bool topicSkipped) {
+  uint8_t tail = (pc->inflightHead + pc->inflightCount) % PUBLISH_INFLIGHT_MAX;
+  pc->inflight[tail].msg = msg;
+  pc->inflight[tail].topicSkipped = topicSkipped;
+  pc->inflightCount++;
+}
+
+static InflightEntry inflightPop(PublishClient* pc) {
+  InflightEntry entry = pc->inflight[pc->inflightHead];
+  pc->inflightHead = (pc->inflightHead + 1) % PUBLISH_INFLIGHT_MAX;
+  pc->inflightCount--;
+  return entry;
+}
+
+/**
+ * @brief Retry every in-flight message, oldest ending up first in the queue
+ * @note Used when results can no longer be matched to messages
+ */
+static void inflightRetryAll(PublishClient* pc) {
+  while (pc->inflightCount > 0) {
+    uint8_t newest = (pc->inflightHead + pc->inflightCount - 1) % PUBLISH_INFLIGHT_MAX;
+    pc->inflightCount--;
+    retryOrFail(pc, pc->inflight[newest].msg);
+  }
+  pc->inflightHead = 0;
+}
+
+// ===== Topic Cache, Hook and Stats =====
+
+void mqttPublishSetResultHook(PublishResultHook hook) {
+  resultHook = hook;
+}
+
+void mqttPublishInvalidateTopic(uint8_t client) {
+  if (client < MQTT_CLIENT_COUNT) {
+    clients[client].topicLoaded = false;
+  }
+}
+
+void mqttPublishGetStats(uint8_t client, MqttPublishStats* stats) {
+  memset(stats, 0, sizeof(*stats));
+  if (client >= MQTT_CLIENT_COUNT) {
+    return;
+  }
+  const PublishClient* pc = &clients[client];
+  stats->queued = pc->queue != NULL ? uxQueueMessagesWaiting(pc->queue) : 0;
+  stats->inFlight = pc->inflightCount;
+  stats->delivered = pc->delivered;
+  // Invalid requests can't be pinned on a client - report them with client 0
+  stats->dropped = pc->dropped + (client == 0 ? droppedMessages : 0);
+  stats->failed = pc->failed;
+  stats->retried = pc->retried;
+  stats->topicSkips = pc->topicSkips;
+  stats->lastDeliveredSeq = pc->lastDeliveredSeq;
+}
+
+// ===== Staging =====
+
+static void handleResult(PublishClient* pc, const AtLine& line);
+
+#define STAGE_OK            0   // AT+CMQTTPUB accepted - result will follow
+#define STAGE_FAILED       -1   // A step before AT+CMQTTPUB failed
+#define STAGE_PUB_REJECTED -2   // AT+CMQTTPUB itself answered ERROR
+
+/**
+ * @brief One TOPIC / PAYLOAD / PUB sequence, up to the OK of AT+CMQTTPUB
+ * @return STAGE_OK, STAGE_FAILED or STAGE_PUB_REJECTED
+ */
+static int publishSteps(PublishClient* pc, const PublishMsg* msg, bool sendTopic) {
+  AtBuffer<AT_CMD_MAX> cmd;  // Built from the command table - no snprintf on this path
+
+  // Prompt-driven publish: every step waits for the modem's actual answer
+  // ('>' input prompt, OK) instead of sleeping a fixed time, so a publish
+  // takes as long as the modem needs and no longer.
+
+  atFlushResponses();
+
+  // Step 1: Set topic length, wait for '>' and send exactly topicLen bytes
+  if (sendTopic) {
+    pc->topicLoaded = false;
+    uint32_t start = millis();
+    int topicLen = strlen(msg->topic);
+    atCmdStart(cmd, AT_CMD_CMQTTTOPIC);
+    atCmdArg(cmd, pc->index);
+    atCmdArg(cmd, topicLen);
+    atWriteLine(cmd.c_str());
+    if (!atWaitPrompt(AT_CMD_CMQTTTOPIC)) {
+      Serial.println("⚠ Publish failed: no '>' prompt for topic");
+      return STAGE_FAILED;
+    }
+    atWrite(msg->topic, topicLen);  // No CRLF - modem reads exactly topicLen bytes
+    if (!atWaitOk(AT_CMD_CMQTTTOPIC, true)) {
+      Serial.println("⚠ Publish failed: topic not accepted");
+      return STAGE_FAILED;
+    }
+    metricsRecordAt(atCommand(AT_CMD_CMQTTTOPIC).name, millis() - start);
+    memcpy(pc->loadedTopic, msg->topic, topicLen + 1);
+    pc->topicLoaded = true;
+  }
+
+  // Step 2: Set payload length, wait for '>' and send exactly len bytes
+  uint32_t start = millis();
+  atCmdStart(cmd, AT_CMD_CMQTTPAYLOAD);
+  atCmdArg(cmd, pc->index);
+  atCmdArg(cmd, msg->payloadLen);
+  atWriteLine(cmd.c_str());
+  if (!atWaitPrompt(AT_CMD_CMQTTPAYLOAD)) {
+    Serial.println("⚠ Publish failed: no '>' prompt for payload");
+    return STAGE_FAILED;
+  }
+  atWrite(msg->payload, msg->payloadLen);
+  if (!atWaitOk(AT_CMD_CMQTTPAYLOAD, true)) {
+    Serial.println("⚠ Publish failed: payload not accepted");
+    return STAGE_FAILED;
+  }
+  metricsRecordAt(atCommand(AT_CMD_CMQTTPAYLOAD).name, millis() - start);
+
+  // Step 3: Publish, modem-side timeout 60 seconds. Only wait for the OK -
+  // the +CMQTTPUB: <client>,<err> result arrives on the ack queue later.
+  atCmdStart(cmd, AT_CMD_CMQTTPUB);
+  atCmdArg(cmd, pc->index);
+  atCmdArg(cmd, msg->qos);
+  atCmdArg(cmd, 60);
+  start = millis();
+  atWriteLine(cmd.c_str());
+  if (!atWaitOk(AT_CMD_CMQTTPUB, false)) {
+    Serial.println("⚠ Publish failed: AT+CMQTTPUB not accepted");
+    return STAGE_PUB_REJECTED;
+  }
+  metricsRecordAt(atCommand(AT_CMD_CMQTTPUB).name, millis() - start);
+  return STAGE_OK;
+}
+
+/**
+ * @brief AT+CMQTTPUB answered ERROR - match what is queued, minus its own result
+ * @note The SIM7600 may report "+CMQTTPUB: <client>,<err>" for the rejected
+ *       command right before the ERROR. It is then the newest line on the ack
+ *       queue: beyond what the window is waiting for, or a failure behind
+ *       the results for older messages. Everything else still belongs to
+ *       the window in order, so no in-flight message is published twice.
+ */
+static void dropRejectedResult(PublishClient* pc) {
+  AtLine lines[AT_PUBACK_QUEUE_LEN];
+  uint8_t count = 0;
+  while (count < AT_PUBACK_QUEUE_LEN && atNextPubAck(pc->index, &lines[count], 0)) {
+    count++;
+  }
+  if (count == 0) {
+    return;
+  }
+
+  int client = -1;
+  int err = -1;
+  atParseResult(AT_CMD_CMQTTPUB, lines[count - 1].text, &client, &err);
+  bool own = count > pc->inflightCount || err != 0;
+  for (uint8_t i = 0; i < count; i++) {
+    if (own && i == count - 1) {
+      Serial.printf("📡 Result of the rejected publish: %s\n", lines[i].text);
+    } else {
+      handleResult(pc, lines[i]);
+    }
+    atReleaseLine(lines[i]);
+  }
+}
+
+/**
+ * @brief Stage one message and move it into the in-flight window
+ * @note Runs on ModemTask (stageJob). Takes ownership of msg.
+ */
+static void stageMessage(PublishClient* pc, PublishMsg* msg) {
+  // Skip AT+CMQTTTOPIC when the modem already holds this exact topic
+  bool reuse = pc->topicReuse && pc->topicLoaded && strcmp(pc->loadedTopic, msg->topic) == 0;
+  if (reuse) {
+    pc->topicSkips++;
+  }
+
+  int result = publishSteps(pc, msg, !reuse);
+
+  if (result == STAGE_PUB_REJECTED) {
+    dropRejectedResult(pc);
+    pc->topicLoaded = false;
+    if (reuse) {
+      // Maybe this firmware forgets the topic after each PUB - retry in full
+      pc->topicReuseFailures++;
+      result = publishSteps(pc, msg, true);
+      if (result == STAGE_OK && pc->topicReuse) {
+        Serial.println("⚠ Modem does not keep the publish topic - topic reuse disabled");
+        pc->topicReuse = false;
+      } else if (result == STAGE_PUB_REJECTED) {
+        dropRejectedResult(pc);
+        pc->topicLoaded = false;
+      }
+      reuse = false;
+    }
+  }
+
+  if (result == STAGE_OK) {
+    msg->sentAt = millis();
+    inflightPush(pc, msg, reuse);
+    return;
+  }
+  retryOrFail(pc, msg);
+}
+
+struct StageRequest {
+  PublishClient* pc;
+  PublishMsg* msg;
+};
+
+// ModemJob wrapper - one staged message is one modem request
+static int stageJob(void* arg) {
+  StageRequest* req = (StageRequest*)arg;
+  stageMessage(req->pc, req->msg);
+  return 0;
+}
+
+// ===== Results =====
+
+/**
+ * @brief Match one +CMQTTPUB: <client>,<err> line to the oldest in-flight message
+ */
+static void handleResult(PublishClient* pc, const AtLine& line) {
+  int client = -1;
+  int err = -1;
+  atParseResult(AT_CMD_CMQTTPUB, line.text, &client, &err);
+
+  if (pc->inflightCount == 0) {
+    Serial.printf("⚠ Publish result with nothing in flight: %s\n", line.text);
+    return;
+  }
+
+  InflightEntry entry = inflightPop(pc);
+  PublishMsg* msg = entry.msg;
+
+  if (err != 0) {
+    Serial.printf("⚠ Publish #%lu failed: +CMQTTPUB error %d\n", (unsigned long)msg->seq, err);
+    if (entry.topicSkipped) {
+      // Maybe this firmware forgets the topic after each PUB
+      pc->topicLoaded = false;
+      if (pc->topicReuse && ++pc->topicReuseFailures >= 2) {
+        Serial.println("⚠ Modem does not keep the publish topic - topic reuse disabled");
+        pc->topicReuse = false;
+      }
+    }
+    retryOrFail(pc, msg);
+    return;
+  }
+
+  unsigned long latency = millis() - msg->enqueuedAt;
+  metricsRecordPublish(pc->index, latency);
+  powerNoteDelivered();
+  if (isPrintable(msg->payload, msg->payloadLen)) {
+    Serial.printf("✓ Delivered #%lu (%lu ms): %s → %.*s\n", (unsigned long)msg->seq, latency,
+                  msg->topic, (int)msg->payloadLen, msg->payload);
+  } else {
+    Serial.printf("✓ Delivered #%lu (%lu ms): %s → <%u bytes binary>\n", (unsigned long)msg->seq,
+                  latency, msg->topic, (unsigned)msg->payloadLen);
+  }
+  if (entry.topicSkipped) {
+    pc->topicReuseFailures = 0;
+  }
+  pc->delivered++;
+  pc->lastDeliveredSeq = msg->seq;
+  PublishResultHook hook = resultHook;
+  if (hook != NULL) {
+    hook(msg, true, latency);
+  }
+  msgPoolRelease(msg);
+}
+
+/**
+ * @brief Handle every result already queued, then check the oldest for timeout
+ */
+static void processResults(PublishClient* pc) {
+  AtLine line;
+  while (atNextPubAck(pc->index, &line, 0)) {
+    handleResult(pc, line);
+    atReleaseLine(line);
+  }
+
+  if (pc->inflightCount > 0 &&
+      millis() - pc->inflight[pc->inflightHead].msg->sentAt > PUB_ACK_TIMEOUT_MS) {
+    // A lost result shifts every later match - start the window over
+    Serial.printf("⚠ No +CMQTTPUB result for #%lu - retrying %u in-flight message(s)\n",
+                  (unsigned long)pc->inflight[pc->inflightHead].msg->seq,
+                  (unsigned)pc->inflightCount);
+    inflightRetryAll(pc);
+    pc->topicLoaded = false;
+  }
+}
+
+// ===== FreeRTOS Task =====
+
+/**
+ * @brief One pass of PublishTask: collect results, then stage at most one message
+ * @param idleWait How long to wait for a message when nothing is in flight
+ */
+static void publishStep(PublishClient* pc, TickType_t idleWait) {
+  processResults(pc);
+
+  // Window full: nothing to stage until the oldest result comes back
+  if (pc->inflightCount >= PUBLISH_INFLIGHT_MAX) {
+    AtLine line;
+    if (atNextPubAck(pc->index, &line, pdMS_TO_TICKS(PUB_POLL_MS))) {
+      handleResult(pc, line);
+      atReleaseLine(line);
+    }
+    return;
+  }
+
+  // Nothing outstanding: sleep until a message is queued
+  TickType_t wait = pc->inflightCount > 0 ? pdMS_TO_TICKS(PUB_POLL_MS) : idleWait;
+  PublishMsg* msg = NULL;
+  if (xQueueReceive(pc->queue, &msg, wait) != pdTRUE) {
+    return;
+  }
+
+  // Hold the message (and its buffer) until this client's broker is reachable again
+  while (!mqttClientIsConnected(pc->index)) {
+    vTaskDelay(pdMS_TO_TICKS(500));
+    processResults(pc);
+  }
+
+  StageRequest req = { pc, msg };
+  bool urgent = pc->index == MQTT_CLIENT_CONTROL;
+  if (modemCall(stageJob, &req, pdMS_TO_TICKS(10000), urgent) < 0) {
+    Serial.println("⚠ Modem queue full - publish postponed");
+    retryOrFail(pc, msg);
+  }
+}
+
+/**
+ * @brief Publish Task - Sole publisher for one MQTT client
+ * @param pvParameters Client index, cast to void*
+ * @note Hands ModemTask one message at a time, so commands from other
+ *       tasks interleave between publishes. The control client's requests
+ *       go to the front of the modem queue. Results are collected here.
+ */
+void vPublishTask(void *pvParameters) {
+  uint8_t client = (uint8_t)(uintptr_t)pvParameters;
+  if (client >= MQTT_CLIENT_COUNT) {
+    Serial.printf("✗ PublishTask: invalid MQTT client %u\n", (unsigned)client);
+    vTaskDelete(NULL);
+    return;
+  }
+  PublishClient* pc = &clients[client];
+
+  Serial.printf("📤 PublishTask started - client %u (%d in flight)\n",
+                (unsigned)client, PUBLISH_INFLIGHT_MAX);
+
+  while (1) {
+    publishStep(pc, portMAX_DELAY);
+  }
+}
@@ -0,0 +1,231 @@
+#include "mqtt_router.h"
+
+#define NODE_NONE  -1
+
+enum NodeKind : uint8_t {
+  NODE_LITERAL,
+  NODE_PLUS,   // '+' - exactly one level
+  NODE_HASH,   // '#' - this level and everything below (or nothing)
+};
+
+/**
+ * @brief One topic level of one or more filters
+ */
+struct RouteNode {
+  const char* seg;      // Level text inside the filter (NOT NUL-terminated)
+  uint8_t segLen;
+  uint8_t kind;
+  int8_t child;         // First child
+  int8_t next;          // Next sibling
+  int8_t route;         // First route whose filter ends here
+};
+
+struct Route {
+  const char* filter;
+  MqttMessageHandler handler;
+  void* ctx;
+  uint8_t qos;
+  uint8_t client;
+  bool subscribe;       // false: local route only
+  int8_t next;          // Next route ending at the same node
+};
+
+static_assert(ROUTER_MAX_NODES <= 127 && ROUTER_MAX_ROUTES <= 127,
+              "Router indices are int8_t");
+
+// ===== Global Variables =====
+static RouteNode nodes[ROUTER_MAX_NODES];
+static uint8_t nodeCount = 1;  // nodes[0] is the root
+static Route routes[ROUTER_MAX_ROUTES];
+static uint8_t routeCount = 0;
+static bool rootReady = false;
+
+// ===== Trie =====
+
+static void initRoot() {
+  if (!rootReady) {
+    nodes[0] = { "", 0, NODE_LITERAL, NODE_NONE, NODE_NONE, NODE_NONE };
+    rootReady = true;
+  }
+}
+
+// Child of parent for one filter level, created if missing
+static int findOrAddChild(int parent, const char* seg, size_t len) {
+  uint8_t kind = NODE_LITERAL;
+  if (len == 1 && seg[0] == '+') {
+    kind = NODE_PLUS;
+  } else if (len == 1 && seg[0] == '#') {
+    kind = NODE_HASH;
+  }
+
+  for (int c = nodes[parent].child; c != NODE_NONE; c = nodes[c].next) {
+    if (nodes[c].kind == kind &&
+        (kind != NODE_LITERAL || (nodes[c].segLen == len && memcmp(nodes[c].seg, seg, len) == 0))) {
+      return c;
+    }
+  }
+  if (nodeCount >= ROUTER_MAX_NODES || len > 255) {
+    return NODE_NONE;
+  }
+  int n = nodeCount++;
+  nodes[n] = { seg, (uint8_t)len, kind, NODE_NONE, nodes[parent].child, NODE_NONE };
+  nodes[parent].child = n;
+  return n;
+}
+
+// '+' and '#' must fill a whole level, '#' only as the last one
+static bool validFilter(const char* filter) {
+  size_t len = strlen(filter);
+  if (len == 0) {
+    return false;
+  }
+  for (size_t i = 0; i < len; i++) {
+    char c = filter[i];
+    if (c != '+' && c != '#') {
+      continue;
+    }
+    bool levelStart = i == 0 || filter[i - 1] == '/';
+    bool levelEnd = i + 1 == len || filter[i + 1] == '/';
+    if (!levelStart || !levelEnd || (c == '#' && i + 1 != len)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool addRoute(const char* filter, uint8_t qos, MqttMessageHandler handler, void* ctx,
+                     uint8_t client, bool subscribe) {
+  initRoot();
+  if (handler == NULL || routeCount >= ROUTER_MAX_ROUTES || !validFilter(filter)) {
+    Serial.printf("✗ Cannot route topic filter: %s\n", filter != NULL ? filter : "(null)");
+    return false;
+  }
+
+  int node = 0;
+  const char* seg = filter;
+  while (true) {
+    const char* slash = strchr(seg, '/');
+    size_t len = slash != NULL ? (size_t)(slash - seg) : strlen(seg);
+    node = findOrAddChild(node, seg, len);
+    if (node == NODE_NONE) {
+      Serial.printf("✗ Router full (ROUTER_MAX_NODES) at filter: %s\n", filter);
+      return false;
+    }
+    if (slash == NULL) {
+      break;
+    }
+    seg = slash + 1;
+  }
+
+  int r = routeCount++;
+  routes[r] = { filter, handler, ctx, qos, client, subscribe, nodes[node].route };
+  nodes[node].route = r;
+  return true;
+}
+
+// ===== Registration =====
+
+bool mqttSubscribe(const char* filter, uint8_t qos, MqttMessageHandler handler,
+                   void* ctx, uint8_t client) {
+  if (client >= MQTT_CLIENT_COUNT) {
+    return false;
+  }
+  return addRoute(filter, qos, handler, ctx, client, true);
+}
+
+bool mqttOnMessage(const char* filter, MqttMessageHandler handler, void* ctx) {
+  return addRoute(filter, 0, handler, ctx, 0, false);
+}
+
+// ===== Routing =====
+
+static bool deliver(int node, const InboundMsg& msg) {
+  bool handled = false;
+  for (int r = nodes[node].route; r != NODE_NONE; r = routes[r].next) {
+    routes[r].handler(msg, routes[r].ctx);
+    handled = true;
+  }
+  return handled;
+}
+
+/**
+ * @brief Match the topic level starting at pos against the children of node
+ * @note pos > topicLen means every level has been consumed
+ */
+static bool walk(int node, const InboundMsg& msg, size_t pos) {
+  const char* topic = msg.topic;
+  size_t topicLen = msg.topicLen;
+  bool consumed = pos > topicLen;
+
+  size_t end = pos;
+  while (!consumed && end < topicLen && topic[end] != '/') {
+    end++;
+  }
+  // Wildcards never match "$SYS/..." style topics at the first level
+  bool wildOk = !(node == 0 && topicLen > 0 && topic[0] == '$');
+
+  bool handled = false;
+  for (int c = nodes[node].child; c != NODE_NONE; c = nodes[c].next) {
+    const RouteNode& n = nodes[c];
+    if (n.kind == NODE_HASH) {
+      if (wildOk) {
+        handled |= deliver(c, msg);  // "a/#" also matches "a" itself
+      }
+      continue;
+    }
+    if (consumed) {
+      continue;
+    }
+    bool match = n.kind == NODE_PLUS
+        ? wildOk
+        : n.segLen == end - pos && memcmp(n.seg, topic + pos, n.segLen) == 0;
+    if (!match) {
+      continue;
+    }
+    if (end == topicLen) {
+      handled |= deliver(c, msg);
+      handled |= walk(c, msg, topicLen + 1);  // Only '#' children can still match
+    } else {
+      handled |= walk(c, msg, end + 1);
+    }
+  }
+  return handled;
+}
+
+bool mqttRouteMessage(const InboundMsg& msg) {
+  return rootReady && walk(0, msg, 0);
+}
+
+// ===== Subscriptions =====
+
+uint8_t mqttRouterSubscriptionCount(uint8_t client) {
+  uint8_t count = 0;
+  for (uint8_t r = 0; r < routeCount; r++) {
+    count += (routes[r].subscribe && routes[r].client == client) ? 1 : 0;
+  }
+  return count;
+}
+
+bool mqttRouterSubscribe(uint8_t client) {
+  const char* topics[MQTT_SUBSCRIBE_BATCH];
+  uint8_t qos[MQTT_SUBSCRIBE_BATCH];
+  uint8_t batch = 0;
+  bool ok = true;
+
+  // Registration order, MQTT_SUBSCRIBE_BATCH filters per AT+CMQTTSUB
+  for (uint8_t r = 0; r < routeCount; r++) {
+    if (!routes[r].subscribe || routes[r].client != client) {
+      continue;
+    }
+    topics[batch] = routes[r].filter;
+    qos[batch] = routes[r].qos;
+    if (++batch == MQTT_SUBSCRIBE_BATCH) {
+      ok = mqttClientSubscribeBatch(client, topics, qos, batch) && ok;
+      batch = 0;
+    }
+  }
+  if (batch > 0) {
+    ok = mqttClientSubscribeBatch(client, topics, qos, batch) && ok;
+  }
+  return ok;
+}
@@ -0,0 +1,169 @@
+#include "mqtt_tls.h"
+#include <Preferences.h>
+#include "at_commands.h"
+#include "at_engine.h"
+#include "mqtt_client.h"
+#include "warm_start.h"
+
+#define CA_HASH_KEY  "cahash"
+
+// ===== Global Variables =====
+static const char* caCert = NULL;
+static MqttTlsStats stats = {};
+static portMUX_TYPE tlsLock = portMUX_INITIALIZER_UNLOCKED;
+
+// ===== Configuration =====
+
+void mqttTlsConfigure(const char* caPem) {
+  caCert = caPem;
+}
+
+bool mqttTlsInUse() {
+  for (uint8_t client = 0; client < MQTT_CLIENT_COUNT; client++) {
+    const MqttBrokerConfig* cfg = mqttClientConfig(client);
+    if (cfg != NULL && cfg->tls) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void mqttTlsGetStats(MqttTlsStats* out) {
+  portENTER_CRITICAL_SAFE(&tlsLock);
+  *out = stats;
+  portEXIT_CRITICAL_SAFE(&tlsLock);
+}
+
+// ===== CA Certificate =====
+
+static uint32_t caHash() {
+  return warmHash(warmHash(WARM_HASH_SEED, caCert), (uint32_t)strlen(caCert));
+}
+
+static bool loadCaHash(uint32_t* hash) {
+  Preferences prefs;
+  if (!prefs.begin(MQTT_TLS_NVS_NAMESPACE, true)) {
+    return false;  // Nothing uploaded yet
+  }
+  bool found = prefs.isKey(CA_HASH_KEY);
+  *hash = prefs.getUInt(CA_HASH_KEY, 0);
+  prefs.end();
+  return found;
+}
+
+static void saveCaHash(uint32_t hash) {
+  Preferences prefs;
+  if (prefs.begin(MQTT_TLS_NVS_NAMESPACE, false)) {
+    prefs.putUInt(CA_HASH_KEY, hash);
+    prefs.end();
+  }
+}
+
+// "+CCERTLIST: "<file>"" - the modem still has it
+static bool caOnModem() {
+  return sendATCommand("AT+CCERTLIST", 2000).contains("\"" MQTT_TLS_CA_FILE "\"");
+}
+
+static bool uploadCa() {
+  size_t len = strlen(caCert);
+  AtBuffer<AT_CMD_MAX> cmd;
+  atCmdStart(cmd, AT_CMD_CCERTDOWN);
+  atCmdArgQuoted(cmd, MQTT_TLS_CA_FILE);
+  atCmdArg(cmd, len);
+
+  Serial.printf("Uploading CA certificate (%u bytes)...\n", (unsigned)len);
+  atFlushResponses();
+  Serial.printf(">> %s\n", cmd.c_str());
+  atWriteLine(cmd.c_str());
+  if (!atWaitPrompt(AT_CMD_CCERTDOWN)) {
+    Serial.println("✗ No '>' prompt for the CA certificate");
+    return false;
+  }
+  atWrite(caCert, len);
+  if (!atWaitOk(AT_CMD_CCERTDOWN, true)) {
+    Serial.println("✗ CA certificate upload failed");
+    return false;
+  }
+  Serial.println("✓ CA certificate stored in the modem");
+  return true;
+}
+
+// ===== SSL Context =====
+
+static bool sslCfg(const char* key, uint32_t value) {
+  AtBuffer<AT_CMD_MAX> cmd;
+  atCmdStart(cmd, AT_CMD_CSSLCFG);
+  atCmdArgQuoted(cmd, key);
+  atCmdArg(cmd, MQTT_TLS_SSL_CTX);
+  atCmdArg(cmd, value);
+  return sendATCommand(cmd.c_str(), atCommand(AT_CMD_CSSLCFG).timeoutMs).contains("OK");
+}
+
+static bool sslCfgFile(const char* key, const char* file) {
+  AtBuffer<AT_CMD_MAX> cmd;
+  atCmdStart(cmd, AT_CMD_CSSLCFG);
+  atCmdArgQuoted(cmd, key);
+  atCmdArg(cmd, MQTT_TLS_SSL_CTX);
+  atCmdArgQuoted(cmd, file);
+  return sendATCommand(cmd.c_str(), atCommand(AT_CMD_CSSLCFG).timeoutMs).contains("OK");
+}
+
+// ===== ModemTask =====
+
+bool mqttTlsPrepare() {
+  if (!mqttTlsInUse()) {
+    return true;
+  }
+  if (caCert == NULL) {
+    Serial.println("✗ TLS client configured without a CA certificate");
+    return false;
+  }
+
+  uint32_t hash = caHash();
+  uint32_t stored = 0;
+  if (loadCaHash(&stored) && stored == hash && caOnModem()) {
+    Serial.println("✓ CA certificate unchanged - not uploading");
+    portENTER_CRITICAL_SAFE(&tlsLock);
+    stats.caUploadsSkipped++;
+    portEXIT_CRITICAL_SAFE(&tlsLock);
+  } else {
+    if (!uploadCa()) {
+      return false;
+    }
+    saveCaHash(hash);
+    portENTER_CRITICAL_SAFE(&tlsLock);
+    stats.caUploads++;
+    portEXIT_CRITICAL_SAFE(&tlsLock);
+  }
+
+  // 3 = TLS 1.2, authmode 1 = verify the server against the CA
+  if (!sslCfg("sslversion", 3) || !sslCfg("authmode", 1) ||
+      !sslCfgFile("cacert", MQTT_TLS_CA_FILE)) {
+    Serial.println("✗ SSL context not accepted");
+    return false;
+  }
+  // Older firmware lacks these two - the handshake may still work
+  if (!sslCfg("ignorelocaltime", 1)) {
+    Serial.println("⚠ ignorelocaltime not supported - needs a valid modem clock");
+  }
+  if (!sslCfg("enableSNI", 1)) {
+    Serial.println("⚠ SNI not supported - brokers on shared hosts may refuse the handshake");
+  }
+  portENTER_CRITICAL_SAFE(&tlsLock);
+  stats.contextSetups++;
+  portEXIT_CRITICAL_SAFE(&tlsLock);
+  Serial.printf("✓ SSL context %u ready\n", (unsigned)MQTT_TLS_SSL_CTX);
+  return true;
+}
+
+bool mqttTlsBind(uint8_t client) {
+  AtBuffer<AT_CMD_MAX> cmd;
+  atCmdStart(cmd, AT_CMD_CMQTTSSLCFG);
+  atCmdArg(cmd, client);
+  atCmdArg(cmd, MQTT_TLS_SSL_CTX);
+  if (!sendATCommand(cmd.c_str(), atCommand(AT_CMD_CMQTTSSLCFG).timeoutMs).contains("OK")) {
+    Serial.printf("✗ MQTT client %u: SSL context not accepted\n", (unsigned)client);
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,69 @@
+#include "msg_pool.h"
+#include <freertos/FreeRTOS.h>
+
+static_assert(MSG_POOL_COUNT > 0 && MSG_POOL_COUNT <= 255,
+              "MSG_POOL_COUNT must fit the uint8_t pool index");
+static_assert(sizeof(PublishMsg) * MSG_POOL_COUNT <= MSG_POOL_BUDGET_BYTES,
+              "Message pool exceeds MSG_POOL_BUDGET_BYTES - lower MSG_POOL_COUNT or MSG_PAYLOAD_MAX");
+
+// ===== Slab and Free Stack =====
+static PublishMsg slab[MSG_POOL_COUNT];
+static uint8_t freeStack[MSG_POOL_COUNT];
+static uint16_t freeTop = 0;          // Number of entries on freeStack
+static bool initialized = false;
+static portMUX_TYPE poolLock = portMUX_INITIALIZER_UNLOCKED;
+
+static MsgPoolStats stats = { MSG_POOL_COUNT, 0, 0, 0, 0 };
+
+// Lazily fill the free stack so the pool works before setup() runs anything
+static void initLocked() {
+  for (uint16_t i = 0; i < MSG_POOL_COUNT; i++) {
+    slab[i].poolIndex = (uint8_t)i;
+    freeStack[i] = (uint8_t)(MSG_POOL_COUNT - 1 - i);
+  }
+  freeTop = MSG_POOL_COUNT;
+  initialized = true;
+}
+
+// ===== API =====
+
+PublishMsg* msgPoolAcquire() {
+  PublishMsg* msg = NULL;
+
+  portENTER_CRITICAL_SAFE(&poolLock);
+  if (!initialized) {
+    initLocked();
+  }
+  if (freeTop > 0) {
+    msg = &slab[freeStack[--freeTop]];
+    stats.inUse++;
+    stats.acquired++;
+    if (stats.inUse > stats.highWater) {
+      stats.highWater = stats.inUse;
+    }
+  } else {
+    stats.exhausted++;
+  }
+  portEXIT_CRITICAL_SAFE(&poolLock);
+
+  return msg;
+}
+
+void msgPoolRelease(PublishMsg* msg) {
+  if (msg == NULL) {
+    return;
+  }
+
+  portENTER_CRITICAL_SAFE(&poolLock);
+  if (freeTop < MSG_POOL_COUNT) {
+    freeStack[freeTop++] = msg->poolIndex;
+    stats.inUse--;
+  }
+  portEXIT_CRITICAL_SAFE(&poolLock);
+}
+
+void msgPoolGetStats(MsgPoolStats* out) {
+  portENTER_CRITICAL_SAFE(&poolLock);
+  *out = stats;
+  portEXIT_CRITICAL_SAFE(&poolLock);
+}
@@ -0,0 +1,434 @@
+#include "offline_store.h"
+#include "mqtt_publish.h"
+#include "conn_manager.h"
+#include <LittleFS.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+#define STORE_MAGIC       0xA5
+#define STORE_HEADER_LEN  8
+
+// ===== Global Variables =====
+static SemaphoreHandle_t xStoreMutex = NULL;
+static bool mounted = false;
+
+// Ring of segments [readSeg .. writeSeg]; the write segment is created on
+// the first append after boot
+static uint32_t readSeg = 1;
+static uint32_t readOffset = 0;
+static uint32_t writeSeg = 1;
+static File writeFile;
+static uint32_t writeSize = 0;
+static uint32_t peekLen = 0;  // Length of the record returned by storePeek()
+static bool peekFromRam = false;
+
+// PSRAM tier - always older than anything in flash (see offline_store.h)
+static PsramRing ramTier;
+
+static StoreStats stats = {};
+
+// ===== Helpers =====
+
+static void segPath(uint32_t seg, char* path, size_t size) {
+  snprintf(path, size, STORE_DIR "/%08lu.log", (unsigned long)seg);
+}
+
+static uint32_t segSize(uint32_t seg) {
+  char path[32];
+  segPath(seg, path, sizeof(path));
+  File f = LittleFS.open(path, "r");
+  if (!f) {
+    return 0;
+  }
+  uint32_t size = f.size();
+  f.close();
+  return size;
+}
+
+static uint16_t crc16(uint16_t crc, const uint8_t* data, size_t len) {
+  // CRC-16/CCITT-FALSE
+  for (size_t i = 0; i < len; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (int b = 0; b < 8; b++) {
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+  }
+  return crc;
+}
+
+// Record header for msg; returns the full record length
+static uint32_t encodeHeader(const PublishMsg* msg, uint8_t* header) {
+  size_t topicLen = strlen(msg->topic);
+  uint16_t crc = crc16(0xFFFF, (const uint8_t*)msg->topic, topicLen);
+  crc = crc16(crc, (const uint8_t*)msg->payload, msg->payloadLen);
+  header[0] = STORE_MAGIC;
+  header[1] = msg->client;
+  header[2] = msg->qos;
+  header[3] = (uint8_t)topicLen;
+  header[4] = (uint8_t)(msg->payloadLen & 0xFF);
+  header[5] = (uint8_t)(msg->payloadLen >> 8);
+  header[6] = (uint8_t)(crc & 0xFF);
+  header[7] = (uint8_t)(crc >> 8);
+  return STORE_HEADER_LEN + topicLen + msg->payloadLen;
+}
+
+static void saveCursorLocked() {
+  File f = LittleFS.open(STORE_DIR "/cursor", "w");
+  if (!f) {
+    return;
+  }
+  uint32_t cursor[2] = { readSeg, readOffset };
+  f.write((const uint8_t*)cursor, sizeof(cursor));
+  f.close();
+}
+
+// Delete the fully replayed (or overwritten) oldest segment
+static void dropReadSegmentLocked() {
+  char path[32];
+  segPath(readSeg, path, sizeof(path));
+  LittleFS.remove(path);
+  readSeg++;
+  readOffset = 0;
+  peekLen = 0;
+  saveCursorLocked();
+}
+
+static void subPendingLocked(uint32_t bytes) {
+  stats.pendingBytes = bytes < stats.pendingBytes ? stats.pendingBytes - bytes : 0;
+}
+
+static uint32_t segmentCountLocked() {
+  return writeSeg - readSeg + 1;
+}
+
+// ===== Lifecycle =====
+
+bool storeInit() {
+  if (xStoreMutex == NULL) {
+    xStoreMutex = xSemaphoreCreateMutex();
+  }
+  if (STORE_RAM_BYTES > 0 && psramRingInit(&ramTier, STORE_RAM_BYTES)) {
+    Serial.printf("✓ Offline store RAM tier: %lu KB in PSRAM\n",
+                  (unsigned long)(STORE_RAM_BYTES / 1024));
+  } else if (STORE_RAM_BYTES > 0) {
+    Serial.println("⚠ No PSRAM - offline store writes straight to flash");
+  }
+  if (!LittleFS.begin(true)) {  // Format on first use
+    Serial.println("⚠ LittleFS mount failed - offline store disabled");
+    return false;
+  }
+  if (!LittleFS.exists(STORE_DIR)) {
+    LittleFS.mkdir(STORE_DIR);
+  }
+
+  // Find the oldest and newest segment left from before the reset
+  uint32_t minSeg = UINT32_MAX;
+  uint32_t maxSeg = 0;
+  File dir = LittleFS.open(STORE_DIR);
+  for (File f = dir.openNextFile(); f; f = dir.openNextFile()) {
+    const char* name = strrchr(f.name(), '/');
+    name = name != NULL ? name + 1 : f.name();
+    char* end = NULL;
+    uint32_t seg = strtoul(name, &end, 10);
+    if (seg > 0 && end != NULL && strcmp(end, ".log") == 0) {
+      minSeg = seg < minSeg ? seg : minSeg;
+      maxSeg = seg > maxSeg ? seg : maxSeg;
+    }
+    f.close();
+  }
+  dir.close();
+
+  if (maxSeg == 0) {
+    readSeg = 1;
+    readOffset = 0;
+    writeSeg = 1;
+  } else {
+    readSeg = minSeg;
+    readOffset = 0;
+
+    File c = LittleFS.open(STORE_DIR "/cursor", "r");
+    uint32_t cursor[2];
+    if (c && c.read((uint8_t*)cursor, sizeof(cursor)) == sizeof(cursor) &&
+        cursor[0] >= minSeg && cursor[0] <= maxSeg) {
+      readSeg = cursor[0];
+      readOffset = cursor[1];
+    }
+    if (c) {
+      c.close();
+    }
+
+    // Never append behind a possibly torn record - start a new segment
+    writeSeg = maxSeg + 1;
+
+    for (uint32_t seg = readSeg; seg <= maxSeg; seg++) {
+      stats.pendingBytes += segSize(seg);
+    }
+    subPendingLocked(readOffset);
+  }
+
+  mounted = true;
+  Serial.printf("✓ Offline store mounted: %lu bytes waiting for replay\n",
+                (unsigned long)stats.pendingBytes);
+  return true;
+}
+
+// ===== Append =====
+
+bool storeAppend(const PublishMsg* msg) {
+  if (xStoreMutex == NULL) {
+    return false;
+  }
+  uint8_t header[STORE_HEADER_LEN];
+  uint32_t recLen = encodeHeader(msg, header);
+  size_t topicLen = header[3];
+
+  bool ok = false;
+  xSemaphoreTake(xStoreMutex, portMAX_DELAY);
+
+  // RAM first, but only while flash holds nothing older
+  if (stats.pendingBytes == 0) {
+    uint8_t* rec = psramRingReserve(&ramTier, recLen);
+    if (rec != NULL) {
+      memcpy(rec, header, STORE_HEADER_LEN);
+      memcpy(rec + STORE_HEADER_LEN, msg->topic, topicLen);
+      memcpy(rec + STORE_HEADER_LEN + topicLen, msg->payload, msg->payloadLen);
+      psramRingCommit(&ramTier, recLen);
+      stats.ramAppended++;
+      xSemaphoreGive(xStoreMutex);
+      return true;
+    }
+  }
+  if (!mounted) {
+    xSemaphoreGive(xStoreMutex);
+    return false;
+  }
+
+  // Segment full - continue in the next one
+  if (writeFile && writeSize + recLen > STORE_SEGMENT_BYTES) {
+    writeFile.close();
+    writeSeg++;
+  }
+
+  if (!writeFile) {
+    // Ring full - the oldest data makes room for the newest
+    while (segmentCountLocked() > STORE_MAX_SEGMENTS) {
+      uint32_t lost = segSize(readSeg);
+      subPendingLocked(lost > readOffset ? lost - readOffset : 0);
+      stats.lostSegments++;
+      Serial.println("⚠ Offline store full - oldest segment discarded");
+      dropReadSegmentLocked();
+    }
+    char path[32];
+    segPath(writeSeg, path, sizeof(path));
+    writeFile = LittleFS.open(path, "a");
+    writeSize = writeFile ? writeFile.size() : 0;
+  }
+
+  if (writeFile) {
+    ok = writeFile.write(header, sizeof(header)) == sizeof(header) &&
+         writeFile.write((const uint8_t*)msg->topic, topicLen) == topicLen &&
+         writeFile.write((const uint8_t*)msg->payload, msg->payloadLen) == msg->payloadLen;
+    writeFile.flush();  // Visible to the reader, survives a reset
+    writeSize += recLen;
+    if (ok) {
+      stats.appended++;
+      stats.pendingBytes += recLen;
+    } else {
+      // Partial record - seal this segment so nothing follows it
+      writeFile.close();
+      writeSeg++;
+    }
+  }
+
+  xSemaphoreGive(xStoreMutex);
+  return ok;
+}
+
+// ===== Replay =====
+
+// Oldest RAM record into msg - written by storeAppend(), so no CRC check
+static bool peekRamLocked(PublishMsg* msg) {
+  uint32_t len;
+  const uint8_t* rec = psramRingPeek(&ramTier, &len);
+  if (rec == NULL) {
+    return false;
+  }
+  uint8_t topicLen = rec[3];
+  uint16_t payloadLen = rec[4] | (rec[5] << 8);
+  memcpy(msg->topic, rec + STORE_HEADER_LEN, topicLen);
+  msg->topic[topicLen] = '\0';
+  memcpy(msg->payload, rec + STORE_HEADER_LEN + topicLen, payloadLen);
+  msg->payloadLen = payloadLen;
+  msg->client = rec[1];
+  msg->qos = rec[2];
+  return true;
+}
+
+bool storePeek(PublishMsg* msg) {
+  if (xStoreMutex == NULL) {
+    return false;
+  }
+
+  bool found = false;
+  xSemaphoreTake(xStoreMutex, portMAX_DELAY);
+
+  peekFromRam = peekRamLocked(msg);
+  found = peekFromRam;
+
+  while (!found && mounted) {
+    char path[32];
+    segPath(readSeg, path, sizeof(path));
+    File f = LittleFS.open(path, "r");
+    uint32_t size = f ? f.size() : 0;
+
+    if (readOffset >= size) {
+      if (f) {
+        f.close();
+      }
+      if (readSeg >= writeSeg) {
+        break;  // Caught up with the writer
+      }
+      dropReadSegmentLocked();  // Fully replayed
+      continue;
+    }
+
+    uint8_t header[STORE_HEADER_LEN] = {};
+    f.seek(readOffset);
+    bool valid = f.read(header, sizeof(header)) == sizeof(header) && header[0] == STORE_MAGIC;
+    uint8_t topicLen = header[3];
+    uint16_t payloadLen = header[4] | (header[5] << 8);
+    uint32_t recLen = STORE_HEADER_LEN + topicLen + payloadLen;
+    valid = valid && topicLen > 0 && topicLen <= MSG_TOPIC_MAX &&
+            payloadLen <= MSG_PAYLOAD_MAX && readOffset + recLen <= size;
+
+    if (valid) {
+      valid = f.read((uint8_t*)msg->topic, topicLen) == topicLen &&
+              f.read((uint8_t*)msg->payload, payloadLen) == payloadLen;
+      uint16_t crc = crc16(0xFFFF, (const uint8_t*)msg->topic, topicLen);
+      crc = crc16(crc, (const uint8_t*)msg->payload, payloadLen);
+      valid = valid && crc == (uint16_t)(header[6] | (header[7] << 8));
+    }
+    f.close();
+
+    if (!valid) {
+      // Torn or damaged - nothing after it in this segment can be trusted
+      stats.corrupt++;
+      subPendingLocked(size - readOffset);
+      Serial.printf("⚠ Offline store: bad record in segment %lu - skipping rest\n",
+                    (unsigned long)readSeg);
+      if (readSeg >= writeSeg) {
+        if (writeFile) {
+          writeFile.close();
+        }
+        writeSeg++;
+      }
+      dropReadSegmentLocked();
+      continue;
+    }
+
+    msg->topic[topicLen] = '\0';
+    msg->payloadLen = payloadLen;
+    msg->client = header[1];
+    msg->qos = header[2];
+    peekLen = recLen;
+    found = true;
+  }
+
+  xSemaphoreGive(xStoreMutex);
+  return found;
+}
+
+void storeConsume() {
+  xSemaphoreTake(xStoreMutex, portMAX_DELAY);
+  if (peekFromRam) {
+    psramRingPop(&ramTier);
+    peekFromRam = false;
+    stats.replayed++;
+    xSemaphoreGive(xStoreMutex);
+    return;
+  }
+  readOffset += peekLen;
+  subPendingLocked(peekLen);
+  if (peekLen > 0) {
+    stats.replayed++;
+  }
+  peekLen = 0;
+  xSemaphoreGive(xStoreMutex);
+}
+
+void storeSync() {
+  if (!mounted) {
+    return;
+  }
+  xSemaphoreTake(xStoreMutex, portMAX_DELAY);
+  saveCursorLocked();
+  xSemaphoreGive(xStoreMutex);
+}
+
+void storeGetStats(StoreStats* out) {
+  if (xStoreMutex == NULL) {
+    memset(out, 0, sizeof(*out));
+    return;
+  }
+  xSemaphoreTake(xStoreMutex, portMAX_DELAY);
+  *out = stats;
+  out->mounted = mounted;
+  out->segments = mounted ? segmentCountLocked() : 0;
+  PsramRingStats ram;
+  psramRingGetStats(&ramTier, &ram);
+  out->ramBytes = ram.used;
+  out->ramCapacity = ram.capacity;
+  out->ramRecords = ram.records;
+  xSemaphoreGive(xStoreMutex);
+}
+
+// ===== FreeRTOS Task =====
+
+/**
+ * @brief Store Replay Task - Feeds stored messages back into the publish queues
+ * @note Rate-limited and yields to live traffic (see offline_store.h)
+ */
+void vStoreReplayTask(void *pvParameters) {
+  Serial.println("💾 StoreReplayTask started");
+
+  while (1) {
+    vTaskDelay(pdMS_TO_TICKS(STORE_REPLAY_INTERVAL_MS));
+    if (!mqttConnected) {
+      continue;
+    }
+
+    uint8_t sent = 0;
+    while (sent < STORE_REPLAY_BATCH) {
+      PublishMsg* msg = msgPoolAcquire();
+      if (msg == NULL) {
+        break;  // Live producers need the buffers more
+      }
+      if (!storePeek(msg)) {
+        msgPoolRelease(msg);
+        break;
+      }
+
+      // Live messages first - only replay into an idle client
+      MqttPublishStats pub;
+      mqttPublishGetStats(msg->client, &pub);
+      if (!mqttClientIsConnected(msg->client) ||
+          pub.queued + pub.inFlight > STORE_REPLAY_MAX_BACKLOG) {
+        msgPoolRelease(msg);
+        break;
+      }
+
+      storeConsume();
+      mqttPublishSubmit(msg);  // Owns msg from here, even on failure
+      sent++;
+    }
+
+    if (sent > 0) {
+      storeSync();
+      StoreStats st;
+      storeGetStats(&st);
+      Serial.printf("💾 Replayed %u stored message(s), %lu bytes left (%lu in RAM)\n",
+                    (unsigned)sent, (unsigned long)(st.pendingBytes + st.ramBytes),
+                    (unsigned long)st.ramBytes);
+    }
+  }
+}
@@ -0,0 +1,143 @@
+#include "psram_ring.h"
+
+#define RING_HEADER_LEN  4
+#define RING_WRAP        0xFFFFFFFFu  // "Rest of the buffer unused - continue at 0"
+
+// Header + payload, rounded up so headers stay aligned
+static uint32_t recordSize(uint32_t len) {
+  return (RING_HEADER_LEN + len + PSRAM_RING_ALIGN - 1) & ~(uint32_t)(PSRAM_RING_ALIGN - 1);
+}
+
+// ===== Lifecycle =====
+
+bool psramRingInit(PsramRing* ring, size_t bytes, size_t fallbackBytes) {
+  memset(ring, 0, sizeof(*ring));
+  ring->lock = portMUX_INITIALIZER_UNLOCKED;
+
+  bytes &= ~(size_t)(PSRAM_RING_ALIGN - 1);
+  fallbackBytes &= ~(size_t)(PSRAM_RING_ALIGN - 1);
+
+  if (bytes > 0 && psramFound()) {
+    ring->buf = (uint8_t*)ps_malloc(bytes);
+    if (ring->buf != NULL) {
+      ring->size = bytes;
+      ring->stats.inPsram = true;
+    }
+  }
+  if (ring->buf == NULL && fallbackBytes > 0) {
+    ring->buf = (uint8_t*)malloc(fallbackBytes);
+    ring->size = ring->buf != NULL ? fallbackBytes : 0;
+  }
+  ring->stats.capacity = ring->size;
+  return ring->buf != NULL;
+}
+
+// ===== Producer =====
+
+uint8_t* psramRingReserve(PsramRing* ring, uint32_t maxLen) {
+  if (ring->buf == NULL) {
+    return NULL;
+  }
+  uint32_t need = recordSize(maxLen);
+
+  portENTER_CRITICAL_SAFE(&ring->lock);
+  uint32_t tail = ring->tail;
+  uint32_t used = ring->used;
+  portEXIT_CRITICAL_SAFE(&ring->lock);
+
+  uint32_t head = ring->head;
+  bool fits = false;
+  ring->resWaste = 0;
+
+  if (used < ring->size && head >= tail) {
+    // Free space is [head, size) and [0, tail)
+    if (need <= ring->size - head) {
+      ring->resAt = head;
+      fits = true;
+    } else if (need <= tail) {
+      ring->resAt = 0;
+      ring->resWaste = ring->size - head;
+      fits = true;
+    }
+  } else if (head < tail && need <= tail - head) {
+    ring->resAt = head;
+    fits = true;
+  }
+
+  if (!fits) {
+    ring->stats.rejected++;
+    return NULL;
+  }
+  return ring->buf + ring->resAt + RING_HEADER_LEN;
+}
+
+void psramRingCommit(PsramRing* ring, uint32_t len) {
+  if (ring->buf == NULL) {
+    return;
+  }
+  if (ring->resWaste > 0) {
+    *(uint32_t*)(ring->buf + ring->head) = RING_WRAP;
+  }
+  *(uint32_t*)(ring->buf + ring->resAt) = len;
+
+  uint32_t size = recordSize(len);
+  uint32_t head = ring->resAt + size;
+  ring->head = head == ring->size ? 0 : head;
+
+  // Publishes the record to the consumer
+  portENTER_CRITICAL_SAFE(&ring->lock);
+  ring->used += ring->resWaste + size;
+  ring->records++;
+  if (ring->used > ring->stats.highWater) {
+    ring->stats.highWater = ring->used;
+  }
+  ring->stats.pushed++;
+  portEXIT_CRITICAL_SAFE(&ring->lock);
+
+  ring->resWaste = 0;
+}
+
+// ===== Consumer =====
+
+const uint8_t* psramRingPeek(PsramRing* ring, uint32_t* len) {
+  if (ring->buf == NULL || ring->records == 0) {
+    return NULL;
+  }
+  uint32_t hdr = *(const uint32_t*)(ring->buf + ring->tail);
+  if (hdr == RING_WRAP) {
+    portENTER_CRITICAL_SAFE(&ring->lock);
+    ring->used -= ring->size - ring->tail;
+    ring->tail = 0;
+    portEXIT_CRITICAL_SAFE(&ring->lock);
+    hdr = *(const uint32_t*)ring->buf;
+  }
+  *len = hdr;
+  return ring->buf + ring->tail + RING_HEADER_LEN;
+}
+
+void psramRingPop(PsramRing* ring) {
+  uint32_t len;
+  if (psramRingPeek(ring, &len) == NULL) {
+    return;
+  }
+  uint32_t size = recordSize(len);
+  uint32_t tail = ring->tail + size;
+
+  portENTER_CRITICAL_SAFE(&ring->lock);
+  ring->tail = tail == ring->size ? 0 : tail;
+  ring->used -= size;
+  ring->records--;
+  portEXIT_CRITICAL_SAFE(&ring->lock);
+}
+
+bool psramRingEmpty(const PsramRing* ring) {
+  return ring->records == 0;
+}
+
+void psramRingGetStats(PsramRing* ring, PsramRingStats* out) {
+  portENTER_CRITICAL_SAFE(&ring->lock);
+  *out = ring->stats;
+  out->used = ring->used;
+  out->records = ring->records;
+  portEXIT_CRITICAL_SAFE(&ring->lock);
+}
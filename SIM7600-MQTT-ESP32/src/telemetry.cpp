@@ -0,0 +1,21 @@
+#include "telemetry.h"
+#include "cbor_writer.h"
+#include <stdio.h>
+
+size_t telemetryEncodeText(const TelemetryRecord& rec, char* out, size_t cap) {
+  int n = snprintf(out, cap, "Msg#%lu | Uptime:%lus",
+                   (unsigned long)rec.seq, (unsigned long)rec.uptimeS);
+  return (n > 0 && (size_t)n < cap) ? (size_t)n : 0;
+}
+
+size_t telemetryEncodeCbor(const TelemetryRecord& rec, uint8_t* out, size_t cap) {
+  // Schema v1: [version, seq, uptime_s, free_heap]
+  CborWriter w;
+  cborInit(&w, out, cap);
+  cborWriteArray(&w, 4);
+  cborWriteUint(&w, TELEMETRY_SCHEMA_VERSION);
+  cborWriteUint(&w, rec.seq);
+  cborWriteUint(&w, rec.uptimeS);
+  cborWriteUint(&w, rec.freeHeap);
+  return cborOk(&w) ? w.len : 0;
+}
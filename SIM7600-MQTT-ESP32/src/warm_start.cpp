@@ -0,0 +1,77 @@
+#include "warm_start.h"
+#include <Preferences.h>
+#include <esp_system.h>
+
+#define WARM_KEY  "rec"
+
+// ===== NVS =====
+
+bool warmLoad(WarmRecord* rec) {
+  Preferences prefs;
+  if (!prefs.begin(WARM_NVS_NAMESPACE, true)) {
+    return false;  // Namespace doesn't exist yet - first boot
+  }
+  bool ok = prefs.getBytesLength(WARM_KEY) == sizeof(WarmRecord) &&
+            prefs.getBytes(WARM_KEY, rec, sizeof(WarmRecord)) == sizeof(WarmRecord) &&
+            rec->version == WARM_VERSION;
+  prefs.end();
+  return ok;
+}
+
+bool warmStore(const WarmRecord* rec) {
+  WarmRecord stored;
+  if (warmLoad(&stored) && memcmp(&stored, rec, sizeof(WarmRecord)) == 0) {
+    return true;  // Unchanged - spare the flash
+  }
+
+  Preferences prefs;
+  if (!prefs.begin(WARM_NVS_NAMESPACE, false)) {
+    return false;
+  }
+  bool ok = prefs.putBytes(WARM_KEY, rec, sizeof(WarmRecord)) == sizeof(WarmRecord);
+  prefs.end();
+  return ok;
+}
+
+void warmClear() {
+  Preferences prefs;
+  if (prefs.begin(WARM_NVS_NAMESPACE, false)) {
+    prefs.remove(WARM_KEY);
+    prefs.end();
+  }
+}
+
+// ===== Hashing =====
+
+uint32_t warmHash(uint32_t h, const char* text) {
+  if (text != NULL) {
+    for (const char* p = text; *p != '\0'; p++) {
+      h = (h ^ (uint8_t)*p) * 16777619u;
+    }
+  }
+  return (h ^ 0xFF) * 16777619u;  // Terminator - "ab"+"c" differs from "a"+"bc"
+}
+
+uint32_t warmHash(uint32_t h, uint32_t value) {
+  for (int i = 0; i < 4; i++) {
+    h = (h ^ (uint8_t)(value >> (8 * i))) * 16777619u;
+  }
+  return h;
+}
+
+// ===== Reset Reason =====
+
+const char* warmResetReason() {
+  switch (esp_reset_reason()) {
+    case ESP_RST_POWERON:   return "power-on";
+    case ESP_RST_EXT:       return "external";
+    case ESP_RST_SW:        return "software";
+    case ESP_RST_PANIC:     return "panic";
+    case ESP_RST_INT_WDT:
+    case ESP_RST_TASK_WDT:
+    case ESP_RST_WDT:       return "watchdog";
+    case ESP_RST_DEEPSLEEP: return "deep sleep";
+    case ESP_RST_BROWNOUT:  return "brownout";
+    default:                return "unknown";
+  }
+}
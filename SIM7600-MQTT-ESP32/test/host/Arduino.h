@@ -0,0 +1,56 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* ===============================================================================
+ * HOST ARDUINO - The part of Arduino.h the AT engine and publish path use
+ * ===============================================================================
+ *
+ * Native tests only (test/README). millis() is the simulator's virtual
+ * clock (sim_port.h); Serial output is dropped unless Serial.echo is set.
+ * PSRAM is always "found" and comes from the host heap.
+ * =============================================================================== */
+
+uint32_t millis();
+uint32_t micros();
+
+inline bool psramFound() { return true; }
+inline void* ps_malloc(size_t size) { return malloc(size); }
+
+class HostSerial {
+public:
+  bool echo = false;
+
+  int printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+    if (!echo) {
+      return 0;
+    }
+    va_list args;
+    va_start(args, format);
+    int n = vprintf(format, args);
+    va_end(args);
+    return n;
+  }
+
+  void print(const char* text) {
+    if (echo) {
+      fputs(text, stdout);
+    }
+  }
+
+  void println(const char* text = "") {
+    if (echo) {
+      puts(text);
+    }
+  }
+};
+
+extern HostSerial Serial;
+
+#endif // HOST_ARDUINO_H
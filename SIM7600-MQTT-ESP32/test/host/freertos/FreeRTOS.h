@@ -0,0 +1,36 @@
+#ifndef HOST_FREERTOS_H
+#define HOST_FREERTOS_H
+
+#include <stdint.h>
+
+/* ===============================================================================
+ * HOST FREERTOS - Single-threaded stand-in for the native tests
+ * ===============================================================================
+ *
+ * One tick is one virtual millisecond. Nothing runs concurrently, so the
+ * critical sections are empty; a blocking call lets time pass through
+ * hostWait(), which the test port (sim_port.h) implements by advancing the
+ * simulator and draining its bytes into the AT engine.
+ * =============================================================================== */
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define pdTRUE                1
+#define pdFALSE               0
+#define pdPASS                pdTRUE
+#define portMAX_DELAY         ((TickType_t)0xffffffffUL)
+#define pdMS_TO_TICKS(ms)     ((TickType_t)(ms))
+#define portNUM_PROCESSORS    2
+
+struct portMUX_TYPE {
+  int unused;
+};
+#define portMUX_INITIALIZER_UNLOCKED  { 0 }
+#define portENTER_CRITICAL_SAFE(mux)  ((void)(mux))
+#define portEXIT_CRITICAL_SAFE(mux)   ((void)(mux))
+
+void hostWait(TickType_t ticks);  // Let ticks of virtual time pass
+
+#endif // HOST_FREERTOS_H
@@ -0,0 +1,71 @@
+#ifndef HOST_FREERTOS_QUEUE_H
+#define HOST_FREERTOS_QUEUE_H
+
+#include <string.h>
+#include <deque>
+#include <string>
+#include "FreeRTOS.h"
+
+// Bounded FIFO of fixed-size items, like the real one. A receive that has
+// to wait advances virtual time one tick at a time until an item arrives.
+struct HostQueue {
+  size_t length;
+  size_t itemSize;
+  std::deque<std::string> items;
+};
+typedef HostQueue* QueueHandle_t;
+
+inline QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+  HostQueue* q = new HostQueue();
+  q->length = length;
+  q->itemSize = itemSize;
+  return q;
+}
+
+inline void vQueueDelete(QueueHandle_t q) { delete q; }
+
+inline BaseType_t hostQueuePut(QueueHandle_t q, const void* item, bool front) {
+  if (q->items.size() >= q->length) {
+    return pdFALSE;
+  }
+  std::string bytes((const char*)item, q->itemSize);
+  if (front) {
+    q->items.push_front(bytes);
+  } else {
+    q->items.push_back(bytes);
+  }
+  return pdTRUE;
+}
+
+inline BaseType_t xQueueSend(QueueHandle_t q, const void* item, TickType_t wait) {
+  (void)wait;  // Nobody else could make room meanwhile
+  return hostQueuePut(q, item, false);
+}
+
+inline BaseType_t xQueueSendToFront(QueueHandle_t q, const void* item, TickType_t wait) {
+  (void)wait;
+  return hostQueuePut(q, item, true);
+}
+
+inline BaseType_t xQueueReceive(QueueHandle_t q, void* item, TickType_t wait) {
+  for (TickType_t waited = 0; q->items.empty(); waited++) {
+    if (waited >= wait) {
+      return pdFALSE;
+    }
+    hostWait(1);
+  }
+  memcpy(item, q->items.front().data(), q->itemSize);
+  q->items.pop_front();
+  return pdTRUE;
+}
+
+inline UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q) {
+  return (UBaseType_t)q->items.size();
+}
+
+inline BaseType_t xQueueReset(QueueHandle_t q) {
+  q->items.clear();
+  return pdPASS;
+}
+
+#endif // HOST_FREERTOS_QUEUE_H
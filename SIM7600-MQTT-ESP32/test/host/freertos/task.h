@@ -0,0 +1,18 @@
+#ifndef HOST_FREERTOS_TASK_H
+#define HOST_FREERTOS_TASK_H
+
+#include "FreeRTOS.h"
+
+// No scheduler on the host: tests call task bodies step by step instead
+typedef void* TaskHandle_t;
+
+inline void vTaskDelay(TickType_t ticks) { hostWait(ticks); }
+inline void vTaskDelete(TaskHandle_t task) { (void)task; }
+inline void xTaskNotifyGive(TaskHandle_t task) { (void)task; }
+inline uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t wait) {
+  (void)clear;
+  hostWait(wait);
+  return 0;
+}
+
+#endif // HOST_FREERTOS_TASK_H
@@ -0,0 +1,69 @@
+#ifndef SIM_PORT_H
+#define SIM_PORT_H
+
+#include <Arduino.h>
+#include <string>
+#include "at_engine.h"
+#include "sim7600_sim.h"
+
+/* ===============================================================================
+ * SIM PORT - at_uart.h on top of the SIM7600 simulator
+ * ===============================================================================
+ *
+ * What the ESP-IDF driver and UartReaderTask do on the board, done on the
+ * simulator's virtual clock: every tick of hostWait() advances the sim by
+ * 1 ms, takes one chunk of its due bytes into the RX buffer and drains it
+ * into the AT engine. Bytes the engine writes go to Sim7600Sim::receive().
+ *
+ * Defines the host globals (Serial, millis, hostWait) - include it from
+ * exactly one file per test, after the sources under test.
+ * =============================================================================== */
+
+HostSerial Serial;
+
+static Sim7600Sim* portSim = NULL;
+static std::string portRx;  // Received, not read by the engine yet
+
+static void simPortAttach(Sim7600Sim* sim) {
+  portSim = sim;
+  portRx.clear();
+}
+
+uint32_t millis() {
+  return portSim != NULL ? portSim->millis() : 0;
+}
+
+uint32_t micros() {
+  return millis() * 1000;
+}
+
+void hostWait(TickType_t ticks) {
+  for (TickType_t i = 0; i < ticks && portSim != NULL; i++) {
+    portSim->advance(1);
+    uint8_t chunk[256];
+    size_t got = portSim->read(chunk, sizeof(chunk));
+    portRx.append((const char*)chunk, got);
+    atEngineDrain();
+  }
+}
+
+// ===== Port =====
+
+size_t atPortBuffered() {
+  return portRx.size();
+}
+
+size_t atPortRead(uint8_t* dst, size_t len) {
+  size_t n = len < portRx.size() ? len : portRx.size();
+  memcpy(dst, portRx.data(), n);
+  portRx.erase(0, n);
+  return n;
+}
+
+void atPortWrite(const uint8_t* data, size_t len) {
+  if (portSim != NULL) {
+    portSim->receive(data, len);
+  }
+}
+
+#endif // SIM_PORT_H
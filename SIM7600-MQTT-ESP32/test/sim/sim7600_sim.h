@@ -0,0 +1,312 @@
+#ifndef SIM7600_SIM_H
+#define SIM7600_SIM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+/* ===============================================================================
+ * SIM7600 SIMULATOR - Scripted modem for the native tests
+ * ===============================================================================
+ *
+ * Stands in for the UART side of the modem on the host:
+ *
+ *   - Rules: a command starting with a prefix is answered with a script
+ *     ("OK", "+CSQ: 20,99\r\n\r\nOK" ...) after a latency in virtual ms
+ *   - Result rules add a second answer later (OK now, +CMQTTPUB: 0,0 after
+ *     the broker round trip); prompt rules send '>', read as many bytes as
+ *     the command's last number says, then answer OK - or ERROR when they
+ *     don't arrive within inputTimeoutMs
+ *   - Requirements make a command fail unless another one came first
+ *   - URCs and complete +CMQTTRX* messages can be queued at any time
+ *   - Every output can be lost with a given probability (per mille), and
+ *     loseNext() loses one chosen output
+ *   - read() hands out the bytes that are due in chunks of random size
+ *     (minChunk..maxChunk), the way the UART driver splits them
+ *
+ * Commands arrive either whole through write() or byte by byte through
+ * receive(), which is what the engine's UART port (test/host/sim_port.h)
+ * calls. The clock only moves with advance(), and all randomness comes from
+ * one seeded generator, so every run of a test sees the same byte stream.
+ * =============================================================================== */
+
+class Sim7600Sim {
+public:
+  explicit Sim7600Sim(uint32_t seed = 1) : rng(seed ? seed : 1) {}
+
+  // ===== Script =====
+
+  // Commands starting with prefix get "\r\n<response>\r\n" after latencyMs
+  void addRule(const char* prefix, const char* response, uint32_t latencyMs) {
+    Rule r = { prefix, response, latencyMs, "", 0, false, false };
+    rules.push_back(r);
+  }
+
+  // As addRule, then "\r\n<result>\r\n" resultMs after the response
+  void addResultRule(const char* prefix, const char* response, uint32_t latencyMs,
+                     const char* result, uint32_t resultMs) {
+    Rule r = { prefix, response, latencyMs, result, resultMs, true, false };
+    rules.push_back(r);
+  }
+
+  // "\r\n> " after promptMs, <n> input bytes (last number of the command),
+  // then "\r\nOK\r\n" after okMs
+  void addPromptRule(const char* prefix, uint32_t promptMs, uint32_t okMs) {
+    Rule r = { prefix, ">", promptMs, "", okMs, false, true };
+    rules.push_back(r);
+  }
+
+  void clearRules() { rules.clear(); }
+
+  // Commands starting with prefix fail with "\r\n<failure>\r\n" unless a
+  // command starting with needed came since they last succeeded - e.g. a
+  // firmware that forgets the publish topic after every AT+CMQTTPUB
+  void requireSince(const char* prefix, const char* needed, const char* failure) {
+    Requirement r = { prefix, needed, failure, false };
+    requirements.push_back(r);
+  }
+
+  void setChunk(size_t minBytes, size_t maxBytes) {
+    minChunk = minBytes > 0 ? minBytes : 1;
+    maxChunk = maxBytes >= minChunk ? maxBytes : minChunk;
+  }
+
+  void setDropPerMille(uint16_t perMille) { dropPerMille = perMille; }
+
+  // The next output containing text is lost
+  void loseNext(const char* text) { loseText = text; }
+
+  uint32_t inputTimeoutMs = 500;  // Prompted bytes must arrive within this
+
+  // ===== Modem Side =====
+
+  // Same as the ESP32 writing "AT...\r" to the UART; false if no rule matched
+  bool write(const char* command) {
+    commands.push_back(command);
+    for (size_t i = 0; i < requirements.size(); i++) {
+      Requirement& q = requirements[i];
+      if (strncmp(command, q.needed.c_str(), q.needed.size()) == 0) {
+        q.seen = true;
+      } else if (strncmp(command, q.prefix.c_str(), q.prefix.size()) == 0) {
+        if (!q.seen) {
+          emit(now, "\r\n" + q.failure + "\r\n");
+          return true;
+        }
+        q.seen = false;
+      }
+    }
+    for (size_t i = 0; i < rules.size(); i++) {
+      const Rule& r = rules[i];
+      if (strncmp(command, r.prefix.c_str(), r.prefix.size()) != 0) {
+        continue;
+      }
+      if (r.prompt) {
+        const char* last = strrchr(command, ',');
+        if (last == NULL) {
+          last = strchr(command, '=');
+        }
+        inputLeft = last != NULL ? strtoul(last + 1, NULL, 10) : 0;
+        inputOkMs = r.resultMs;
+        inputDeadline = now + r.latencyMs + inputTimeoutMs;
+        inputActive = true;
+        emit(now + r.latencyMs, "\r\n> ");
+        return true;
+      }
+      emit(now + r.latencyMs, "\r\n" + r.response + "\r\n");
+      if (r.hasResult) {
+        emit(now + r.latencyMs + r.resultMs, "\r\n" + r.result + "\r\n");
+      }
+      return true;
+    }
+    emit(now, "\r\nERROR\r\n");
+    return false;
+  }
+
+  // Bytes as they leave the ESP32 UART: commands end at '\r' (a '\n'
+  // right after it is ignored), prompted input is counted off by length
+  void receive(const uint8_t* data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+      char c = (char)data[i];
+      bool lf = c == '\n' && afterCr;
+      afterCr = c == '\r' && !inputActive;
+      if (lf) {
+        continue;  // Rest of the "\r\n" the command ended with - not input
+      }
+      if (inputActive) {
+        input += c;
+        if (--inputLeft == 0) {
+          inputActive = false;
+          inputs.push_back(input);
+          input.clear();
+          emit(now + inputOkMs, "\r\nOK\r\n");
+        }
+      } else if (c == '\r') {
+        write(line.c_str());
+        line.clear();
+      } else {
+        line += c;
+      }
+    }
+  }
+
+  // Commands seen so far that start with prefix
+  size_t count(const char* prefix) const {
+    size_t n = 0;
+    for (size_t i = 0; i < commands.size(); i++) {
+      n += strncmp(commands[i].c_str(), prefix, strlen(prefix)) == 0;
+    }
+    return n;
+  }
+
+  void injectUrc(const char* text, uint32_t delayMs = 0) {
+    emit(now + delayMs, std::string("\r\n") + text + "\r\n");
+  }
+
+  // Bytes exactly as given - e.g. one line sent in two bursts
+  void injectRaw(const char* bytes, uint32_t delayMs = 0) {
+    emit(now + delayMs, bytes);
+  }
+
+  // Whole received publish as the SIM7600 sends it, binary payload allowed
+  void injectMessage(uint8_t client, const char* topic, const uint8_t* payload,
+                     size_t payloadLen, uint32_t delayMs = 0) {
+    char line[96];
+    size_t topicLen = strlen(topic);
+    std::string out;
+    snprintf(line, sizeof(line), "\r\n+CMQTTRXSTART: %u,%u,%u\r\n",
+             client, (unsigned)topicLen, (unsigned)payloadLen);
+    out += line;
+    snprintf(line, sizeof(line), "+CMQTTRXTOPIC: %u,%u\r\n", client, (unsigned)topicLen);
+    out += line;
+    out.append(topic, topicLen);
+    snprintf(line, sizeof(line), "\r\n+CMQTTRXPAYLOAD: %u,%u\r\n", client, (unsigned)payloadLen);
+    out += line;
+    out.append((const char*)payload, payloadLen);
+    snprintf(line, sizeof(line), "\r\n+CMQTTRXEND: %u\r\n", client);
+    out += line;
+    emit(now + delayMs, out);
+  }
+
+  // ===== ESP32 Side =====
+
+  void advance(uint32_t ms) {
+    now += ms;
+    // Prompted bytes never came - the modem gives up on the command
+    if (inputActive && now >= inputDeadline) {
+      inputActive = false;
+      input.clear();
+      emit(now, "\r\nERROR\r\n");
+    }
+  }
+  uint32_t millis() const { return now; }
+
+  // Bytes due now, at most one random-sized chunk; 0 when nothing is due
+  size_t read(uint8_t* dst, size_t cap) {
+    size_t due = 0;
+    while (due < pending.size() && pending[due].atMs <= now) {
+      due++;
+    }
+    if (due == 0) {
+      return 0;
+    }
+    size_t n = minChunk + (maxChunk > minChunk ? next() % (maxChunk - minChunk + 1) : 0);
+    n = n < cap ? n : cap;
+    size_t got = 0;
+    while (got < n && !pending.empty() && pending[0].atMs <= now) {
+      Output& o = pending[0];
+      size_t take = o.bytes.size() - o.sent;
+      take = take < n - got ? take : n - got;
+      memcpy(dst + got, o.bytes.data() + o.sent, take);
+      o.sent += take;
+      got += take;
+      if (o.sent == o.bytes.size()) {
+        pending.erase(pending.begin());
+      }
+    }
+    return got;
+  }
+
+  bool idle() const { return pending.empty(); }
+
+  uint32_t emitted = 0;   // Outputs scheduled
+  uint32_t lost = 0;      // Outputs dropped by dropPerMille / loseNext()
+  std::vector<std::string> commands;  // Every command received, without '\r'
+  std::vector<std::string> inputs;    // Every block of prompted input bytes
+
+private:
+  struct Rule {
+    std::string prefix;
+    std::string response;
+    uint32_t latencyMs;
+    std::string result;
+    uint32_t resultMs;  // After the response; prompt rules: input → OK
+    bool hasResult;
+    bool prompt;
+  };
+
+  struct Requirement {
+    std::string prefix;
+    std::string needed;
+    std::string failure;
+    bool seen;
+  };
+
+  struct Output {
+    uint32_t atMs;
+    std::string bytes;
+    size_t sent;
+  };
+
+  // Keep outputs ordered by due time; equal times stay in emit order
+  void emit(uint32_t atMs, const std::string& bytes) {
+    emitted++;
+    if (!loseText.empty() && bytes.find(loseText) != std::string::npos) {
+      loseText.clear();
+      lost++;
+      return;
+    }
+    if (dropPerMille > 0 && next() % 1000 < dropPerMille) {
+      lost++;
+      return;
+    }
+    Output o = { atMs, bytes, 0 };
+    size_t i = pending.size();
+    while (i > 0 && pending[i - 1].atMs > atMs && pending[i - 1].sent == 0) {
+      i--;
+    }
+    pending.insert(pending.begin() + i, o);
+  }
+
+  // xorshift32
+  uint32_t next() {
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+  }
+
+  std::vector<Rule> rules;
+  std::vector<Requirement> requirements;
+  std::vector<Output> pending;
+  uint32_t now = 0;
+  uint32_t rng;
+  size_t minChunk = 1;
+  size_t maxChunk = 64;
+  uint16_t dropPerMille = 0;
+  std::string loseText;
+
+  // Modem side
+  std::string line;
+  std::string input;
+  bool afterCr = false;
+  bool inputActive = false;
+  size_t inputLeft = 0;
+  uint32_t inputOkMs = 0;
+  uint32_t inputDeadline = 0;
+};
+
+#endif // SIM7600_SIM_H
@@ -0,0 +1,395 @@
+#include <unity.h>
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "at_commands.h"
+#include "at_parser.h"
+#include "sim7600_sim.h"
+
+/* ===============================================================================
+ * AT PARSER TESTS - pio test -e native
+ * ===============================================================================
+ *
+ * The sink below mirrors the one in at_engine.cpp: a small ring of line
+ * buffers (acquire) and an inbox that collects topic / payload bytes.
+ * =============================================================================== */
+
+// ===== Test Sink =====
+
+#define TEST_SLOTS  8
+
+struct Line {
+  std::string text;
+  AtLineKind kind;
+  uint8_t client;
+};
+
+struct Capture {
+  char slots[TEST_SLOTS][AT_LINE_MAX + 1];
+  bool busy[TEST_SLOTS];
+  bool release;                 // Free each slot once its line is recorded
+  std::vector<Line> lines;
+
+  std::string topic;
+  std::string payload;
+  uint8_t rxClient;
+  uint32_t rxBegun, rxEnded, rxAborted;
+  size_t rxRoom;                // Inbox room per write, 0 = all of scratch
+  uint8_t scratch[512];         // Written by the parser, appended on advance
+};
+
+static char* capAcquire(void* ctx) {
+  Capture* c = (Capture*)ctx;
+  for (int i = 0; i < TEST_SLOTS; i++) {
+    if (!c->busy[i]) {
+      c->busy[i] = true;
+      return c->slots[i];
+    }
+  }
+  return NULL;
+}
+
+static void capLine(void* ctx, char* text, uint16_t len, AtLineKind kind, uint8_t client) {
+  Capture* c = (Capture*)ctx;
+  Line line = { std::string(text, len), kind, client };
+  c->lines.push_back(line);
+  if (c->release) {
+    c->busy[(text - c->slots[0]) / (AT_LINE_MAX + 1)] = false;
+  }
+}
+
+static void capRxBegin(void* ctx, uint8_t client, uint16_t, uint32_t) {
+  Capture* c = (Capture*)ctx;
+  c->rxBegun++;
+  c->rxClient = client;
+  c->topic.clear();
+  c->payload.clear();
+}
+
+static uint8_t* capRxWritePtr(void* ctx, AtRawPart, size_t* room) {
+  Capture* c = (Capture*)ctx;
+  *room = c->rxRoom > 0 ? c->rxRoom : sizeof(c->scratch);
+  return c->scratch;
+}
+
+static void capRxAdvance(void* ctx, AtRawPart part, size_t n) {
+  Capture* c = (Capture*)ctx;
+  (part == AT_RAW_TOPIC ? c->topic : c->payload).append((const char*)c->scratch, n);
+}
+
+static void capRxEnd(void* ctx) {
+  ((Capture*)ctx)->rxEnded++;
+}
+
+static void capRxAbort(void* ctx) {
+  ((Capture*)ctx)->rxAborted++;
+}
+
+static Capture cap;
+static AtParser parser;
+
+void setUp() {
+  memset(cap.slots, 0, sizeof(cap.slots));
+  memset(cap.busy, 0, sizeof(cap.busy));
+  cap.release = true;
+  cap.lines.clear();
+  cap.topic.clear();
+  cap.payload.clear();
+  cap.rxClient = 0;
+  cap.rxBegun = cap.rxEnded = cap.rxAborted = 0;
+  cap.rxRoom = 0;
+
+  const AtParserSink sink = {
+    &cap, capAcquire, capLine,
+    capRxBegin, capRxWritePtr, capRxAdvance, capRxEnd, capRxAbort,
+  };
+  atParserInit(&parser, &sink);
+}
+
+void tearDown() {}
+
+static void feed(const char* text) {
+  atParserFeed(&parser, (const uint8_t*)text, strlen(text));
+}
+
+// Everything the simulator has due, in its chunk sizes
+static void pump(Sim7600Sim& sim) {
+  uint8_t chunk[256];
+  size_t got;
+  while ((got = sim.read(chunk, sizeof(chunk))) > 0) {
+    atParserFeed(&parser, chunk, got);
+  }
+}
+
+// ===== Classification =====
+
+void test_final_results() {
+  TEST_ASSERT_TRUE(atIsFinalResult("OK"));
+  TEST_ASSERT_TRUE(atIsFinalResult("ERROR"));
+  TEST_ASSERT_TRUE(atIsFinalResult("+CME ERROR: 10"));
+  TEST_ASSERT_TRUE(atIsFinalResult("+CMS ERROR: 500"));
+  TEST_ASSERT_FALSE(atIsFinalResult("OKAY"));
+  TEST_ASSERT_FALSE(atIsFinalResult("+CSQ: 20,99"));
+}
+
+void test_response_lines() {
+  feed("\r\n+CSQ: 20,99\r\n\r\nOK\r\n");
+  TEST_ASSERT_EQUAL(2, cap.lines.size());
+  TEST_ASSERT_EQUAL_STRING("+CSQ: 20,99", cap.lines[0].text.c_str());
+  TEST_ASSERT_EQUAL(AT_LINE_RESPONSE, cap.lines[0].kind);
+  TEST_ASSERT_EQUAL_STRING("OK", cap.lines[1].text.c_str());
+  TEST_ASSERT_EQUAL(2, parser.lines);
+}
+
+void test_prompt_without_newline() {
+  feed("\r\n> ");
+  TEST_ASSERT_EQUAL(1, cap.lines.size());
+  TEST_ASSERT_EQUAL_STRING(">", cap.lines[0].text.c_str());
+  TEST_ASSERT_EQUAL(AT_LINE_RESPONSE, cap.lines[0].kind);
+
+  feed("\r\nOK\r\n");  // The space after '>' is not the start of a line
+  TEST_ASSERT_EQUAL(2, cap.lines.size());
+  TEST_ASSERT_EQUAL_STRING("OK", cap.lines[1].text.c_str());
+}
+
+void test_urc_lines() {
+  feed("\r\n+CMQTTCONNLOST: 0,1\r\n\r\n+CMQTTNONET\r\n");
+  TEST_ASSERT_EQUAL(2, cap.lines.size());
+  TEST_ASSERT_EQUAL(AT_LINE_URC, cap.lines[0].kind);
+  TEST_ASSERT_EQUAL(AT_LINE_URC, cap.lines[1].kind);
+  TEST_ASSERT_TRUE(atIsUrc("+CMQTTRXSTART: 0,4,2"));
+  TEST_ASSERT_FALSE(atIsUrc("+CMQTTPUB: 0,0"));
+}
+
+void test_puback_per_client() {
+  feed("\r\n+CMQTTPUB: 1,0\r\n\r\n+CMQTTPUB: 0,11\r\n\r\n+CMQTTPUB: 7,0\r\n");
+  TEST_ASSERT_EQUAL(3, cap.lines.size());
+  TEST_ASSERT_EQUAL(AT_LINE_PUBACK, cap.lines[0].kind);
+  TEST_ASSERT_EQUAL(1, cap.lines[0].client);
+  TEST_ASSERT_EQUAL(AT_LINE_PUBACK, cap.lines[1].kind);
+  TEST_ASSERT_EQUAL(0, cap.lines[1].client);
+  TEST_ASSERT_EQUAL(AT_LINE_RESPONSE, cap.lines[2].kind);  // No such client
+}
+
+// The error code may arrive after a pause: nothing is delivered before the
+// CRLF, so "+CMQTTPUB: 0," is never read as a result on its own
+void test_puback_split_before_error() {
+  feed("\r\n+CMQTTPUB: 0,");
+  TEST_ASSERT_EQUAL(0, cap.lines.size());
+  feed("11\r\n");
+  TEST_ASSERT_EQUAL(1, cap.lines.size());
+  TEST_ASSERT_EQUAL(AT_LINE_PUBACK, cap.lines[0].kind);
+
+  int client = -1;
+  int err = -1;
+  TEST_ASSERT_TRUE(atParseResult(AT_CMD_CMQTTPUB, cap.lines[0].text.c_str(), &client, &err));
+  TEST_ASSERT_EQUAL(0, client);
+  TEST_ASSERT_EQUAL(11, err);
+}
+
+// ===== Received Messages =====
+
+// Payload with CR, LF, NUL and '>' must arrive byte for byte
+static const uint8_t BINARY[] = { 'a', '\r', '\n', 0x00, '>', ' ', 0xFF, '\n', 'z' };
+
+static void expectMessage(const char* topic) {
+  TEST_ASSERT_EQUAL(1, cap.rxBegun);
+  TEST_ASSERT_EQUAL(1, cap.rxEnded);
+  TEST_ASSERT_EQUAL(0, cap.rxAborted);
+  TEST_ASSERT_EQUAL(strlen(topic), cap.topic.size());
+  TEST_ASSERT_EQUAL_MEMORY(topic, cap.topic.data(), cap.topic.size());
+  TEST_ASSERT_EQUAL(sizeof(BINARY), cap.payload.size());
+  TEST_ASSERT_EQUAL_MEMORY(BINARY, cap.payload.data(), sizeof(BINARY));
+  for (size_t i = 0; i < cap.lines.size(); i++) {
+    TEST_ASSERT_EQUAL(AT_LINE_URC, cap.lines[i].kind);
+  }
+}
+
+void test_rx_message_every_split() {
+  Sim7600Sim ref;
+  ref.setChunk(4096, 4096);
+  ref.injectMessage(1, "test/sim7600/do1", BINARY, sizeof(BINARY));
+  uint8_t stream[512];
+  size_t total = ref.read(stream, sizeof(stream));
+
+  for (size_t split = 1; split < total; split++) {
+    setUp();
+    atParserFeed(&parser, stream, split);
+    atParserFeed(&parser, stream + split, total - split);
+    expectMessage("test/sim7600/do1");
+    TEST_ASSERT_EQUAL(1, cap.rxClient);
+  }
+}
+
+void test_rx_message_random_chunks() {
+  for (uint32_t seed = 1; seed <= 50; seed++) {
+    setUp();
+    Sim7600Sim sim(seed);
+    sim.setChunk(1, 17);
+    sim.injectMessage(0, "t", BINARY, sizeof(BINARY));
+    pump(sim);
+    expectMessage("t");
+  }
+}
+
+void test_rx_message_inbox_room() {
+  cap.rxRoom = 2;  // Inbox hands out the space in small pieces
+  Sim7600Sim sim;
+  sim.setChunk(64, 64);
+  sim.injectMessage(0, "abc", BINARY, sizeof(BINARY));
+  pump(sim);
+  expectMessage("abc");
+}
+
+void test_raw_read_path() {
+  // The engine reads raw bytes from the driver itself once they are expected
+  feed("\r\n+CMQTTRXSTART: 0,3,2\r\n+CMQTTRXTOPIC: 0,3\r\n");
+  size_t room = 0;
+  uint8_t* dst = atParserRawWritePtr(&parser, &room);
+  TEST_ASSERT_NOT_NULL(dst);
+  TEST_ASSERT_EQUAL(3, room);  // Capped at what is still expected
+  memcpy(dst, "a/b", 3);
+  atParserRawAdvance(&parser, 3);
+  TEST_ASSERT_NULL(atParserRawWritePtr(&parser, &room));
+
+  feed("\r\n+CMQTTRXPAYLOAD: 0,2\r\nhi\r\n+CMQTTRXEND: 0\r\n");
+  TEST_ASSERT_EQUAL_STRING("a/b", cap.topic.c_str());
+  TEST_ASSERT_EQUAL_STRING("hi", cap.payload.c_str());
+  TEST_ASSERT_EQUAL(1, cap.rxEnded);
+}
+
+void test_reset_mid_message() {
+  feed("\r\n+CMQTTRXSTART: 0,3,100\r\n+CMQTTRXTOPIC: 0,3\r\nabc\r\n+CMQTTRXPAYLOAD: 0,100\r\nxx");
+  atParserReset(&parser);
+  TEST_ASSERT_EQUAL(1, cap.rxAborted);
+  TEST_ASSERT_EQUAL(0, cap.rxEnded);
+
+  // Back to line mode right away
+  feed("\r\nOK\r\n");
+  TEST_ASSERT_EQUAL_STRING("OK", cap.lines.back().text.c_str());
+  TEST_ASSERT_EQUAL(AT_LINE_RESPONSE, cap.lines.back().kind);
+}
+
+// ===== Limits =====
+
+void test_long_line_split() {
+  std::string text(AT_LINE_MAX + 10, 'x');
+  feed(("\r\n" + text + "\r\n").c_str());
+  TEST_ASSERT_EQUAL(2, cap.lines.size());
+  TEST_ASSERT_EQUAL(AT_LINE_MAX, cap.lines[0].text.size());
+  TEST_ASSERT_EQUAL(10, cap.lines[1].text.size());
+}
+
+void test_no_buffer_drops_line() {
+  cap.release = false;  // Consumers hold every slot
+  for (int i = 0; i < TEST_SLOTS + 3; i++) {
+    feed("\r\n+CSQ: 20,99\r\n");
+  }
+  TEST_ASSERT_EQUAL(TEST_SLOTS, cap.lines.size());
+  TEST_ASSERT_EQUAL(3, parser.dropped);
+
+  // A released slot is used again, and the dropped line did not leak into it
+  cap.busy[0] = false;
+  feed("\r\nOK\r\n");
+  TEST_ASSERT_EQUAL_STRING("OK", cap.lines.back().text.c_str());
+}
+
+// ===== Simulator =====
+
+void test_sim_latency_and_urcs() {
+  Sim7600Sim sim(7);
+  sim.setChunk(1, 8);
+  sim.addRule("AT+CSQ", "+CSQ: 20,99\r\n\r\nOK", 50);
+  sim.write("AT+CSQ\r");
+  sim.injectUrc("+CMQTTCONNLOST: 0,1", 20);
+
+  pump(sim);
+  TEST_ASSERT_EQUAL(0, cap.lines.size());  // Nothing due yet
+
+  sim.advance(20);
+  pump(sim);
+  TEST_ASSERT_EQUAL(1, cap.lines.size());
+  TEST_ASSERT_EQUAL(AT_LINE_URC, cap.lines[0].kind);
+
+  sim.advance(30);
+  pump(sim);
+  TEST_ASSERT_EQUAL(3, cap.lines.size());
+  TEST_ASSERT_EQUAL_STRING("+CSQ: 20,99", cap.lines[1].text.c_str());
+  TEST_ASSERT_TRUE(atIsFinalResult(cap.lines[2].text.c_str()));
+  TEST_ASSERT_TRUE(sim.idle());
+}
+
+void test_sim_drops() {
+  Sim7600Sim sim(42);
+  sim.setChunk(1, 32);
+  sim.setDropPerMille(200);
+  sim.addRule("AT", "OK", 1);
+  for (int i = 0; i < 500; i++) {
+    sim.write("AT\r");
+    sim.advance(1);
+    pump(sim);
+  }
+  TEST_ASSERT_EQUAL(500, sim.emitted);
+  TEST_ASSERT_TRUE(sim.lost > 50 && sim.lost < 150);
+  TEST_ASSERT_EQUAL(sim.emitted - sim.lost, cap.lines.size());
+}
+
+// ===== Throughput =====
+
+void test_throughput() {
+  Sim7600Sim sim(3);
+  sim.setChunk(1, 120);
+  const int rounds = 2000;
+  for (int i = 0; i < rounds; i++) {
+    sim.injectUrc("+CMQTTPUB: 0,0");
+    sim.injectMessage(1, "test/sim7600/do1", BINARY, sizeof(BINARY));
+  }
+
+  // Cut the stream first so only the parser is timed
+  std::vector<std::string> chunks;
+  uint8_t chunk[256];
+  size_t got;
+  while ((got = sim.read(chunk, sizeof(chunk))) > 0) {
+    chunks.push_back(std::string((const char*)chunk, got));
+  }
+  const int passes = 20;
+  cap.lines.reserve(rounds * 5 * passes);
+
+  std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+  for (int pass = 0; pass < passes; pass++) {
+    for (size_t i = 0; i < chunks.size(); i++) {
+      atParserFeed(&parser, (const uint8_t*)chunks[i].data(), chunks[i].size());
+    }
+  }
+  double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+  TEST_ASSERT_EQUAL(rounds * 5 * passes, parser.lines);  // PUB ack + 4 RX header lines
+  TEST_ASSERT_EQUAL(rounds * passes, cap.rxEnded);
+  char msg[80];
+  snprintf(msg, sizeof(msg), "%lu lines in %.3f s = %.0f lines/s",
+           (unsigned long)parser.lines, s, s > 0 ? parser.lines / s : 0.0);
+  TEST_MESSAGE(msg);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_final_results);
+  RUN_TEST(test_response_lines);
+  RUN_TEST(test_prompt_without_newline);
+  RUN_TEST(test_urc_lines);
+  RUN_TEST(test_puback_per_client);
+  RUN_TEST(test_puback_split_before_error);
+  RUN_TEST(test_rx_message_every_split);
+  RUN_TEST(test_rx_message_random_chunks);
+  RUN_TEST(test_rx_message_inbox_room);
+  RUN_TEST(test_raw_read_path);
+  RUN_TEST(test_reset_mid_message);
+  RUN_TEST(test_long_line_split);
+  RUN_TEST(test_no_buffer_drops_line);
+  RUN_TEST(test_sim_latency_and_urcs);
+  RUN_TEST(test_sim_drops);
+  RUN_TEST(test_throughput);
+  return UNITY_END();
+}
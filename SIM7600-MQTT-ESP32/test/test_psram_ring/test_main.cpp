@@ -0,0 +1,280 @@
+#include <unity.h>
+#include <deque>
+#include <string.h>
+#include <string>
+
+#include "../../src/psram_ring.cpp"
+
+/* ===============================================================================
+ * PSRAM RING TESTS - pio test -e native
+ * ===============================================================================
+ *
+ * psram_ring.cpp is compiled into this file (so the tests see RING_WRAP and
+ * recordSize()) on the host heap. A 64-byte ring keeps the offsets easy to
+ * follow: a 12-byte record takes 16 bytes, a 20-byte one 24.
+ * =============================================================================== */
+
+// ===== Fixture =====
+
+#define TEST_RING_BYTES  64
+
+static PsramRing ring;
+
+void setUp() {
+  TEST_ASSERT_TRUE(psramRingInit(&ring, TEST_RING_BYTES));
+}
+
+void tearDown() {
+  free(ring.buf);
+  memset(&ring, 0, sizeof(ring));
+}
+
+// Reserve maxLen, fill len bytes of tag, commit len
+static bool push(uint32_t maxLen, uint32_t len, char tag) {
+  uint8_t* p = psramRingReserve(&ring, maxLen);
+  if (p == NULL) {
+    return false;
+  }
+  memset(p, tag, len);
+  psramRingCommit(&ring, len);
+  return true;
+}
+
+// Oldest record is len bytes of tag; pops it
+static void popExpect(uint32_t len, char tag) {
+  uint32_t got = 0;
+  const uint8_t* p = psramRingPeek(&ring, &got);
+  TEST_ASSERT_NOT_NULL(p);
+  TEST_ASSERT_EQUAL(len, got);
+  for (uint32_t i = 0; i < got; i++) {
+    TEST_ASSERT_EQUAL(tag, (char)p[i]);
+  }
+  psramRingPop(&ring);
+}
+
+static void assertUsage(uint32_t used, uint32_t records) {
+  PsramRingStats st;
+  psramRingGetStats(&ring, &st);
+  TEST_ASSERT_EQUAL(used, st.used);
+  TEST_ASSERT_EQUAL(records, st.records);
+}
+
+static uint32_t header(uint32_t offset) {
+  return *(const uint32_t*)(ring.buf + offset);
+}
+
+// ===== Tests =====
+
+void test_fill_and_drain() {
+  PsramRingStats st;
+  psramRingGetStats(&ring, &st);
+  TEST_ASSERT_TRUE(st.inPsram);
+  TEST_ASSERT_EQUAL(TEST_RING_BYTES, st.capacity);
+
+  for (uint32_t i = 0; i < 4; i++) {
+    TEST_ASSERT_TRUE(push(12, 12, 'a' + i));
+    assertUsage(16 * (i + 1), i + 1);
+  }
+  // head == tail == 0 with used == size is full, not empty
+  TEST_ASSERT_EQUAL(0, ring.head);
+  TEST_ASSERT_NULL(psramRingReserve(&ring, 0));
+  assertUsage(64, 4);
+
+  for (uint32_t i = 0; i < 4; i++) {
+    popExpect(12, 'a' + i);
+    assertUsage(64 - 16 * (i + 1), 3 - i);
+  }
+  TEST_ASSERT_TRUE(psramRingEmpty(&ring));
+  TEST_ASSERT_NULL(psramRingPeek(&ring, NULL));
+
+  psramRingGetStats(&ring, &st);
+  TEST_ASSERT_EQUAL(4, st.pushed);
+  TEST_ASSERT_EQUAL(1, st.rejected);
+  TEST_ASSERT_EQUAL(64, st.highWater);
+}
+
+void test_commit_shorter_than_reserved() {
+  // Only the committed length is accounted, the rest of the reservation is free again
+  TEST_ASSERT_TRUE(push(40, 4, 'a'));
+  assertUsage(8, 1);
+  TEST_ASSERT_EQUAL(8, ring.head);
+  TEST_ASSERT_TRUE(push(52, 52, 'b'));
+  assertUsage(64, 2);
+  popExpect(4, 'a');
+  popExpect(52, 'b');
+  assertUsage(0, 0);
+}
+
+void test_wrap_marker_and_waste() {
+  TEST_ASSERT_TRUE(push(20, 20, 'a'));   // [0, 24)
+  TEST_ASSERT_TRUE(push(20, 20, 'b'));   // [24, 48)
+  popExpect(20, 'a');
+  assertUsage(24, 1);
+
+  // 16 bytes left at the end, 24 at the start: w goes to 0 and needs exactly tail
+  uint8_t* p = psramRingReserve(&ring, 20);
+  TEST_ASSERT_TRUE(p == ring.buf + RING_HEADER_LEN);
+  TEST_ASSERT_EQUAL(16, ring.resWaste);
+  memset(p, 'w', 20);
+  psramRingCommit(&ring, 20);
+
+  // The skipped end is marked and counted as used until the consumer passes it
+  TEST_ASSERT_EQUAL_HEX32(RING_WRAP, header(48));
+  TEST_ASSERT_EQUAL(20, header(0));
+  TEST_ASSERT_EQUAL(0, ring.resWaste);
+  TEST_ASSERT_EQUAL(24, ring.head);
+  TEST_ASSERT_EQUAL(24, ring.tail);
+  assertUsage(64, 2);
+  TEST_ASSERT_NULL(psramRingReserve(&ring, 0));  // head == tail, full
+
+  popExpect(20, 'b');
+  assertUsage(40, 1);                    // Waste still in, tail at the marker
+  TEST_ASSERT_EQUAL(48, ring.tail);
+
+  // Peek steps over the marker and gives the waste back
+  uint32_t len = 0;
+  TEST_ASSERT_TRUE(psramRingPeek(&ring, &len) == ring.buf + RING_HEADER_LEN);
+  TEST_ASSERT_EQUAL(20, len);
+  TEST_ASSERT_EQUAL(0, ring.tail);
+  assertUsage(24, 1);
+
+  // A second peek of the same record changes nothing
+  TEST_ASSERT_NOT_NULL(psramRingPeek(&ring, &len));
+  assertUsage(24, 1);
+
+  popExpect(20, 'w');
+  assertUsage(0, 0);
+  TEST_ASSERT_EQUAL(ring.head, ring.tail);
+}
+
+void test_wrap_needs_room_before_tail() {
+  TEST_ASSERT_TRUE(push(20, 20, 'a'));   // [0, 24)
+  TEST_ASSERT_TRUE(push(20, 20, 'b'));   // [24, 48)
+  popExpect(20, 'a');
+
+  // need 28 > tail 24 and > 16 left at the end
+  TEST_ASSERT_NULL(psramRingReserve(&ring, 24));
+  assertUsage(24, 1);
+
+  // A reservation that would wrap, then a smaller one that fits at the end:
+  // the second must not leave a marker or count the first one's waste
+  TEST_ASSERT_NOT_NULL(psramRingReserve(&ring, 20));
+  TEST_ASSERT_EQUAL(16, ring.resWaste);
+  TEST_ASSERT_TRUE(push(12, 12, 'c'));   // [48, 64)
+  TEST_ASSERT_EQUAL(12, header(48));
+  TEST_ASSERT_EQUAL(0, ring.head);
+  assertUsage(40, 2);
+
+  popExpect(20, 'b');
+  popExpect(12, 'c');
+  assertUsage(0, 0);
+}
+
+void test_exact_fit_below_tail() {
+  for (uint32_t i = 0; i < 3; i++) {
+    TEST_ASSERT_TRUE(push(12, 12, 'a' + i));
+  }
+  popExpect(12, 'a');
+  popExpect(12, 'b');
+  TEST_ASSERT_TRUE(push(12, 12, 'd'));   // [48, 64), head back to 0
+  TEST_ASSERT_EQUAL(0, ring.head);
+  assertUsage(32, 2);
+
+  // head < tail: free space is exactly [0, 32)
+  TEST_ASSERT_NULL(psramRingReserve(&ring, 32));
+  TEST_ASSERT_TRUE(push(28, 28, 'e'));
+  TEST_ASSERT_EQUAL(32, ring.head);
+  TEST_ASSERT_EQUAL(32, ring.tail);
+  assertUsage(64, 3);
+  TEST_ASSERT_NULL(psramRingReserve(&ring, 0));
+
+  popExpect(12, 'c');
+  popExpect(12, 'd');
+  popExpect(28, 'e');
+  assertUsage(0, 0);
+}
+
+void test_rolling_fifo() {
+  // Many laps with mixed lengths: order and content survive every wrap,
+  // used never exceeds the ring and comes back to 0
+  std::deque<std::string> expect;
+  uint32_t seed = 1;
+  uint32_t laps = 0;
+  uint32_t lastHead = 0;
+
+  for (uint32_t step = 0; step < 2000; step++) {
+    seed = seed * 1103515245u + 12345u;
+    uint32_t len = (seed >> 16) % 29;
+    bool produce = ((seed >> 8) & 3) != 0 || expect.empty();
+
+    if (produce) {
+      uint8_t* p = psramRingReserve(&ring, len);
+      if (p != NULL) {
+        std::string rec(len, (char)('A' + step % 26));
+        memcpy(p, rec.data(), len);
+        psramRingCommit(&ring, len);
+        expect.push_back(rec);
+        laps += ring.head < lastHead ? 1 : 0;
+        lastHead = ring.head;
+        continue;
+      }
+    }
+    if (!expect.empty()) {
+      uint32_t got = 0;
+      const uint8_t* p = psramRingPeek(&ring, &got);
+      TEST_ASSERT_NOT_NULL(p);
+      TEST_ASSERT_EQUAL(expect.front().size(), got);
+      TEST_ASSERT_EQUAL_MEMORY(expect.front().data(), p, got);
+      psramRingPop(&ring);
+      expect.pop_front();
+    }
+
+    PsramRingStats st;
+    psramRingGetStats(&ring, &st);
+    TEST_ASSERT_EQUAL(expect.size(), st.records);
+    TEST_ASSERT_TRUE(st.used <= TEST_RING_BYTES);
+  }
+
+  while (!expect.empty()) {
+    popExpect(expect.front().size(), expect.front()[0]);
+    expect.pop_front();
+  }
+  assertUsage(0, 0);
+  TEST_ASSERT_TRUE(laps > 10);
+  TEST_ASSERT_TRUE(ring.stats.rejected > 0);
+}
+
+void test_fallback_and_disabled() {
+  free(ring.buf);
+
+  // No PSRAM size asked for: internal heap, rounded down to the alignment
+  TEST_ASSERT_TRUE(psramRingInit(&ring, 0, TEST_RING_BYTES + 3));
+  PsramRingStats st;
+  psramRingGetStats(&ring, &st);
+  TEST_ASSERT_FALSE(st.inPsram);
+  TEST_ASSERT_EQUAL(TEST_RING_BYTES, st.capacity);
+  TEST_ASSERT_TRUE(push(12, 12, 'a'));
+  popExpect(12, 'a');
+  free(ring.buf);
+
+  // Neither: every call is a no-op
+  TEST_ASSERT_FALSE(psramRingInit(&ring, 0, 0));
+  TEST_ASSERT_NULL(psramRingReserve(&ring, 4));
+  psramRingCommit(&ring, 4);
+  uint32_t len = 0;
+  TEST_ASSERT_NULL(psramRingPeek(&ring, &len));
+  psramRingPop(&ring);
+  assertUsage(0, 0);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_fill_and_drain);
+  RUN_TEST(test_commit_shorter_than_reserved);
+  RUN_TEST(test_wrap_marker_and_waste);
+  RUN_TEST(test_wrap_needs_room_before_tail);
+  RUN_TEST(test_exact_fit_below_tail);
+  RUN_TEST(test_rolling_fifo);
+  RUN_TEST(test_fallback_and_disabled);
+  return UNITY_END();
+}
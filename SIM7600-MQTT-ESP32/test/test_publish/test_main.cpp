@@ -0,0 +1,353 @@
+#include <unity.h>
+#include <string>
+#include <vector>
+
+// No flash on the host - failed messages are counted, not parked
+#define OFFLINE_STORE_ENABLED 0
+
+#include "../../src/at_engine.cpp"
+#include "../../src/msg_pool.cpp"
+#include "../../src/mqtt_publish.cpp"
+#include "sim_port.h"
+
+/* ===============================================================================
+ * PUBLISH PIPELINE TESTS - pio test -e native
+ * ===============================================================================
+ *
+ * The AT engine, the message pool and the publish pipeline are compiled
+ * into this file unchanged (so the tests reach their statics) and run on
+ * the host port: the engine writes to the SIM7600 simulator through
+ * at_uart.h, the simulator's answers come back through the parser, the line
+ * ring and the queues. publishStep() is the PublishTask loop body; ModemTask
+ * is replaced by running each job inline.
+ * =============================================================================== */
+
+// ===== Collaborators =====
+
+bool inboxBegin(uint8_t, uint16_t, uint32_t) { return false; }
+uint8_t* inboxWritePtr(InboxPart, size_t* room) { *room = 0; return NULL; }
+void inboxAdvance(InboxPart, size_t) {}
+void inboxCommit() {}
+void inboxAbort() {}
+
+void metricsRecordAt(const char*, uint32_t) {}
+void metricsRecordPublish(uint8_t, uint32_t) {}
+void metricsRecordQueueDepth(uint8_t, uint32_t) {}
+void powerNoteDelivered() {}
+
+bool mqttClientIsConnected(uint8_t) { return true; }
+
+int modemCall(ModemJob job, void* arg, TickType_t, bool, int) {
+  return job(arg);
+}
+
+// ===== Fixture =====
+
+#define PUB_LATENCY_MS  400   // AT+CMQTTPUB OK → +CMQTTPUB result (broker round trip)
+
+struct Outcome {
+  uint32_t seq;
+  bool delivered;
+};
+
+static Sim7600Sim* sim = NULL;
+static std::vector<Outcome> outcomes;
+
+static void recordOutcome(const PublishMsg* msg, bool delivered, uint32_t) {
+  Outcome o = { msg->seq, delivered };
+  outcomes.push_back(o);
+}
+
+// The SIM7600 side of a publish: '>' for topic and payload, OK, later the result
+static void addPublishRules(Sim7600Sim* s) {
+  s->addPromptRule("AT+CMQTTTOPIC=", 5, 5);
+  s->addPromptRule("AT+CMQTTPAYLOAD=", 5, 5);
+  s->addResultRule("AT+CMQTTPUB=", "OK", 3, "+CMQTTPUB: 0,0", PUB_LATENCY_MS);
+}
+
+void setUp() {
+  sim = new Sim7600Sim(7);
+  sim->setChunk(1, 16);
+  addPublishRules(sim);
+  simPortAttach(sim);
+
+  memset((void*)slotBusy, 0, sizeof(slotBusy));
+  TEST_ASSERT_TRUE(atEngineInit());
+  TEST_ASSERT_TRUE(mqttPublishInit());
+  outcomes.clear();
+  mqttPublishSetResultHook(recordOutcome);
+}
+
+void tearDown() {
+  mqttPublishSetResultHook(NULL);
+  simPortAttach(NULL);
+  delete sim;
+  sim = NULL;
+}
+
+static bool submit(const char* topic, const char* payload) {
+  return mqttPublishAsync(MQTT_CLIENT_TELEMETRY, topic, payload, strlen(payload), 1);
+}
+
+// PublishTask passes until n messages are finished or limitMs of virtual time pass
+static uint8_t runPublish(size_t n, uint32_t limitMs) {
+  PublishClient* pc = &clients[MQTT_CLIENT_TELEMETRY];
+  uint8_t maxInflight = 0;
+  uint32_t start = millis();
+  while (outcomes.size() < n && millis() - start < limitMs) {
+    publishStep(pc, pdMS_TO_TICKS(PUB_POLL_MS));
+    maxInflight = pc->inflightCount > maxInflight ? pc->inflightCount : maxInflight;
+  }
+  return maxInflight;
+}
+
+// Nothing leaked: every pool buffer and every line slot is back
+static void assertAllReleased() {
+  MsgPoolStats pool;
+  msgPoolGetStats(&pool);
+  TEST_ASSERT_EQUAL(0, pool.inUse);
+
+  atFlushResponses();
+  AtLine line;
+  while (atNextPubAck(MQTT_CLIENT_TELEMETRY, &line, 0)) {
+    atReleaseLine(line);
+  }
+  for (uint8_t i = 0; i < AT_LINE_SLOTS; i++) {
+    TEST_ASSERT_FALSE(slotBusy[i]);
+  }
+}
+
+// ===== Tests =====
+
+void test_window_fifo_under_latency() {
+  const size_t n = 6;
+  for (size_t i = 0; i < n; i++) {
+    char payload[16];
+    snprintf(payload, sizeof(payload), "v=%u", (unsigned)i);
+    TEST_ASSERT_TRUE(submit("test/fifo", payload));
+  }
+
+  uint32_t start = millis();
+  uint8_t maxInflight = runPublish(n, 10000);
+
+  TEST_ASSERT_EQUAL(n, outcomes.size());
+  for (size_t i = 0; i < n; i++) {
+    TEST_ASSERT_TRUE(outcomes[i].delivered);
+    if (i > 0) {
+      TEST_ASSERT_EQUAL(outcomes[i - 1].seq + 1, outcomes[i].seq);  // Results matched in order
+    }
+  }
+  // Pipelined: the broker round trips overlap instead of adding up
+  TEST_ASSERT_EQUAL(PUBLISH_INFLIGHT_MAX, maxInflight);
+  TEST_ASSERT_TRUE(millis() - start < n * PUB_LATENCY_MS);
+
+  // Same topic every time: loaded once, then skipped
+  TEST_ASSERT_EQUAL(1, sim->count("AT+CMQTTTOPIC="));
+  TEST_ASSERT_EQUAL(n, sim->count("AT+CMQTTPUB="));
+  TEST_ASSERT_EQUAL(n - 1, clients[0].topicSkips);
+  TEST_ASSERT_EQUAL_STRING("test/fifo", sim->inputs[0].c_str());
+  TEST_ASSERT_EQUAL_STRING("v=5", sim->inputs.back().c_str());
+  assertAllReleased();
+}
+
+void test_lost_result_retries_window() {
+  TEST_ASSERT_TRUE(submit("test/ack", "first"));
+  runPublish(1, 10000);
+  TEST_ASSERT_EQUAL(1, outcomes.size());
+
+  // The second result never arrives: the window starts over after PUB_ACK_TIMEOUT_MS
+  sim->loseNext("+CMQTTPUB: 0,0");
+  TEST_ASSERT_TRUE(submit("test/ack", "second"));
+  uint32_t start = millis();
+  runPublish(2, PUB_ACK_TIMEOUT_MS + 10000);
+
+  TEST_ASSERT_EQUAL(2, outcomes.size());
+  TEST_ASSERT_TRUE(outcomes[1].delivered);
+  TEST_ASSERT_TRUE(millis() - start > PUB_ACK_TIMEOUT_MS);
+  TEST_ASSERT_EQUAL(1, sim->lost);
+  TEST_ASSERT_EQUAL(3, sim->count("AT+CMQTTPUB="));
+  TEST_ASSERT_EQUAL(1, clients[0].retried);
+  TEST_ASSERT_EQUAL(0, clients[0].failed);
+  // A timeout forgets the loaded topic - the retry sends it again
+  TEST_ASSERT_EQUAL(2, sim->count("AT+CMQTTTOPIC="));
+  assertAllReleased();
+}
+
+void test_lost_prompt_retries_message() {
+  // The modem sends '>' but it never arrives; the modem then times out on
+  // the missing topic bytes and answers ERROR, which ends the prompt wait
+  sim->loseNext(">");
+  TEST_ASSERT_TRUE(submit("test/prompt", "hello"));
+  runPublish(1, 10000);
+
+  TEST_ASSERT_EQUAL(1, outcomes.size());
+  TEST_ASSERT_TRUE(outcomes[0].delivered);
+  TEST_ASSERT_EQUAL(1, clients[0].retried);
+  TEST_ASSERT_EQUAL(2, sim->count("AT+CMQTTTOPIC="));
+  TEST_ASSERT_EQUAL(1, sim->count("AT+CMQTTPUB="));
+  // No bytes went out for the failed attempt
+  TEST_ASSERT_EQUAL(2, sim->inputs.size());
+  TEST_ASSERT_EQUAL_STRING("test/prompt", sim->inputs[0].c_str());
+  TEST_ASSERT_EQUAL_STRING("hello", sim->inputs[1].c_str());
+  assertAllReleased();
+}
+
+void test_result_error_retries_message() {
+  // The broker refuses the first attempt (+CMQTTPUB: 0,11), the retry goes through
+  sim->clearRules();
+  sim->addPromptRule("AT+CMQTTTOPIC=", 5, 5);
+  sim->addPromptRule("AT+CMQTTPAYLOAD=", 5, 5);
+  sim->addResultRule("AT+CMQTTPUB=", "OK", 3, "+CMQTTPUB: 0,11", PUB_LATENCY_MS);
+
+  TEST_ASSERT_TRUE(submit("test/err", "x"));
+  PublishClient* pc = &clients[MQTT_CLIENT_TELEMETRY];
+  while (sim->count("AT+CMQTTPUB=") == 0) {
+    publishStep(pc, pdMS_TO_TICKS(PUB_POLL_MS));
+  }
+  sim->clearRules();
+  addPublishRules(sim);
+  runPublish(1, 10000);
+
+  TEST_ASSERT_EQUAL(1, outcomes.size());
+  TEST_ASSERT_TRUE(outcomes[0].delivered);
+  TEST_ASSERT_EQUAL(1, pc->retried);
+  TEST_ASSERT_EQUAL(2, sim->count("AT+CMQTTPUB="));
+  // The topic stays loaded - only a result for a skipped topic clears it
+  TEST_ASSERT_EQUAL(1, sim->count("AT+CMQTTTOPIC="));
+  assertAllReleased();
+}
+
+void test_forgotten_topic_disables_reuse() {
+  // This firmware clears the topic after every PUB and rejects the next
+  // AT+CMQTTPUB that relies on it - reporting "+CMQTTPUB: 0,14" first.
+  // The first result arrives while the second message is being staged.
+  sim->clearRules();
+  sim->addPromptRule("AT+CMQTTTOPIC=", 5, 5);
+  sim->addPromptRule("AT+CMQTTPAYLOAD=", 5, 5);
+  sim->addResultRule("AT+CMQTTPUB=", "OK", 3, "+CMQTTPUB: 0,0", 10);
+  sim->requireSince("AT+CMQTTPUB=", "AT+CMQTTTOPIC=", "+CMQTTPUB: 0,14\r\n\r\nERROR");
+
+  const size_t n = 4;
+  for (size_t i = 0; i < n; i++) {
+    TEST_ASSERT_TRUE(submit("test/forget", "x"));
+  }
+  runPublish(n, 10000);
+  PublishClient* pc = &clients[MQTT_CLIENT_TELEMETRY];
+
+  TEST_ASSERT_EQUAL(n, outcomes.size());
+  for (size_t i = 0; i < n; i++) {
+    TEST_ASSERT_TRUE(outcomes[i].delivered);
+  }
+  // One rejection, retried in place with the topic; nothing published twice
+  TEST_ASSERT_FALSE(pc->topicReuse);
+  TEST_ASSERT_EQUAL(0, pc->retried);
+  TEST_ASSERT_EQUAL(n + 1, sim->count("AT+CMQTTPUB="));
+  TEST_ASSERT_EQUAL(n, sim->count("AT+CMQTTTOPIC="));
+  assertAllReleased();
+}
+
+void test_rejected_publish_keeps_window() {
+  // AT+CMQTTPUB for the third message answers ERROR while two are in
+  // flight; their results are still matched and nothing is re-sent
+  sim->clearRules();
+  sim->addPromptRule("AT+CMQTTTOPIC=", 5, 5);
+  sim->addPromptRule("AT+CMQTTPAYLOAD=", 5, 5);
+  sim->addResultRule("AT+CMQTTPUB=", "OK", 3, "+CMQTTPUB: 0,0", PUB_LATENCY_MS);
+
+  PublishClient* pc = &clients[MQTT_CLIENT_TELEMETRY];
+  TEST_ASSERT_TRUE(submit("test/window/a", "1"));
+  TEST_ASSERT_TRUE(submit("test/window/b", "2"));
+  while (pc->inflightCount < 2) {
+    publishStep(pc, pdMS_TO_TICKS(PUB_POLL_MS));
+  }
+  sim->clearRules();
+  sim->addPromptRule("AT+CMQTTTOPIC=", 5, 5);
+  sim->addPromptRule("AT+CMQTTPAYLOAD=", 5, 5);
+  sim->addRule("AT+CMQTTPUB=", "ERROR", 3);
+  TEST_ASSERT_TRUE(submit("test/window/c", "3"));
+  publishStep(pc, pdMS_TO_TICKS(PUB_POLL_MS));
+  TEST_ASSERT_EQUAL(2, pc->inflightCount);
+  TEST_ASSERT_EQUAL(1, pc->retried);
+
+  sim->clearRules();
+  addPublishRules(sim);
+  runPublish(3, 10000);
+
+  TEST_ASSERT_EQUAL(3, outcomes.size());
+  TEST_ASSERT_EQUAL(3, pc->delivered);
+  TEST_ASSERT_EQUAL(1, pc->retried);
+  TEST_ASSERT_EQUAL(4, sim->count("AT+CMQTTPUB="));
+  assertAllReleased();
+}
+
+void test_split_result_waits_for_line_end() {
+  // "+CMQTTPUB: 0," and its error code arrive 200 ms apart: the message
+  // stays in flight until the whole line is there, then fails on err 11
+  sim->clearRules();
+  sim->addPromptRule("AT+CMQTTTOPIC=", 5, 5);
+  sim->addPromptRule("AT+CMQTTPAYLOAD=", 5, 5);
+  sim->addRule("AT+CMQTTPUB=", "OK", 3);
+
+  TEST_ASSERT_TRUE(submit("test/split", "x"));
+  PublishClient* pc = &clients[MQTT_CLIENT_TELEMETRY];
+  while (pc->inflightCount == 0) {
+    publishStep(pc, pdMS_TO_TICKS(PUB_POLL_MS));
+  }
+  sim->injectRaw("\r\n+CMQTTPUB: 0,");
+  sim->injectRaw("11\r\n", 200);
+  for (int i = 0; i < 15; i++) {
+    publishStep(pc, pdMS_TO_TICKS(PUB_POLL_MS));
+  }
+  TEST_ASSERT_EQUAL(1, pc->inflightCount);
+  TEST_ASSERT_EQUAL(0, pc->delivered);
+
+  sim->clearRules();
+  addPublishRules(sim);
+  runPublish(1, 10000);
+
+  TEST_ASSERT_EQUAL(1, outcomes.size());
+  TEST_ASSERT_TRUE(outcomes[0].delivered);
+  TEST_ASSERT_EQUAL(1, pc->retried);  // The error was read, not a premature success
+  TEST_ASSERT_EQUAL(2, sim->count("AT+CMQTTPUB="));
+  assertAllReleased();
+}
+
+void test_random_drops_settle() {
+  // 5% of everything the modem sends is lost: prompts, OKs and results.
+  // Each message must end up delivered or failed exactly once, and every
+  // buffer must come back.
+  sim->setChunk(1, 64);
+  sim->setDropPerMille(50);
+  const size_t n = 10;
+  for (size_t i = 0; i < n; i++) {
+    char payload[16];
+    snprintf(payload, sizeof(payload), "n=%u", (unsigned)i);
+    TEST_ASSERT_TRUE(submit(i % 2 ? "test/drop/a" : "test/drop/b", payload));
+  }
+  runPublish(n, 30 * 60 * 1000UL);
+
+  TEST_ASSERT_EQUAL(n, outcomes.size());
+  TEST_ASSERT_EQUAL(n, clients[0].delivered + clients[0].failed);
+  TEST_ASSERT_TRUE(sim->lost > 0);
+  TEST_ASSERT_TRUE(clients[0].retried > 0);
+  TEST_ASSERT_TRUE(clients[0].delivered > 0);
+  for (size_t i = 0; i < n; i++) {
+    for (size_t j = i + 1; j < n; j++) {
+      TEST_ASSERT_TRUE(outcomes[i].seq != outcomes[j].seq);
+    }
+  }
+  assertAllReleased();
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_window_fifo_under_latency);
+  RUN_TEST(test_lost_result_retries_window);
+  RUN_TEST(test_lost_prompt_retries_message);
+  RUN_TEST(test_result_error_retries_message);
+  RUN_TEST(test_forgotten_topic_disables_reuse);
+  RUN_TEST(test_rejected_publish_keeps_window);
+  RUN_TEST(test_split_result_waits_for_line_end);
+  RUN_TEST(test_random_drops_settle);
+  return UNITY_END();
+}